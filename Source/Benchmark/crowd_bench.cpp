@@ -0,0 +1,793 @@
+// Headless benchmark of the park navigation and the visitor simulation. Builds the game code against the
+// minimal engine shim in shim/, generates a synthetic park, and prints the results as JSON on stdout.
+//
+//   crowd_bench [--size 256] [--visitors 20000] [--ticks 600] [--picks 4000000] [--changes 2000]
+//               [--crowd 4] [--seed 1] [--camera X,Z] [--record FILE] [--traffic FILE] [--verify]
+//   crowd_bench --replay FILE
+//
+// Without --camera every visitor is simulated in full. With it, visitors get their level of detail from
+// their distance to a camera placed at that tile. --record saves the run as a simulation recording, and
+// --replay plays back a recording made in the game or by the benchmark as fast as possible. Both modes
+// print the visitor state hash after the last tick, and --replay fails if it differs from the hash stored
+// in the recording. --traffic
+// saves the traffic counters of the visitor ticks, which needs a build with -DCROWD_BENCH_TRAFFIC_STATS=ON.
+// --verify checks the navigation against searches over the generated paths after the park is built and
+// after every change: the component labels, reachability from the entries, the distances of a goal at the
+// entries, and a few FindPath results. Before that, it makes --changes random edits, undos, redos and
+// resizes on a separate map and compares it after each with a map built from scratch. After the run, it
+// simulates the park again with every visitor in full detail and with the level of detail of the camera, or
+// of one at the corner of the map, and compares the tiles the visitors picked with the crowd threshold off.
+// The run fails if any of them disagree. The visitors that picked differently with crowds are only counted.
+// It is slow on big maps, so it's meant for runs like --size 64.
+
+#include "gameplay/map_navigation.h"
+#include "gameplay/sim_recording.h"
+#include "gameplay/visitor_system.h"
+#include "script_globals.h"
+#include "util/randomizer.h"
+#include "Engine/Engine/Time.h"
+#include "Engine/Level/Actors/AnimatedModel.h"
+#include "Engine/Level/Actors/Camera.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+
+
+namespace
+{
+    struct Options
+    {
+        int size = 256;
+        int visitors = 20000;
+        int ticks = 600;
+        int picks = 4000000;
+        int changes = 2000;
+        int crowd = 4;
+        uint64 seed = 1;
+        bool camera = false;
+        bool verify = false;
+        Int2 camera_tile;
+        std::wstring record;
+        std::wstring replay;
+        std::wstring traffic;
+    };
+
+    // Paths are placed on a grid of blocks like a built up park, with a few open squares and some of the
+    // grid left out, so every tile type shows up.
+    constexpr int BLOCK_SIZE = 6;
+    constexpr int ENTRY_GRID_DISTANCE = 6;
+    constexpr float TICK_RATE = 20.0f;
+
+    using Clock = std::chrono::steady_clock;
+
+    double Seconds(Clock::time_point from, Clock::time_point to)
+    {
+        return std::chrono::duration<double>(to - from).count();
+    }
+
+    int64 Nanoseconds(Clock::time_point from, Clock::time_point to)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count();
+    }
+
+    std::wstring WidePath(const char *path)
+    {
+        std::wstring result(std::strlen(path) + 1, L'\0');
+        const size_t length = std::mbstowcs(&result[0], path, result.size());
+        result.resize(length == (size_t)-1 ? 0 : length);
+        return result;
+    }
+
+    int64 PeakMemory()
+    {
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return (int64)usage.ru_maxrss * 1024;
+    }
+
+    bool ParseOptions(int argc, char **argv, Options &options)
+    {
+        for (int ix = 1; ix < argc; ++ix)
+        {
+            if (std::strcmp(argv[ix], "--verify") == 0)
+            {
+                options.verify = true;
+                continue;
+            }
+            if (ix + 1 >= argc)
+                return false;
+            const char *name = argv[ix];
+            const char *value = argv[++ix];
+            if (std::strcmp(name, "--size") == 0)
+                options.size = std::atoi(value);
+            else if (std::strcmp(name, "--visitors") == 0)
+                options.visitors = std::atoi(value);
+            else if (std::strcmp(name, "--ticks") == 0)
+                options.ticks = std::atoi(value);
+            else if (std::strcmp(name, "--picks") == 0)
+                options.picks = std::atoi(value);
+            else if (std::strcmp(name, "--changes") == 0)
+                options.changes = std::atoi(value);
+            else if (std::strcmp(name, "--crowd") == 0)
+                options.crowd = std::atoi(value);
+            else if (std::strcmp(name, "--seed") == 0)
+                options.seed = std::strtoull(value, nullptr, 10);
+            else if (std::strcmp(name, "--record") == 0)
+                options.record = WidePath(value);
+            else if (std::strcmp(name, "--replay") == 0)
+                options.replay = WidePath(value);
+            else if (std::strcmp(name, "--traffic") == 0)
+                options.traffic = WidePath(value);
+            else if (std::strcmp(name, "--camera") == 0)
+            {
+                options.camera = std::sscanf(value, "%d,%d", &options.camera_tile.X, &options.camera_tile.Y) == 2;
+                if (!options.camera)
+                    return false;
+            }
+            else
+                return false;
+        }
+        // The entries are spread over four blocks around the middle of the map.
+        return options.size >= BLOCK_SIZE * 5 && options.visitors >= 0 && options.ticks >= 0 && options.picks >= 0 && options.changes >= 0;
+    }
+
+    // The generated map, with a copy of the paths to know whether an edit adds or removes one.
+    struct Park
+    {
+        int size = 0;
+        std::vector<uint8> paths;
+        std::vector<Int2> path_tiles;
+        std::vector<int> entries;
+    };
+
+    void GeneratePark(MapNavigation &nav, Park &park, RandomizerStream &stream)
+    {
+        const int size = park.size;
+        park.paths.assign(size * size, 0);
+        for (int y = 0; y < size; ++y)
+        {
+            for (int x = 0; x < size; ++x)
+            {
+                const bool road = x % BLOCK_SIZE == 0 || y % BLOCK_SIZE == 0;
+                park.paths[y * size + x] = road ? 1 : 0;
+            }
+        }
+
+        // Open squares on some blocks, and gaps in the grid on others.
+        const int blocks = size / BLOCK_SIZE;
+        for (int ix = 0, siz = blocks * blocks / 4; ix < siz; ++ix)
+        {
+            const int bx = (int)(stream.Rand() * blocks) * BLOCK_SIZE;
+            const int by = (int)(stream.Rand() * blocks) * BLOCK_SIZE;
+            if (stream.Rand() < 0.5f)
+            {
+                for (int y = by + 1; y < std::min(size, by + 4); ++y)
+                    for (int x = bx + 1; x < std::min(size, bx + 4); ++x)
+                        park.paths[y * size + x] = 1;
+            }
+            else if (by > 0)
+            {
+                for (int x = bx + 1; x < std::min(size, bx + BLOCK_SIZE); ++x)
+                    park.paths[by * size + x] = 0;
+            }
+        }
+
+        // Entries are the grid columns in the middle of the bottom edge, which are never cut.
+        for (int x = size / 2 - BLOCK_SIZE * 2; x <= size / 2 + BLOCK_SIZE * 2; x += BLOCK_SIZE)
+            park.entries.push_back(x - x % BLOCK_SIZE);
+        for (int x : park.entries)
+            for (int y = 0; y < BLOCK_SIZE; ++y)
+                park.paths[y * size + x] = 1;
+
+        nav.SetMapData(Int2(size, size));
+        nav.BeginChange();
+        for (int y = 0; y < size; ++y)
+        {
+            for (int x = 0; x < size; ++x)
+            {
+                if (park.paths[y * size + x] == 0)
+                    continue;
+                nav.AddPath(Int2(x, y));
+                park.path_tiles.push_back(Int2(x, y));
+            }
+        }
+        nav.EndChange();
+
+        Array<Int2> entryCells;
+        for (int x : park.entries)
+            entryCells.Add(Int2(x, 0));
+        nav.SetEntryTiles(entryCells);
+    }
+
+    // Labels the connected paths of the park with a breadth first search, and compares the result with the
+    // components of the navigation. Returns the number of tiles where they disagree.
+    int VerifyComponents(const MapNavigation &nav, const Park &park)
+    {
+        const int size = park.size;
+        std::vector<int> labels(size * size, -1);
+        std::vector<Int2> queue;
+        int labelCount = 0;
+        for (int start = 0; start < size * size; ++start)
+        {
+            if (park.paths[start] == 0 || labels[start] != -1)
+                continue;
+            labels[start] = labelCount;
+            queue.assign(1, Int2(start % size, start / size));
+            for (size_t head = 0; head < queue.size(); ++head)
+            {
+                const Int2 pos = queue[head];
+                const Int2 sides[4] = { Int2(pos.X + 1, pos.Y), Int2(pos.X - 1, pos.Y), Int2(pos.X, pos.Y + 1), Int2(pos.X, pos.Y - 1) };
+                for (const Int2 &next : sides)
+                {
+                    if (next.X < 0 || next.Y < 0 || next.X >= size || next.Y >= size)
+                        continue;
+                    const int index = next.Y * size + next.X;
+                    if (park.paths[index] == 0 || labels[index] != -1)
+                        continue;
+                    labels[index] = labelCount;
+                    queue.push_back(next);
+                }
+            }
+            ++labelCount;
+        }
+
+        // Each searched part must have one label of its own.
+        std::vector<int> navLabels(labelCount, NavComponents::NO_COMPONENT);
+        std::vector<int> parts;
+        int errors = 0;
+        for (int index = 0; index < size * size; ++index)
+        {
+            const int component = nav.ComponentOf(Int2(index % size, index / size));
+            if (labels[index] == -1)
+            {
+                errors += component != NavComponents::NO_COMPONENT ? 1 : 0;
+                continue;
+            }
+            if (component == NavComponents::NO_COMPONENT)
+            {
+                ++errors;
+                continue;
+            }
+            int &navLabel = navLabels[labels[index]];
+            if (navLabel == NavComponents::NO_COMPONENT)
+            {
+                navLabel = component;
+                if ((int)parts.size() <= component)
+                    parts.resize(component + 1, -1);
+                if (parts[component] != -1)
+                    ++errors;
+                parts[component] = labels[index];
+            }
+            else if (navLabel != component)
+                ++errors;
+        }
+        return errors;
+    }
+
+    // Checks reachability from the entries, the distances to the entry goal and some paths found between
+    // tiles against breadth first searches of the park, besides the components. round picks different
+    // tiles for FindPath on every call. Returns the number of wrong answers.
+    int VerifyNavigation(MapNavigation &nav, const Park &park, int goal, int round)
+    {
+        const int size = park.size;
+        int errors = VerifyComponents(nav, park);
+
+        std::vector<int> distances(size * size, -1);
+        std::vector<Int2> queue;
+        for (int x : park.entries)
+        {
+            if (park.paths[x] != 0 && distances[x] == -1)
+            {
+                distances[x] = 0;
+                queue.push_back(Int2(x, 0));
+            }
+        }
+        for (size_t head = 0; head < queue.size(); ++head)
+        {
+            const Int2 pos = queue[head];
+            const Int2 sides[4] = { Int2(pos.X + 1, pos.Y), Int2(pos.X - 1, pos.Y), Int2(pos.X, pos.Y + 1), Int2(pos.X, pos.Y - 1) };
+            for (const Int2 &next : sides)
+            {
+                if (next.X < 0 || next.Y < 0 || next.X >= size || next.Y >= size)
+                    continue;
+                const int index = next.Y * size + next.X;
+                if (park.paths[index] == 0 || distances[index] != -1)
+                    continue;
+                distances[index] = distances[pos.Y * size + pos.X] + 1;
+                queue.push_back(next);
+            }
+        }
+
+        std::vector<Int2> tiles;
+        for (int index = 0; index < size * size; ++index)
+        {
+            const Int2 pos(index % size, index / size);
+            if (park.paths[index] == 0)
+                continue;
+            tiles.push_back(pos);
+            errors += nav.IsReachableFromEntry(pos) != (distances[index] != -1) ? 1 : 0;
+            errors += nav.GoalDistance(goal, pos) != distances[index] ? 1 : 0;
+        }
+
+        // Found paths must walk over path tiles one step at a time, and exist only between connected tiles.
+        for (int ix = 0; ix < 8 && !tiles.empty(); ++ix)
+        {
+            const Int2 from = tiles[((size_t)round * 16 + ix * 2) * 7919 % tiles.size()];
+            const Int2 to = tiles[((size_t)round * 16 + ix * 2 + 1) * 7919 % tiles.size()];
+            const Array<Int2> path = nav.FindPath(from, to);
+            if (path.Count() == 0)
+            {
+                errors += nav.ComponentOf(from) == nav.ComponentOf(to) ? 1 : 0;
+                continue;
+            }
+            bool valid = path[0] == from && path.Last() == to;
+            for (int step = 0; step < path.Count() && valid; ++step)
+            {
+                const Int2 pos = path[step];
+                valid = pos.X >= 0 && pos.Y >= 0 && pos.X < size && pos.Y < size && park.paths[pos.Y * size + pos.X] != 0;
+                if (valid && step > 0)
+                    valid = std::abs(pos.X - path[step - 1].X) + std::abs(pos.Y - path[step - 1].Y) == 1;
+            }
+            errors += valid ? 0 : 1;
+        }
+        return errors;
+    }
+
+    // Paths of a map without visitors, with the undo and redo history MapNavigation should have.
+    struct EditModel
+    {
+        Int2 size;
+        std::vector<uint8> paths;
+        std::vector<std::vector<uint8>> undo;
+        std::vector<std::vector<uint8>> redo;
+        Array<Int2> goal;
+        // The clusters of a resized map keep their cells, so they are no longer aligned with the clusters of
+        // a map built from scratch, and FindPath can pick another short path.
+        bool resized = false;
+    };
+
+    // Checks that path walks from one path tile to the next, starting at from and ending at to.
+    bool IsValidPath(const EditModel &model, const Array<Int2> &path, Int2 from, Int2 to)
+    {
+        bool valid = path.Count() != 0 && path[0] == from && path.Last() == to;
+        for (int step = 0; step < path.Count() && valid; ++step)
+        {
+            const Int2 pos = path[step];
+            valid = pos.X >= 0 && pos.Y >= 0 && pos.X < model.size.X && pos.Y < model.size.Y && model.paths[pos.Y * model.size.X + pos.X] != 0;
+            if (valid && step > 0)
+                valid = std::abs(pos.X - path[step - 1].X) + std::abs(pos.Y - path[step - 1].Y) == 1;
+        }
+        return valid;
+    }
+
+    // Builds a map from scratch with the paths and goal of the model, and counts where it disagrees with nav.
+    int CompareWithRebuild(MapNavigation &nav, const EditModel &model, RandomizerStream &stream)
+    {
+        SpawnParams params;
+        auto rebuilt = std::make_unique<MapNavigation>(params);
+        rebuilt->SetMapData(model.size);
+        rebuilt->BeginChange();
+        std::vector<Int2> tiles;
+        for (int index = 0; index < model.size.X * model.size.Y; ++index)
+        {
+            if (model.paths[index] == 0)
+                continue;
+            tiles.push_back(Int2(index % model.size.X, index / model.size.X));
+            rebuilt->AddPath(tiles.back());
+        }
+        rebuilt->EndChange();
+        rebuilt->AddGoal(model.goal);
+
+        int errors = nav.CountDifferences(*rebuilt);
+        // The hierarchy is only reachable through FindPath, which has to give the same paths.
+        for (int ix = 0; ix < 4 && !tiles.empty(); ++ix)
+        {
+            const Int2 from = tiles[(size_t)(stream.Rand() * tiles.size()) % tiles.size()];
+            const Int2 to = tiles[(size_t)(stream.Rand() * tiles.size()) % tiles.size()];
+            const Array<Int2> path = nav.FindPath(from, to);
+            const Array<Int2> rebuiltPath = rebuilt->FindPath(from, to);
+            bool same = path.Count() == rebuiltPath.Count();
+            for (int step = 0; step < path.Count() && same; ++step)
+                same = path[step] == rebuiltPath[step];
+            if (!same && model.resized)
+                same = path.Count() == 0 ? rebuiltPath.Count() == 0 : rebuiltPath.Count() != 0 && IsValidPath(model, path, from, to);
+            errors += same ? 0 : 1;
+        }
+        return errors;
+    }
+
+    // Random changes that add and remove paths, often on the same tiles, mixed with undos, redos and resizes
+    // that grow and shrink the map on every side, on a map without visitors. After every step the map is
+    // compared with one built from scratch. Returns the number of differences, and stops at the first step
+    // that has any.
+    int VerifyEdits(RandomizerStream &stream, int steps)
+    {
+        SpawnParams params;
+        auto nav = std::make_unique<MapNavigation>(params);
+        EditModel model;
+        model.size = Int2(48, 40);
+        model.paths.assign(model.size.X * model.size.Y, 0);
+        model.goal.Add(Int2(model.size.X / 2, 0));
+        nav->SetMapData(model.size);
+        nav->AddGoal(model.goal);
+
+        for (int step = 0; step < steps; ++step)
+        {
+            const float kind = stream.Rand();
+            if (kind < 0.05f)
+            {
+                // Resizing forgets the undo history. Paths and goal cells move by the offset, and paths outside
+                // the new size are removed.
+                const Int2 size(8 + (int)(stream.Rand() * 80), 8 + (int)(stream.Rand() * 80));
+                const Int2 offset((int)(stream.Rand() * 41) - 20, (int)(stream.Rand() * 41) - 20);
+                nav->ResizeMap(size, offset);
+                std::vector<uint8> paths(size.X * size.Y, 0);
+                for (int index = 0; index < model.size.X * model.size.Y; ++index)
+                {
+                    const Int2 pos(index % model.size.X + offset.X, index / model.size.X + offset.Y);
+                    if (pos.X >= 0 && pos.Y >= 0 && pos.X < size.X && pos.Y < size.Y)
+                        paths[pos.Y * size.X + pos.X] = model.paths[index];
+                }
+                for (Int2 &pos : model.goal)
+                    pos = Int2(pos.X + offset.X, pos.Y + offset.Y);
+                model.size = size;
+                model.paths = std::move(paths);
+                model.undo.clear();
+                model.redo.clear();
+                model.resized = true;
+            }
+            else if (kind < 0.1f)
+            {
+                const bool undone = nav->Undo();
+                if (undone != !model.undo.empty())
+                    return 1;
+                if (undone)
+                {
+                    model.redo.push_back(std::move(model.paths));
+                    model.paths = std::move(model.undo.back());
+                    model.undo.pop_back();
+                }
+            }
+            else if (kind < 0.2f)
+            {
+                const bool redone = nav->Redo();
+                if (redone != !model.redo.empty())
+                    return 1;
+                if (redone)
+                {
+                    model.undo.push_back(std::move(model.paths));
+                    model.paths = std::move(model.redo.back());
+                    model.redo.pop_back();
+                }
+            }
+            else
+            {
+                // Only the last edit of a tile counts, and changes that end up changing nothing aren't kept
+                // for undo.
+                std::vector<uint8> paths = model.paths;
+                const Int2 center((int)(stream.Rand() * model.size.X), (int)(stream.Rand() * model.size.Y));
+                nav->BeginChange();
+                for (int edit = 0, edits = 1 + (int)(stream.Rand() * 12); edit < edits; ++edit)
+                {
+                    const Int2 pos(std::min(model.size.X - 1, center.X + (int)(stream.Rand() * 4)), std::min(model.size.Y - 1, center.Y + (int)(stream.Rand() * 4)));
+                    const bool add = stream.Rand() < 0.6f;
+                    if (add)
+                        nav->AddPath(pos);
+                    else
+                        nav->RemovePath(pos);
+                    paths[pos.Y * model.size.X + pos.X] = add ? 1 : 0;
+                }
+                nav->EndChange();
+                if (paths != model.paths)
+                {
+                    if (model.undo.size() == MapNavigation::MAX_UNDO_CHANGES)
+                        model.undo.erase(model.undo.begin());
+                    model.undo.push_back(std::move(model.paths));
+                    model.redo.clear();
+                    model.paths = std::move(paths);
+                }
+            }
+
+            const int errors = CompareWithRebuild(*nav, model, stream);
+            if (errors != 0)
+            {
+                std::fprintf(stderr, "The edited navigation doesn't match a rebuilt one after step %d.\n", step);
+                return errors;
+            }
+        }
+        return 0;
+    }
+
+    // Adds visitors that walk into the park through its entries.
+    void SpawnVisitors(VisitorSystem &visitors, std::vector<AnimatedModel> &actors, const Park &park)
+    {
+        const int entryCount = (int)park.entries.size();
+        for (int ix = 0, count = (int)actors.size(); ix < count; ++ix)
+        {
+            const Int2 spawn(park.entries[entryCount - 1], -ENTRY_GRID_DISTANCE);
+            const Int2 entry(park.entries[ix % entryCount], -ENTRY_GRID_DISTANCE);
+            visitors.AddVisitor(&actors[ix], 100.0f + (float)(ix % 7) * 10.0f, spawn, entry);
+        }
+    }
+
+    // Runs one tick of the visitors. The barf animation is over as soon as it starts.
+    void TickVisitors(VisitorSystem &visitors, std::vector<AnimatedModel> &actors)
+    {
+        visitors.OnUpdate();
+        for (AnimatedModel &actor : actors)
+        {
+            if ((bool)actor.GetParameterValue(TEXT("Barfing")))
+                actor.SetParameterValue(TEXT("Barfing"), Variant(false));
+        }
+    }
+
+    // Simulates the visitors on a new copy of the park, and returns the tiles every visitor arrived at in
+    // order. Visitors walk less than a tile in the ticks a far visitor waits for, so no tile is missed.
+    std::vector<std::vector<Int2>> WalkedTiles(const Options &options, int crowd, Camera *camera)
+    {
+        SpawnParams params;
+        auto nav = std::make_unique<MapNavigation>(params);
+        ScriptGlobals::map_navigation = nav.get();
+        Park park;
+        park.size = options.size;
+        RandomizerStream layoutStream = Randomizer::Stream(~0ull);
+        GeneratePark(*nav, park, layoutStream);
+        nav->SetCrowdThreshold(crowd);
+
+        auto visitors = std::make_unique<VisitorSystem>(params);
+        visitors->TickRate = TICK_RATE;
+        std::vector<AnimatedModel> actors(options.visitors);
+        SpawnVisitors(*visitors, actors, park);
+        Camera::main_camera = camera;
+
+        std::vector<std::vector<Int2>> tiles(options.visitors);
+        for (int tick = 0; tick < options.ticks; ++tick)
+        {
+            TickVisitors(*visitors, actors);
+            for (int id = 0; id < options.visitors; ++id)
+            {
+                const Int2 tile = visitors->GetVisitorTile(id);
+                if (tiles[id].empty() || tiles[id].back() != tile)
+                    tiles[id].push_back(tile);
+            }
+        }
+        Camera::main_camera = nullptr;
+        ScriptGlobals::map_navigation = nullptr;
+        return tiles;
+    }
+
+    // Simulates the park with every visitor in full detail, and with the level of detail of a camera at
+    // cameraTile. Returns the number of visitors that picked different tiles, up to where the one that walked
+    // less stopped.
+    int CountTierDifferences(const Options &options, int crowd, Int2 cameraTile)
+    {
+        Camera camera;
+        camera.position = Vector3((float)cameraTile.X * ScriptGlobals::tile_dimension, 1000.0f, (float)cameraTile.Y * ScriptGlobals::tile_dimension);
+        const std::vector<std::vector<Int2>> near = WalkedTiles(options, crowd, nullptr);
+        const std::vector<std::vector<Int2>> mixed = WalkedTiles(options, crowd, &camera);
+        int differences = 0;
+        for (int id = 0; id < options.visitors; ++id)
+        {
+            const size_t count = std::min(near[id].size(), mixed[id].size());
+            differences += std::equal(near[id].begin(), near[id].begin() + count, mixed[id].begin()) ? 0 : 1;
+        }
+        return differences;
+    }
+
+    int RunReplay(const std::wstring &path)
+    {
+        SimReplay replay;
+        if (!replay.Load(path.c_str()))
+            return 1;
+
+        SpawnParams params;
+        auto nav = std::make_unique<MapNavigation>(params);
+        auto visitors = std::make_unique<VisitorSystem>(params);
+        std::deque<AnimatedModel> actors;
+        auto createActor = [&]() -> AnimatedModel*
+        {
+            actors.emplace_back();
+            return &actors.back();
+        };
+
+        // The barf animation ends when the recording says it did.
+        double visitorTicks = 0.0;
+        const Clock::time_point start = Clock::now();
+        while (replay.Step(*nav, *visitors, createActor))
+            visitorTicks += visitors->VisitorCount();
+        const double seconds = Seconds(start, Clock::now());
+
+        std::printf("{\n");
+        std::printf("  \"ticks\": %u,\n", replay.CurrentTick());
+        std::printf("  \"recorded_ticks\": %u,\n", replay.TickCount());
+        std::printf("  \"visitors\": %d,\n", visitors->VisitorCount());
+        std::printf("  \"visitor_state_hash\": \"%016llx\",\n", (unsigned long long)replay.ReplayedStateHash());
+        std::printf("  \"recorded_state_hash\": \"%016llx\",\n", (unsigned long long)replay.RecordedStateHash());
+        std::printf("  \"replay_ms\": %.3f,\n", seconds * 1000.0);
+        std::printf("  \"ns_per_visitor_tick\": %.2f,\n", visitorTicks > 0.0 ? seconds * 1e9 / visitorTicks : 0.0);
+        std::printf("  \"peak_memory_bytes\": %lld\n", (long long)PeakMemory());
+        std::printf("}\n");
+        if (replay.CurrentTick() != replay.TickCount())
+            return 1;
+        if (replay.ReplayedStateHash() != replay.RecordedStateHash())
+        {
+            std::fprintf(stderr, "The replay didn't end in the recorded visitor state.\n");
+            return 1;
+        }
+        return 0;
+    }
+
+    double Percentile(std::vector<int64> &values, double percentile)
+    {
+        if (values.empty())
+            return 0.0;
+        const size_t index = std::min(values.size() - 1, (size_t)(percentile * (double)values.size()));
+        std::nth_element(values.begin(), values.begin() + index, values.end());
+        return (double)values[index];
+    }
+}
+
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        std::fprintf(stderr, "usage: %s [--size N] [--visitors N] [--ticks N] [--picks N] [--changes N] [--crowd N] [--seed N] [--camera X,Z] [--record FILE] [--traffic FILE] [--verify] | --replay FILE\n", argv[0]);
+        return 1;
+    }
+    if (!options.replay.empty())
+        return RunReplay(options.replay);
+
+    Randomizer::SetSeed(options.seed);
+    // Visitors number their streams from 0, so the benchmark takes ids from the other end.
+    RandomizerStream layoutStream = Randomizer::Stream(~0ull);
+    RandomizerStream pickStream = Randomizer::Stream(~0ull - 1);
+    RandomizerStream editStream = Randomizer::Stream(~0ull - 2);
+    if (!options.record.empty())
+        SimRecording::Start();
+
+    SpawnParams params;
+    const int64 memoryBefore = PeakMemory();
+    auto nav = std::make_unique<MapNavigation>(params);
+    ScriptGlobals::map_navigation = nav.get();
+
+    Park park;
+    park.size = options.size;
+    const Clock::time_point buildStart = Clock::now();
+    GeneratePark(*nav, park, layoutStream);
+    const double buildSeconds = Seconds(buildStart, Clock::now());
+    // The goal is only kept up to date to be checked, so it doesn't slow down normal runs.
+    int goal = -1;
+    if (options.verify)
+    {
+        Array<Int2> entryCells;
+        for (int x : park.entries)
+            entryCells.Add(Int2(x, 0));
+        goal = nav->AddGoal(entryCells);
+    }
+    int verifyErrors = options.verify ? VerifyNavigation(*nav, park, goal, 0) : 0;
+    if (options.verify && verifyErrors == 0)
+    {
+        RandomizerStream verifyStream = Randomizer::Stream(~0ull - 3);
+        verifyErrors = VerifyEdits(verifyStream, options.changes);
+    }
+    nav->SetCrowdThreshold(options.crowd);
+    const int64 navMemory = PeakMemory() - memoryBefore;
+
+    // PickTile from random path tiles and directions, on an empty park.
+    const int pathCount = (int)park.path_tiles.size();
+    std::vector<int> pickTiles(4096);
+    for (int &tile : pickTiles)
+        tile = (int)(pickStream.Rand() * pathCount) % pathCount;
+    int64 pickCheck = 0;
+    const Clock::time_point pickStart = Clock::now();
+    for (int ix = 0; ix < options.picks; ++ix)
+    {
+        const Int2 next = nav->PickTile(park.path_tiles[pickTiles[ix & 4095]], (NavDir)(ix & 3), pickStream);
+        pickCheck += next.X + next.Y;
+    }
+    const double pickSeconds = Seconds(pickStart, Clock::now());
+
+    // Visitors walk in through the entries and are simulated one tick per update.
+    auto visitors = std::make_unique<VisitorSystem>(params);
+    std::vector<AnimatedModel> actors(options.visitors);
+    SpawnVisitors(*visitors, actors, park);
+    Camera camera;
+    if (options.camera)
+    {
+        camera.position = Vector3((float)options.camera_tile.X * ScriptGlobals::tile_dimension, 1000.0f, (float)options.camera_tile.Y * ScriptGlobals::tile_dimension);
+        Camera::main_camera = &camera;
+    }
+    visitors->TickRate = TICK_RATE;
+    Time::delta = 1.0f / TICK_RATE;
+    const Clock::time_point tickStart = Clock::now();
+    for (int tick = 0; tick < options.ticks; ++tick)
+        TickVisitors(*visitors, actors);
+    const double tickSeconds = Seconds(tickStart, Clock::now());
+    const uint64 stateHash = visitors->StateHash();
+    int inPark = 0;
+    for (const Int2 &tile : park.path_tiles)
+        inPark += nav->GetOccupancy(tile);
+
+    // Small edits around random tiles, like a player building, while the visitors are on the map.
+    std::vector<int64> changeTimes;
+    changeTimes.reserve(options.changes);
+    for (int ix = 0; ix < options.changes; ++ix)
+    {
+        const Int2 center((int)(editStream.Rand() * park.size), (int)(editStream.Rand() * park.size));
+        const int edits = 1 + (int)(editStream.Rand() * 8);
+        nav->BeginChange();
+        for (int edit = 0; edit < edits; ++edit)
+        {
+            const Int2 pos(std::min(park.size - 1, center.X + (int)(editStream.Rand() * 3)), std::min(park.size - 1, center.Y + (int)(editStream.Rand() * 3)));
+            uint8 &path = park.paths[pos.Y * park.size + pos.X];
+            if (path != 0)
+                nav->RemovePath(pos);
+            else
+                nav->AddPath(pos);
+            path = path != 0 ? 0 : 1;
+        }
+        const Clock::time_point changeStart = Clock::now();
+        nav->EndChange();
+        changeTimes.push_back(Nanoseconds(changeStart, Clock::now()));
+
+        if (options.verify && verifyErrors == 0)
+        {
+            verifyErrors = VerifyNavigation(*nav, park, goal, ix + 1);
+            if (verifyErrors != 0)
+                std::fprintf(stderr, "The navigation doesn't match the paths after change %d.\n", ix);
+        }
+    }
+
+    if (!options.record.empty() && !SimRecording::Stop(options.record.c_str()))
+        std::fprintf(stderr, "Couldn't write the recording.\n");
+    if (!options.traffic.empty() && !nav->SaveTraffic(options.traffic.c_str()))
+        std::fprintf(stderr, "Couldn't write the traffic counters.\n");
+
+    // Without crowds, the level of detail must not change the tiles the visitors pick. Crowded decisions
+    // depend on when the visitors arrive, so their differences are only reported.
+    int crowdedTierDifferences = 0;
+    if (options.verify && verifyErrors == 0)
+    {
+        const Int2 cameraTile = options.camera ? options.camera_tile : Int2(0, 0);
+        verifyErrors = CountTierDifferences(options, 0, cameraTile);
+        if (verifyErrors != 0)
+            std::fprintf(stderr, "%d visitors picked different tiles with the level of detail on.\n", verifyErrors);
+        if (options.crowd > 0)
+            crowdedTierDifferences = CountTierDifferences(options, options.crowd, cameraTile);
+    }
+
+    const double visitorTicks = (double)options.visitors * (double)options.ticks;
+    std::printf("{\n");
+    std::printf("  \"map_size\": %d,\n", options.size);
+    std::printf("  \"path_tiles\": %d,\n", pathCount);
+    std::printf("  \"visitors\": %d,\n", options.visitors);
+    std::printf("  \"ticks\": %d,\n", options.ticks);
+    std::printf("  \"visitors_in_park\": %d,\n", inPark);
+    std::printf("  \"visitor_state_hash\": \"%016llx\",\n", (unsigned long long)stateHash);
+    std::printf("  \"seed\": %llu,\n", (unsigned long long)options.seed);
+    std::printf("  \"build_ms\": %.3f,\n", buildSeconds * 1000.0);
+    std::printf("  \"pick_tile_per_second\": %.0f,\n", pickSeconds > 0.0 ? options.picks / pickSeconds : 0.0);
+    std::printf("  \"ns_per_visitor_tick\": %.2f,\n", visitorTicks > 0.0 ? tickSeconds * 1e9 / visitorTicks : 0.0);
+    std::printf("  \"end_change_ns\": { \"count\": %d, \"p50\": %.0f, \"p90\": %.0f, \"p99\": %.0f, \"max\": %.0f },\n",
+                options.changes, Percentile(changeTimes, 0.5), Percentile(changeTimes, 0.9), Percentile(changeTimes, 0.99), Percentile(changeTimes, 1.0));
+    std::printf("  \"navigation_bytes\": %lld,\n", (long long)navMemory);
+    std::printf("  \"peak_memory_bytes\": %lld,\n", (long long)PeakMemory());
+    if (options.verify)
+    {
+        std::printf("  \"verify_errors\": %d,\n", verifyErrors);
+        std::printf("  \"crowded_tier_differences\": %d,\n", crowdedTierDifferences);
+    }
+    std::printf("  \"checksum\": %lld\n", (long long)pickCheck);
+    std::printf("}\n");
+    return verifyErrors == 0 ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "../Types/BaseTypes.h"
+#include <new>
+#include <algorithm>
+#include <cstdlib>
+
+// Same behavior as the Flax Array where the game relies on it. RemoveAt moves the last item into the
+// removed slot.
+template<typename T>
+class Array
+{
+    T *_data = nullptr;
+    int32 _count = 0;
+    int32 _capacity = 0;
+
+    void Grow(int32 needed)
+    {
+        if (needed <= _capacity)
+            return;
+        const int32 capacity = std::max(needed, _capacity * 2 + 4);
+        T *data = (T*)std::malloc(sizeof(T) * capacity);
+        for (int32 ix = 0; ix < _count; ++ix)
+        {
+            new (data + ix) T(std::move(_data[ix]));
+            _data[ix].~T();
+        }
+        std::free(_data);
+        _data = data;
+        _capacity = capacity;
+    }
+public:
+    Array() {}
+    explicit Array(int32 capacity) { Grow(capacity); }
+    Array(std::initializer_list<T> items) { Grow((int32)items.size()); for (const T &item : items) new (_data + _count++) T(item); }
+    Array(const T *data, int32 count) { Add(data, count); }
+    Array(const Array &other) { Add(other._data, other._count); }
+    Array(Array &&other) noexcept { Swap(other); }
+    ~Array() { Clear(); std::free(_data); }
+
+    Array& operator=(const Array &other) { if (this != &other) { Clear(); Add(other._data, other._count); } return *this; }
+    Array& operator=(Array &&other) noexcept { Swap(other); return *this; }
+
+    int32 Count() const { return _count; }
+    int32 Capacity() const { return _capacity; }
+    bool IsEmpty() const { return _count == 0; }
+    bool HasItems() const { return _count != 0; }
+    T* Get() { return _data; }
+    const T* Get() const { return _data; }
+    T& operator[](int32 index) { return _data[index]; }
+    const T& operator[](int32 index) const { return _data[index]; }
+    T& At(int32 index) { return _data[index]; }
+    T& First() { return _data[0]; }
+    T& Last() { return _data[_count - 1]; }
+    const T& Last() const { return _data[_count - 1]; }
+
+    void Add(const T &item) { T copy(item); Grow(_count + 1); new (_data + _count++) T(std::move(copy)); }
+    void Add(T &&item) { T moved(std::move(item)); Grow(_count + 1); new (_data + _count++) T(std::move(moved)); }
+    void Add(const T *data, int32 count) { Grow(_count + count); for (int32 ix = 0; ix < count; ++ix) new (_data + _count++) T(data[ix]); }
+    void Add(const Array &other) { Add(other._data, other._count); }
+    T& AddOne() { Grow(_count + 1); new (_data + _count) T(); return _data[_count++]; }
+    void AddDefault(int32 count = 1) { Grow(_count + count); for (int32 ix = 0; ix < count; ++ix) new (_data + _count++) T(); }
+    void AddUninitialized(int32 count) { AddDefault(count); }
+    void AddZeroed(int32 count) { Grow(_count + count); std::memset((void*)(_data + _count), 0, sizeof(T) * count); _count += count; }
+    void Insert(int32 index, const T &item) { Add(item); for (int32 ix = _count - 1; ix > index; --ix) std::swap(_data[ix], _data[ix - 1]); }
+
+    void Clear() { for (int32 ix = 0; ix < _count; ++ix) _data[ix].~T(); _count = 0; }
+    void Resize(int32 count, bool /*preserve*/ = true)
+    {
+        if (count < _count)
+        {
+            for (int32 ix = count; ix < _count; ++ix)
+                _data[ix].~T();
+            _count = count;
+        }
+        else
+            AddDefault(count - _count);
+    }
+    void EnsureCapacity(int32 capacity, bool preserve = true) { Grow(capacity); }
+    void SetCapacity(int32 capacity, bool /*preserve*/ = true) { Grow(capacity); }
+    void SetAll(const T &item) { for (int32 ix = 0; ix < _count; ++ix) _data[ix] = item; }
+
+    void RemoveAt(int32 index) { if (index != _count - 1) _data[index] = std::move(_data[_count - 1]); _data[--_count].~T(); }
+    void RemoveAtKeepOrder(int32 index) { for (int32 ix = index; ix < _count - 1; ++ix) _data[ix] = std::move(_data[ix + 1]); _data[--_count].~T(); }
+    void RemoveLast() { _data[--_count].~T(); }
+    bool Remove(const T &item) { const int32 index = Find(item); if (index < 0) return false; RemoveAt(index); return true; }
+    int32 Find(const T &item) const { for (int32 ix = 0; ix < _count; ++ix) if (_data[ix] == item) return ix; return -1; }
+    bool Contains(const T &item) const { return Find(item) >= 0; }
+    void Push(const T &item) { Add(item); }
+    T Pop() { T item = std::move(_data[_count - 1]); RemoveLast(); return item; }
+    void Reverse() { std::reverse(_data, _data + _count); }
+    void Swap(Array &other) { std::swap(_data, other._data); std::swap(_count, other._count); std::swap(_capacity, other._capacity); }
+
+    T* begin() { return _data; }
+    T* end() { return _data + _count; }
+    const T* begin() const { return _data; }
+    const T* end() const { return _data + _count; }
+    operator Span<T>() { return Span<T>(_data, _count); }
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Array.h"
+#include "../Math/Vector2.h"
+#include <unordered_set>
+
+template<typename T>
+struct ShimHash
+{
+    size_t operator()(const T &item) const { return std::hash<T>()(item); }
+};
+
+template<>
+struct ShimHash<Int2>
+{
+    size_t operator()(const Int2 &item) const { return (size_t)(uint32)item.X * 73856093u ^ (size_t)(uint32)item.Y; }
+};
+
+template<typename T>
+class HashSet
+{
+    std::unordered_set<T, ShimHash<T>> _items;
+public:
+    bool Add(const T &item) { return _items.insert(item).second; }
+    bool Contains(const T &item) const { return _items.count(item) != 0; }
+    bool Remove(const T &item) { return _items.erase(item) != 0; }
+    void Clear() { _items.clear(); }
+    int32 Count() const { return (int32)_items.size(); }
+    auto begin() const { return _items.begin(); }
+    auto end() const { return _items.end(); }
+};
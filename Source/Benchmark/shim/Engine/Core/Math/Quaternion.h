@@ -0,0 +1,11 @@
+#pragma once
+
+#include "Vector3.h"
+
+struct Quaternion
+{
+    float X, Y, Z, W;
+
+    Quaternion() : X(0.0f), Y(0.0f), Z(0.0f), W(1.0f) {}
+    Quaternion(float x, float y, float z, float w) : X(x), Y(y), Z(z), W(w) {}
+};
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "Vector3.h"
+#include "Quaternion.h"
+
+struct Transform
+{
+    Vector3 Translation;
+    Quaternion Orientation;
+    Float3 Scale = Float3(1.0f, 1.0f, 1.0f);
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "../Types/BaseTypes.h"
+
+struct Int2
+{
+    int32 X, Y;
+
+    Int2() : X(0), Y(0) {}
+    Int2(int32 x, int32 y) : X(x), Y(y) {}
+    explicit Int2(int32 value) : X(value), Y(value) {}
+
+    Int2 operator+(const Int2 &other) const { return Int2(X + other.X, Y + other.Y); }
+    Int2 operator-(const Int2 &other) const { return Int2(X - other.X, Y - other.Y); }
+    bool operator==(const Int2 &other) const { return X == other.X && Y == other.Y; }
+    bool operator!=(const Int2 &other) const { return !(*this == other); }
+
+    static const Int2 Zero;
+};
+inline const Int2 Int2::Zero = Int2(0, 0);
+
+struct Float2
+{
+    float X, Y;
+
+    Float2() : X(0.0f), Y(0.0f) {}
+    Float2(float x, float y) : X(x), Y(y) {}
+
+    Float2 operator+(const Float2 &other) const { return Float2(X + other.X, Y + other.Y); }
+    Float2 operator-(const Float2 &other) const { return Float2(X - other.X, Y - other.Y); }
+    Float2 operator/(const Float2 &other) const { return Float2(X / other.X, Y / other.Y); }
+    Float2 operator*(float scale) const { return Float2(X * scale, Y * scale); }
+};
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "Vector2.h"
+
+struct Float3
+{
+    float X, Y, Z;
+
+    Float3() : X(0.0f), Y(0.0f), Z(0.0f) {}
+    Float3(float x, float y, float z) : X(x), Y(y), Z(z) {}
+
+    Float3 operator+(const Float3 &other) const { return Float3(X + other.X, Y + other.Y, Z + other.Z); }
+    Float3 operator-(const Float3 &other) const { return Float3(X - other.X, Y - other.Y, Z - other.Z); }
+    Float3 operator*(float scale) const { return Float3(X * scale, Y * scale, Z * scale); }
+
+    static const Float3 Zero;
+};
+inline const Float3 Float3::Zero = Float3(0.0f, 0.0f, 0.0f);
+
+typedef Float3 Vector3;
@@ -0,0 +1,31 @@
+#pragma once
+
+// Minimal stand-ins for the Flax Engine types the navigation code uses, so it can be built and measured
+// without the engine. Only what the game code needs is implemented.
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <initializer_list>
+
+typedef uint8_t uint8;
+typedef int8_t int8;
+typedef uint16_t uint16;
+typedef int16_t int16;
+typedef uint32_t uint32;
+typedef int32_t int32;
+typedef uint64_t uint64;
+typedef int64_t int64;
+typedef uint8 byte;
+typedef wchar_t Char;
+
+#define TEXT(x) L##x
+#define FORCE_INLINE inline
+#define GAME_API
+// Unlike the engine's release builds, the benchmark keeps assertions on, so broken state stops the run.
+#define ASSERT(expression) do { if (!(expression)) { std::fprintf(stderr, "Assertion failed: %s (%s:%d)\n", #expression, __FILE__, __LINE__); std::abort(); } } while (0)
+
+#include "Span.h"
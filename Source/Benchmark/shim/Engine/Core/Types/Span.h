@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+template<typename T>
+class Span
+{
+    T *_data;
+    int32_t _length;
+public:
+    Span() : _data(nullptr), _length(0) {}
+    Span(T *data, int32_t length) : _data(data), _length(length) {}
+
+    T* Get() const { return _data; }
+    int32_t Length() const { return _length; }
+    bool IsValid() const { return _data != nullptr; }
+    T& operator[](int32_t index) const { return _data[index]; }
+    T* begin() const { return _data; }
+    T* end() const { return _data + _length; }
+};
+
+template<typename T>
+inline Span<T> ToSpan(T *data, int32_t length)
+{
+    return Span<T>(data, length);
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "BaseTypes.h"
+#include <cwchar>
+
+class StringView
+{
+    const Char *_data;
+public:
+    StringView(const Char *data) : _data(data) {}
+
+    const Char* Get() const { return _data; }
+    int32 Length() const { return (int32)std::wcslen(_data); }
+    const Char& operator[](int32 index) const { return _data[index]; }
+};
@@ -0,0 +1,11 @@
+#pragma once
+
+// Only holds the booleans used for animation parameters.
+struct Variant
+{
+    bool AsBool = false;
+
+    Variant() {}
+    explicit Variant(bool value) : AsBool(value) {}
+    explicit operator bool() const { return AsBool; }
+};
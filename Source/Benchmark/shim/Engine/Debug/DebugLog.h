@@ -0,0 +1,13 @@
+#pragma once
+
+#include "../Core/Types/BaseTypes.h"
+#include <cstdio>
+
+// Messages go to stderr, so they don't mix with the benchmark results.
+class DebugLog
+{
+public:
+    static void Log(const Char *message) { std::fwprintf(stderr, L"%ls\n", message); }
+    static void LogWarning(const Char *message) { std::fwprintf(stderr, L"Warning: %ls\n", message); }
+    static void LogError(const Char *message) { std::fwprintf(stderr, L"Error: %ls\n", message); }
+};
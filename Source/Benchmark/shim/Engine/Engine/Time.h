@@ -0,0 +1,10 @@
+#pragma once
+
+// The frame time is set by the benchmark before every update.
+class Time
+{
+public:
+    static inline float delta = 1.0f / 60.0f;
+
+    static float GetDeltaTime() { return delta; }
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "../../Core/Math/Transform.h"
+#include "../../Core/Types/Variant.h"
+
+// Keeps the transform and the two animation parameters the visitors use.
+class AnimatedModel
+{
+public:
+    Transform GetTransform() const { return _transform; }
+    void SetTransform(const Transform &transform) { _transform = transform; }
+
+    const Variant& GetParameterValue(const Char *name) const { return IsBarfing(name) ? _barfing : _walking; }
+    void SetParameterValue(const Char *name, const Variant &value) { (IsBarfing(name) ? _barfing : _walking) = value; }
+
+private:
+    static bool IsBarfing(const Char *name) { return name[0] == L'B'; }
+
+    Transform _transform;
+    Variant _walking;
+    Variant _barfing;
+};
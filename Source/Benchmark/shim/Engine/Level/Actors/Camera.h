@@ -0,0 +1,16 @@
+#pragma once
+
+#include "../../Core/Math/Vector3.h"
+
+// The benchmark places the main camera to choose which visitors are near, or leaves it out to simulate
+// every visitor in full.
+class Camera
+{
+public:
+    static inline Camera *main_camera = nullptr;
+
+    static Camera* GetMainCamera() { return main_camera; }
+    Vector3 GetPosition() const { return position; }
+
+    Vector3 position;
+};
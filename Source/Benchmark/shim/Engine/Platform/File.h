@@ -0,0 +1,47 @@
+#pragma once
+
+#include "../Core/Types/StringView.h"
+#include "../Core/Collections/Array.h"
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// Like the engine, the functions return true if they failed.
+class File
+{
+public:
+    static bool ReadAllBytes(const StringView &path, Array<byte> &data)
+    {
+        std::FILE *file = std::fopen(NarrowPath(path).c_str(), "rb");
+        if (file == nullptr)
+            return true;
+        std::fseek(file, 0, SEEK_END);
+        const long length = std::ftell(file);
+        std::fseek(file, 0, SEEK_SET);
+        data.Clear();
+        data.AddZeroed((int32)std::max(length, 0L));
+        const bool failed = length < 0 || std::fread(data.Get(), 1, data.Count(), file) != (size_t)data.Count();
+        std::fclose(file);
+        return failed;
+    }
+
+    static bool WriteAllBytes(const StringView &path, const Array<byte> &data)
+    {
+        std::FILE *file = std::fopen(NarrowPath(path).c_str(), "wb");
+        if (file == nullptr)
+            return true;
+        const bool failed = std::fwrite(data.Get(), 1, data.Count(), file) != (size_t)data.Count();
+        return std::fclose(file) != 0 || failed;
+    }
+
+private:
+    static std::string NarrowPath(const StringView &path)
+    {
+        std::string result(path.Length() * MB_LEN_MAX, '\0');
+        const size_t length = std::wcstombs(&result[0], path.Get(), result.size());
+        result.resize(length == (size_t)-1 ? 0 : length);
+        return result;
+    }
+};
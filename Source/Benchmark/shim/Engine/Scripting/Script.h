@@ -0,0 +1,35 @@
+#pragma once
+
+#include "../Core/Types/BaseTypes.h"
+#include "../Core/Collections/Array.h"
+#include "../Core/Math/Vector2.h"
+
+#define API_ENUM(...)
+#define API_CLASS(...)
+#define API_STRUCT(...)
+#define API_FUNCTION(...)
+#define API_FIELD(...)
+#define API_PROPERTY(...)
+#define API_PARAM(...)
+#define API_AUTO_SERIALIZATION()
+#define DECLARE_SCRIPTING_TYPE(type) public: explicit type(const SpawnParams& params);
+#define DECLARE_SCRIPTING_TYPE_STRUCTURE(type)
+#define DECLARE_SCRIPTING_TYPE_MINIMAL(type) public:
+
+struct SpawnParams
+{
+};
+
+class Script
+{
+public:
+    explicit Script(const SpawnParams &/*params*/) {}
+    virtual ~Script() {}
+
+    virtual void OnAwake() {}
+    virtual void OnStart() {}
+    virtual void OnUpdate() {}
+    virtual void OnDestroy() {}
+protected:
+    bool _tickUpdate = false;
+};
@@ -0,0 +1,9 @@
+#pragma once
+
+template<typename T>
+class ScriptingObjectReference
+{
+    T *_object = nullptr;
+public:
+    T* Get() const { return _object; }
+};
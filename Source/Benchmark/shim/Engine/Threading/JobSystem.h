@@ -0,0 +1,54 @@
+#pragma once
+
+#include "../Core/Types/BaseTypes.h"
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+template<typename Signature>
+class Function;
+
+template<typename Result, typename... Args>
+class Function<Result(Args...)>
+{
+    std::function<Result(Args...)> _function;
+public:
+    Function() {}
+    template<typename Callable>
+    Function(const Callable &callable) : _function(callable) {}
+
+    Result operator()(Args... args) const { return _function(args...); }
+};
+
+// Runs the jobs of a dispatch on a thread per core and finishes them before returning, so Wait has
+// nothing left to do.
+class JobSystem
+{
+public:
+    static int64 Dispatch(const Function<void(int32)> &job, int32 jobCount = 1)
+    {
+        const int32 threadCount = std::min(jobCount, GetThreadsCount());
+        std::atomic<int32> next(0);
+        auto worker = [&]()
+        {
+            for (int32 ix = next++; ix < jobCount; ix = next++)
+                job(ix);
+        };
+        std::vector<std::thread> threads;
+        for (int32 ix = 1; ix < threadCount; ++ix)
+            threads.emplace_back(worker);
+        worker();
+        for (std::thread &thread : threads)
+            thread.join();
+        return 0;
+    }
+
+    static void Wait(int64 /*label*/) {}
+
+    static int32 GetThreadsCount()
+    {
+        return std::max(1, (int32)std::thread::hardware_concurrency());
+    }
+};
@@ -1,29 +1,166 @@
 ﻿#include "map_navigation.h"
+#include "nav_snapshot.h"
+#include "sim_recording.h"
 #include "Engine/Debug/DebugLog.h"
+#include "Engine/Threading/JobSystem.h"
+#include "Engine/Engine/Time.h"
 #include "../util/randomizer.h"
 
+#include <algorithm>
+#include <cstring>
+
 
 MapNavigation::MapNavigation(const SpawnParams& params)
-    : Script(params), map_size(0, 0), change_type(ChangeType::None), changing(false)
+    : Script(params), map_size(0, 0), map_origin(0, 0), chunk_count(0, 0), changing(false), next_goal_id(0), crowd_threshold(0),
+      published(nullptr), pinning(0), snapshot_version(0)
 {
     // Enable ticking OnUpdate function
-    //_tickUpdate = true;
+    _tickUpdate = true;
+
+    PublishSnapshot();
+}
 
+MapNavigation::~MapNavigation()
+{
+    // Snapshots must not be used after the navigation is destroyed.
+    delete published.load();
+    for (NavSnapshot *snapshot : retired_snapshots)
+        delete snapshot;
+}
+
+void MapNavigation::OnUpdate()
+{
+    dirt.Advance(*this, Time::GetDeltaTime());
+    ReclaimSnapshots();
 }
 
-// Call it only at the creation of the map. Any other time and it causes undefined behavior.
+// Call it only at the creation of the map. Any other time and it causes undefined behavior. Use ResizeMap
+// to change the size of an existing map.
 void MapNavigation::SetMapData(Int2 size)
 {
+    SimRecording::RecordMapData(size);
     map_size = size;
-    if (map_size.X > 0 && map_size.Y > 0)
+    if (map_size.X <= 0 || map_size.Y <= 0)
+        map_size = Int2(0, 0);
+
+    // Chunks are only allocated when paths are added to them.
+    map_origin = Int2(0, 0);
+    chunk_count = Int2((map_size.X + CHUNK_SIZE - 1) >> CHUNK_SHIFT, (map_size.Y + CHUNK_SIZE - 1) >> CHUNK_SHIFT);
+    chunk_slots.Clear();
+    chunk_slots.AddUninitialized(chunk_count.X * chunk_count.Y);
+    chunk_slots.SetAll(NO_CHUNK);
+    slot_chunks.Clear();
+    slot_path_counts.Clear();
+    free_slots.Clear();
+    cell_types.Clear();
+    path_types.Clear();
+    turn_contexts.Clear();
+    update_bits.Clear();
+    snapshot_dirty.Clear();
+    undo_records.Clear();
+    redo_records.Clear();
+
+    for (auto &field : flow_fields)
+        field.second.Rebuild(*this);
+    hierarchy.Rebuild(*this);
+    corridors.Rebuild(*this);
+    components.Rebuild(*this);
+    dirt.Rebuild(*this);
+    crowd.Rebuild(*this);
+#if NAV_TRAFFIC_STATS
+    traffic.Reset(*this);
+#endif
+    PublishSnapshot();
+}
+
+void MapNavigation::ResizeMap(Int2 newSize, Int2 offset)
+{
+    if (changing)
     {
-        map_cells.AddZeroed(map_size.X * map_size.Y);
+        DebugLog::LogError(TEXT("Can't resize navigation while changing it."));
+        return;
     }
-    else
+    if (newSize.X <= 0 || newSize.Y <= 0)
     {
-        map_size = Int2(0, 0);
-        map_cells.Clear();
+        DebugLog::LogError(TEXT("Navigation map size must be positive."));
+        return;
     }
+    SimRecording::RecordResize(newSize, offset);
+
+    // Paths that end up outside the map are removed first like any other change, so every part of the
+    // navigation updates around them. Only chunks crossing the new borders have cells to check.
+    const Int2 keepMin(-offset.X, -offset.Y);
+    const Int2 keepMax(newSize.X - offset.X, newSize.Y - offset.Y);
+    Array<Int2> removed;
+    for (int32 slot = 0; slot < ChunkSlotCount(); ++slot)
+    {
+        if (!SlotUsed(slot))
+            continue;
+        const Int2 origin = ChunkOrigin(slot);
+        if (origin.X >= keepMin.X && origin.Y >= keepMin.Y && origin.X + CHUNK_SIZE <= keepMax.X && origin.Y + CHUNK_SIZE <= keepMax.Y)
+            continue;
+        for (int local = 0; local < CHUNK_CELLS; ++local)
+        {
+            const Int2 pos(origin.X + (local & (CHUNK_SIZE - 1)), origin.Y + (local >> CHUNK_SHIFT));
+            if (pos.X >= keepMin.X && pos.Y >= keepMin.Y && pos.X < keepMax.X && pos.Y < keepMax.Y)
+                continue;
+            if (GetCellType(slot * CHUNK_CELLS + local) != CellType::Empty)
+                removed.Add(pos);
+        }
+    }
+    if (removed.Count() != 0)
+        ApplyChanges(Array<Int2>(), removed);
+
+    // Recorded changes refer to positions before the resize.
+    undo_records.Clear();
+    redo_records.Clear();
+
+    // Cells stay in their chunks, only the origin moves. It's kept inside the first chunk by moving the
+    // chunk coordinates by whole chunks.
+    const Int2 oldSize = map_size;
+    Int2 origin(map_origin.X - offset.X, map_origin.Y - offset.Y);
+    const Int2 chunkShift(origin.X >> CHUNK_SHIFT, origin.Y >> CHUNK_SHIFT);
+    origin = Int2(origin.X - chunkShift.X * CHUNK_SIZE, origin.Y - chunkShift.Y * CHUNK_SIZE);
+
+    map_size = newSize;
+    map_origin = origin;
+    chunk_count = Int2((map_size.X + map_origin.X + CHUNK_SIZE - 1) >> CHUNK_SHIFT, (map_size.Y + map_origin.Y + CHUNK_SIZE - 1) >> CHUNK_SHIFT);
+    chunk_slots.Clear();
+    chunk_slots.AddUninitialized(chunk_count.X * chunk_count.Y);
+    chunk_slots.SetAll(NO_CHUNK);
+    for (int32 slot = 0; slot < ChunkSlotCount(); ++slot)
+    {
+        if (!SlotUsed(slot))
+            continue;
+        Int2 &chunk = slot_chunks[slot];
+        chunk = Int2(chunk.X - chunkShift.X, chunk.Y - chunkShift.Y);
+        chunk_slots[chunk.Y * chunk_count.X + chunk.X] = slot;
+    }
+
+    for (auto &field : flow_fields)
+        field.second.Move(offset);
+    hierarchy.Resize(*this, offset);
+    corridors.Move(offset);
+    components.Move(offset);
+
+    // Cells on the old border had no neighbors outside the map, which only changes for the sides that grew.
+    update_cells.Clear();
+    auto updateBorder = [&](Int2 start, Int2 step, int length) {
+        for (int ix = 0; ix < length; ++ix)
+        {
+            Int2 pos(start.X + step.X * ix, start.Y + step.Y * ix);
+            if (!ValidPos(pos))
+                continue;
+            UpdatePathType(pos);
+            update_cells.Add(pos);
+        }
+    };
+    updateBorder(offset, Int2(1, 0), oldSize.X);
+    updateBorder(Int2(offset.X, offset.Y + oldSize.Y - 1), Int2(1, 0), oldSize.X);
+    updateBorder(offset, Int2(0, 1), oldSize.Y);
+    updateBorder(Int2(offset.X + oldSize.X - 1, offset.Y), Int2(0, 1), oldSize.Y);
+    RefreshContexts(update_cells);
+    PublishSnapshot();
 }
 
 void MapNavigation::AddPath(Int2 pos)
@@ -33,277 +170,559 @@ void MapNavigation::AddPath(Int2 pos)
         DebugLog::LogError(TEXT("Trying to add to navigation when not in change."));
         return;
     }
+    if (ValidPos(pos))
+        edits.Add({ pos, true });
+}
 
-    if (change_type == ChangeType::None)
-        change_type = ChangeType::Adding;
-    else if (change_type != ChangeType::Adding)
+void MapNavigation::RemovePath(Int2 pos)
+{
+    if (!changing)
     {
-        if (change_type != ChangeType::Invalid)
-            DebugLog::LogError(TEXT("Cannot add and remove cells in the same operation."));
-        change_type = ChangeType::Invalid;
+        DebugLog::LogError(TEXT("Trying to remove to navigation when not in change."));
         return;
     }
+    if (ValidPos(pos))
+        edits.Add({ pos, false });
+}
 
-    int index = CellIndex(pos);
-    if (index < 0)
-        return;
-    if (map_cells[index].cell_type == CellType::Empty)
-        changes.Add(pos);
+void MapNavigation::BeginChange()
+{
+    if (changing)
+        DebugLog::LogError(TEXT("Already changing navigation."));
+    changing = true;
 }
 
-void MapNavigation::RemovePath(Int2 pos)
+void MapNavigation::EndChange()
 {
     if (!changing)
     {
-        DebugLog::LogError(TEXT("Trying to remove to navigation when not in change."));
+        DebugLog::LogError(TEXT("Can't end change when not changing navigation."));
+        edits.Clear();
         return;
     }
+    changing = false;
+    SimRecording::RecordChange(*this);
 
-    if (change_type == ChangeType::None)
-        change_type = ChangeType::Removing;
-    else if (change_type != ChangeType::Removing)
+    // Only the last edit of each cell counts, and only if it changes the cell. The sort keeps the edits of
+    // a cell in the order they were made.
+    std::stable_sort(edits.Get(), edits.Get() + edits.Count(), [](const PathEdit &a, const PathEdit &b) {
+        return a.pos.Y != b.pos.Y ? a.pos.Y < b.pos.Y : a.pos.X < b.pos.X;
+    });
+    ChangeRecord record;
+    for (int ix = 0; ix < edits.Count(); ++ix)
     {
-        if (change_type != ChangeType::Invalid)
-            DebugLog::LogError(TEXT("Cannot add and remove cells in the same operation."));
-        change_type = ChangeType::Invalid;
+        const PathEdit &edit = edits[ix];
+        if (ix + 1 < edits.Count() && edits[ix + 1].pos == edit.pos)
+            continue;
+        if (edit.add != IsPathAt(edit.pos))
+            (edit.add ? record.added : record.removed).Add(edit.pos);
+    }
+    edits.Clear();
+    if (record.added.Count() == 0 && record.removed.Count() == 0)
         return;
+
+    ApplyChanges(record.added, record.removed);
+    redo_records.Clear();
+    if (undo_records.Count() == MAX_UNDO_CHANGES)
+        undo_records.RemoveAtKeepOrder(0);
+    undo_records.Add(std::move(record));
+}
+
+bool MapNavigation::Undo()
+{
+    if (changing)
+    {
+        DebugLog::LogError(TEXT("Can't undo while changing navigation."));
+        return false;
     }
+    SimRecording::RecordUndo();
+    if (undo_records.Count() == 0)
+        return false;
 
-    int index = CellIndex(pos);
-    if (index < 0)
-        return;
-    if (map_cells[index].cell_type != CellType::Empty)
-        changes.Add(pos);
+    ChangeRecord record = std::move(undo_records.Last());
+    undo_records.RemoveLast();
+    ApplyChanges(record.removed, record.added);
+    redo_records.Add(std::move(record));
+    return true;
 }
 
-void MapNavigation::BeginChange()
+bool MapNavigation::Redo()
 {
     if (changing)
-        DebugLog::LogError(TEXT("Already changing navigation."));
-    changing = true;
+    {
+        DebugLog::LogError(TEXT("Can't redo while changing navigation."));
+        return false;
+    }
+    SimRecording::RecordRedo();
+    if (redo_records.Count() == 0)
+        return false;
+
+    ChangeRecord record = std::move(redo_records.Last());
+    redo_records.RemoveLast();
+    ApplyChanges(record.added, record.removed);
+    undo_records.Add(std::move(record));
+    return true;
 }
 
-void MapNavigation::EndChange()
+void MapNavigation::ApplyChanges(const Array<Int2> &added, const Array<Int2> &removed)
 {
-    if (!changing || changes.Count() == 0 || change_type == ChangeType::None || change_type == ChangeType::Invalid)
+    // Removed cells are cleared first, so a chunk that loses and gains paths in the same change is only
+    // released if it ends up empty.
+    changes.Clear();
+    for (Int2 pos : removed)
     {
-        if (!changing)
-            DebugLog::LogError(TEXT("Can't end change when not changing navigation."));
-        changing = false;
-        changes.Clear();
-        change_type = ChangeType::None;
-        return;
+        ClearCell(CellIndex(pos));
+        changes.Add(pos);
+    }
+    for (Int2 pos : added)
+    {
+        int index = CellIndex(pos);
+        if (index == -1)
+        {
+            allocated_slots.Add(AllocateChunk(ChunkOf(pos)));
+            index = CellIndex(pos);
+        }
+        SetCell(index, CellType::Path);
+        changes.Add(pos);
     }
 
+    // Every changed cell and its neighbors are updated once, after all the cells were changed.
+    update_cells.Clear();
     for (Int2 pos : changes)
+    {
+        for (int y = pos.Y - 1; y <= pos.Y + 1; ++y)
+        {
+            for (int x = pos.X - 1; x <= pos.X + 1; ++x)
+            {
+                int index = CellIndex(Int2(x, y));
+                if (index == -1 || (update_bits[index >> 6] & (1ull << (index & 63))) != 0)
+                    continue;
+                update_bits[index >> 6] |= 1ull << (index & 63);
+                update_cells.Add(Int2(x, y));
+            }
+        }
+    }
+    for (Int2 pos : update_cells)
     {
         int index = CellIndex(pos);
-        if (change_type == ChangeType::Adding && map_cells[index].cell_type == CellType::Empty)
-            SetCell(index, CellType::Path);
-        else if (change_type == ChangeType::Removing && map_cells[index].cell_type != CellType::Empty)
-            ClearCell(index);
+        update_bits[index >> 6] &= ~(1ull << (index & 63));
+        UpdatePathType(pos);
     }
 
-    HashSet<Int2> updated;
+    for (auto &field : flow_fields)
+        field.second.Update(*this, changes);
+    hierarchy.Update(*this, changes);
+    corridors.Update(*this, changes);
+    components.Update(*this, changes);
+    dirt.Update(*this, changes);
 
-    Array<Int2> directions = { Int2(1, 0), Int2(-1, 0), Int2(0, 1), Int2(0, -1),
-            Int2(1, 1), Int2(-1, -1), Int2(-1, 1), Int2(1, -1), };
+    // Emptied chunks are only released after every part of the navigation was updated, as they still
+    // look up the removed cells.
+    for (int32 slot : emptied_slots)
+    {
+        if (slot < slot_path_counts.Count() && SlotUsed(slot) && slot_path_counts[slot] == 0)
+            ReleaseChunk(slot);
+    }
+    emptied_slots.Clear();
 
-    for (Int2 pos : changes)
+    // Cells of new chunks next to other chunks can have paths around them without being near a change.
+    for (int32 slot : allocated_slots)
     {
-        if (change_type == ChangeType::Adding)
-            UpdatePathType(pos, updated);
-        for (Int2 dir : directions)
-            UpdatePathType(pos + dir, updated);
+        if (!SlotUsed(slot))
+            continue;
+        const Int2 origin = ChunkOrigin(slot);
+        for (int ix = 0; ix < CHUNK_SIZE; ++ix)
+        {
+            update_cells.Add(Int2(origin.X + ix, origin.Y));
+            update_cells.Add(Int2(origin.X + ix, origin.Y + CHUNK_SIZE - 1));
+            update_cells.Add(Int2(origin.X, origin.Y + ix));
+            update_cells.Add(Int2(origin.X + CHUNK_SIZE - 1, origin.Y + ix));
+        }
     }
+    allocated_slots.Clear();
+    RefreshContexts(update_cells);
 
-    changing = false;
-    change_type = ChangeType::None;
     changes.Clear();
+    PublishSnapshot();
 }
 
 Int2 MapNavigation::PickTile(Int2 pos, NavDir dir)
 {
+    const NavSnapshot *snapshot = published.load(std::memory_order_relaxed);
     if (pos.Y < 0)
+        return snapshot->EnterTile(pos, dir);
+
+    dirt.Add(*this, pos, FOOTSTEP_DIRT);
+    const int entryIndex = snapshot->TurnIndex(pos, dir);
+    const TurnEntry &entry = turn_table.entries[entryIndex];
+    const int outcome = entry.fixed != TURN_RANDOM ? entry.fixed : snapshot->RandomOutcome(pos, entry, Randomizer::Rand());
+#if NAV_TRAFFIC_STATS
+    traffic.AddDecision(entryIndex, outcome);
+#endif
+    return OutcomeTile(pos, outcome);
+}
+
+void MapNavigation::PickBlocks(int count, const Function<void(int32, int32)>& pickRange)
+{
+    constexpr int PICK_BLOCK_SIZE = 256;
+    auto pickBlock = [&](int32 block)
     {
-        Int2 nextCell = ForwardFrom(pos, dir);
-        int index = CellIndex(nextCell);
-        // First time entering:
-        if (index == -1 || map_cells[index].cell_type == CellType::Empty)
-            return pos;
-        return nextCell;
-    }
+        pickRange(block * PICK_BLOCK_SIZE, std::min(count, (block + 1) * PICK_BLOCK_SIZE));
+    };
 
-    int cindex = CellIndex(pos);
-    PathType upCell = pos.Y >= map_size.Y - 1 ? PathType::Empty : GetPathType(cindex + map_size.X);
-    PathType downCell = pos.Y == 0 ? PathType::Empty : GetPathType(cindex - map_size.X);
-    PathType leftCell = pos.X == 0 ? PathType::Empty : GetPathType(cindex - 1);
-    PathType rightCell = pos.X >= map_size.X - 1 ? PathType::Empty : GetPathType(cindex + 1);
+    const int blockCount = (count + PICK_BLOCK_SIZE - 1) / PICK_BLOCK_SIZE;
+    if (blockCount > 1)
+        JobSystem::Wait(JobSystem::Dispatch(Function<void(int32)>(pickBlock), blockCount));
+    else if (blockCount == 1)
+        pickBlock(0);
+}
+
+void MapNavigation::PickTiles(const Span<Int2>& positions, const Span<NavDir>& dirs, Span<Int2> results)
+{
+    const int count = positions.Length();
+    if (dirs.Length() < count || results.Length() < count)
+    {
+        DebugLog::LogError(TEXT("PickTiles needs a direction and a result slot for every position."));
+        return;
+    }
 
-    const float MIDDLE_TURN_PROBABILITY = 0.1f;
-    const float INNER_CORNER_TURN_PROBABILITY = 0.2f;
-    const float CROSSING_TURN_PROBABILITY = 0.25f;
+    // Decisions that don't need a random number only read the map, so they are computed in parallel
+    // for the whole batch. The rest are computed afterwards in the order of the batch. This way the
+    // random stream is used in the same order as if PickTile was called for every visitor one by one.
+    pick_entries.Clear();
+    pick_entries.AddUninitialized(count);
 
-    switch (GetPathType(cindex))
+    const NavSnapshot *snapshot = published.load(std::memory_order_relaxed);
+    PickBlocks(count, [&](int32 from, int32 to)
     {
-        // Path cell on each side, including diagonals. Low probability of turning.
-        case PathType::Middle:
-            if (Randomizer::Rand() < MIDDLE_TURN_PROBABILITY)
+        for (int ix = from; ix < to; ++ix)
+        {
+            pick_entries[ix] = -1;
+            if (positions[ix].Y < 0)
             {
-                float dirRng = Randomizer::Rand();
-                if (dirRng < 0.5f)
-                    return ForwardFrom(pos, TurnDirection(dir, NavDir::Left));
-                else
-                    return ForwardFrom(pos, TurnDirection(dir, NavDir::Right));
-
+                results[ix] = snapshot->EnterTile(positions[ix], dirs[ix]);
+                continue;
             }
-            break;
-        case PathType::Side:
-        {
-            Int2 fwd = ForwardFrom(pos, dir);
-            int index = CellIndex(fwd);
-            if (index != -1 && GetPathType(index) != PathType::Empty && Randomizer::Rand() < MIDDLE_TURN_PROBABILITY)
+
+            int entryIndex = snapshot->TurnIndex(positions[ix], dirs[ix]);
+            const TurnEntry &entry = turn_table.entries[entryIndex];
+            if (entry.fixed != TURN_RANDOM)
             {
-                Int2 turned = ForwardFrom(pos, TurnDirection(dir, NavDir::Left));
-                index = CellIndex(turned);
-                if (index > -1 && GetPathType(index) != PathType::Empty)
-                    return turned;
-                turned = ForwardFrom(pos, TurnDirection(dir, NavDir::Right));
-                index = CellIndex(turned);
-                if (index > -1 && GetPathType(index) != PathType::Empty)
-                    return turned;
+                results[ix] = OutcomeTile(positions[ix], entry.fixed);
+#if NAV_TRAFFIC_STATS
+                traffic.AddDecision(entryIndex, entry.fixed);
+#endif
             }
-            break;
+            else
+                pick_entries[ix] = entryIndex;
         }
-        // Path cell on most sides, apart from non-crossing diagonals.
-        case PathType::InnerCorner:
-            if (Randomizer::Rand() < INNER_CORNER_TURN_PROBABILITY)
-            {
-                float dirRng = Randomizer::Rand();
-                if (dirRng < 0.5f)
-                {
-                    Int2 fwd = ForwardFrom(pos, TurnDirection(dir, NavDir::Left));
-                    int fwdIndex = CellIndex(fwd);
-                    if (fwdIndex != -1 && GetPathType(fwdIndex) != PathType::Empty)
-                        return fwd;
-                }
-                else
-                {
-                    Int2 fwd = ForwardFrom(pos, TurnDirection(dir, NavDir::Right));
-                    int fwdIndex = CellIndex(fwd);
-                    if (fwdIndex != -1 && GetPathType(fwdIndex) != PathType::Empty)
-                        return fwd;
-                }
+    });
 
-            }
-            break;
-        case PathType::Turn:
-        case PathType::OuterCorner:
-            if (leftCell != PathType::Empty && dir != NavDir::Right)
-                return ForwardFrom(pos, NavDir::Left);
-            if (rightCell != PathType::Empty && dir != NavDir::Left)
-                return ForwardFrom(pos, NavDir::Right);
-            if (upCell != PathType::Empty && dir != NavDir::Down)
-                return ForwardFrom(pos, NavDir::Up);
-            return ForwardFrom(pos, NavDir::Down);
-        // At least one path to a side with both neighboring diagonals missing.
-        case PathType::Crossing:
-            if (Randomizer::Rand() < CROSSING_TURN_PROBABILITY)
+    for (int ix = 0; ix < count; ++ix)
+    {
+        if (pick_entries[ix] != -1)
+        {
+            const int outcome = snapshot->RandomOutcome(positions[ix], turn_table.entries[pick_entries[ix]], Randomizer::Rand());
+            results[ix] = OutcomeTile(positions[ix], outcome);
+#if NAV_TRAFFIC_STATS
+            traffic.AddDecision(pick_entries[ix], outcome);
+#endif
+        }
+        dirt.Add(*this, positions[ix], FOOTSTEP_DIRT);
+    }
+}
+
+Int2 MapNavigation::PickTile(Int2 pos, NavDir dir, RandomizerStream &stream)
+{
+    dirt.Add(*this, pos, FOOTSTEP_DIRT);
+    return published.load(std::memory_order_relaxed)->PickTile(pos, dir, stream);
+}
+
+void MapNavigation::PickTiles(const Span<Int2>& positions, const Span<NavDir>& dirs, Span<RandomizerStream> streams, Span<Int2> results)
+{
+    // Dirt is added afterwards, as visitors can stand on the same tile.
+    const int count = positions.Length();
+    if (dirs.Length() < count || streams.Length() < count || results.Length() < count)
+    {
+        DebugLog::LogError(TEXT("PickTiles needs a direction, a random stream and a result slot for every position."));
+        return;
+    }
+    published.load(std::memory_order_relaxed)->PickTiles(positions, dirs, streams, results);
+    AddFootsteps(positions);
+}
+
+NavSnapshotRef MapNavigation::AcquireSnapshot() const
+{
+    pinning.fetch_add(1);
+    const NavSnapshot *snapshot = published.load();
+    snapshot->readers.fetch_add(1);
+    pinning.fetch_sub(1);
+    return NavSnapshotRef(snapshot);
+}
+
+void MapNavigation::AddFootsteps(const Span<Int2>& positions)
+{
+    for (int ix = 0; ix < positions.Length(); ++ix)
+        dirt.Add(*this, positions[ix], FOOTSTEP_DIRT);
+}
+
+void MapNavigation::MoveOccupant(Int2 from, Int2 to)
+{
+    published.load(std::memory_order_relaxed)->MoveOccupant(from, to);
+}
+
+void MapNavigation::RemoveOccupant(Int2 pos)
+{
+    published.load(std::memory_order_relaxed)->MoveOccupant(pos, Int2(-1, -1));
+}
+
+int MapNavigation::GetOccupancy(Int2 pos) const
+{
+    return published.load(std::memory_order_relaxed)->Occupancy(pos);
+}
+
+void MapNavigation::SetCrowdThreshold(int visitors)
+{
+    SimRecording::RecordCrowdThreshold(visitors);
+    if (crowd_threshold == std::max(visitors, 0))
+        return;
+    // Snapshots make their own decisions, so the new threshold needs a new snapshot.
+    crowd_threshold = std::max(visitors, 0);
+    crowd.RebuildMasks(*this, crowd_threshold);
+    PublishSnapshot();
+}
+
+bool MapNavigation::GetTrafficStats([[maybe_unused]] NavTrafficStats &stats) const
+{
+#if NAV_TRAFFIC_STATS
+    traffic.GetStats(*this, stats);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool MapNavigation::SaveTraffic(const StringView& path) const
+{
+    NavTrafficStats stats;
+    if (!GetTrafficStats(stats))
+    {
+        DebugLog::LogError(TEXT("Traffic is only counted when the game is built with NAV_TRAFFIC_STATS."));
+        return false;
+    }
+    return stats.Save(path);
+}
+
+void MapNavigation::ResetTraffic()
+{
+#if NAV_TRAFFIC_STATS
+    traffic.Reset(*this);
+#endif
+}
+
+int MapNavigation::AddGoal(const Array<Int2>& cells)
+{
+    int goal = next_goal_id++;
+    NavFlowField &field = flow_fields.emplace(goal, NavFlowField(cells)).first->second;
+    field.Rebuild(*this);
+    return goal;
+}
+
+void MapNavigation::RemoveGoal(int goal)
+{
+    flow_fields.erase(goal);
+}
+
+int MapNavigation::GoalDistance(int goal, Int2 pos) const
+{
+    auto it = flow_fields.find(goal);
+    if (it == flow_fields.end())
+        return -1;
+    int32 distance = it->second.Distance(*this, pos);
+    return distance == NavFlowField::UNREACHABLE ? -1 : distance;
+}
+
+Int2 MapNavigation::StepTowardGoal(int goal, Int2 pos, NavDir dir) const
+{
+    auto it = flow_fields.find(goal);
+    if (it == flow_fields.end())
+        return pos;
+    return it->second.Step(*this, pos, dir);
+}
+
+Array<Int2> MapNavigation::FindPath(Int2 from, Int2 to)
+{
+    Array<Int2> path;
+    hierarchy.FindPath(*this, from, to, path);
+    return path;
+}
+
+Int2 MapNavigation::NextJunction(Int2 pos, NavDir dir, int& distance) const
+{
+    return corridors.NextJunction(*this, pos, dir, distance);
+}
+
+int MapNavigation::JunctionCount() const
+{
+    return corridors.JunctionCount();
+}
+
+int MapNavigation::ComponentOf(Int2 pos) const
+{
+    return components.ComponentOf(*this, pos);
+}
+
+int MapNavigation::CountDifferences(const MapNavigation &other) const
+{
+    if (map_size != other.map_size)
+        return map_size.X * map_size.Y;
+
+    const NavSnapshot *snapshot = published.load();
+    const NavSnapshot *otherSnapshot = other.published.load();
+    // Component labels are arbitrary, they only have to group the same cells in both maps.
+    std::map<int32, int32> labels;
+    std::map<int32, int32> otherLabels;
+    int differences = JunctionCount() != other.JunctionCount() ? 1 : 0;
+    for (int y = 0; y < map_size.Y; ++y)
+    {
+        for (int x = 0; x < map_size.X; ++x)
+        {
+            const Int2 pos(x, y);
+            const bool path = IsPathAt(pos);
+            bool same = path == other.IsPathAt(pos) && PathTypeAt(pos) == other.PathTypeAt(pos) && snapshot->PathTypeAt(pos) == PathTypeAt(pos);
+            if (same && path)
             {
-                int turnCnt = 0;
-                if (dir != NavDir::Up && (downCell == PathType::Straight || downCell == PathType::DeadEnd))
-                    turnCnt++;
-                if (dir != NavDir::Left && (rightCell == PathType::Straight || rightCell == PathType::DeadEnd))
-                    turnCnt++;
-                if (dir != NavDir::Right && (leftCell == PathType::Straight || leftCell == PathType::DeadEnd))
-                    turnCnt++;
-                if (dir != NavDir::Down && (upCell == PathType::Straight || upCell == PathType::DeadEnd))
-                    turnCnt++;
-                if (turnCnt != 0)
+                const uint16 context = turn_contexts[CellIndex(pos)];
+                same = context == TurnContext(pos) && context == other.turn_contexts[other.CellIndex(pos)];
+                for (int side = 0; side < 4; ++side)
                 {
-                    float turnSide = Randomizer::Rand();
-                    if (dir != NavDir::Up && (downCell == PathType::Straight || downCell == PathType::DeadEnd))
-                    {
-                        if (turnSide < (1.0f / turnCnt))
-                            return ForwardFrom(pos, NavDir::Down);
-                        turnSide -= 1.0f / turnCnt;
-                    }
-                    if (dir != NavDir::Left && (rightCell == PathType::Straight || rightCell == PathType::DeadEnd))
-                    {
-                        if (turnSide < (1.0f / turnCnt))
-                            return ForwardFrom(pos, NavDir::Right);
-                        turnSide -= 1.0f / turnCnt;
-                    }
-                    if (dir != NavDir::Right && (leftCell == PathType::Straight || leftCell == PathType::DeadEnd))
-                    {
-                        if (turnSide < (1.0f / turnCnt))
-                            return ForwardFrom(pos, NavDir::Left);
-                        turnSide -= 1.0f / turnCnt;
-                    }
-                    return ForwardFrom(pos, NavDir::Up);
+                    int distance = 0;
+                    int otherDistance = 0;
+                    same = same && snapshot->TurnIndex(pos, (NavDir)side) == otherSnapshot->TurnIndex(pos, (NavDir)side);
+                    same = same && NextJunction(pos, (NavDir)side, distance) == other.NextJunction(pos, (NavDir)side, otherDistance) && distance == otherDistance;
                 }
+                for (const auto &field : flow_fields)
+                    same = same && GoalDistance(field.first, pos) == other.GoalDistance(field.first, pos);
+
+                const int32 component = ComponentOf(pos);
+                const int32 otherComponent = other.ComponentOf(pos);
+                same = same && labels.emplace(component, otherComponent).first->second == otherComponent;
+                same = same && otherLabels.emplace(otherComponent, component).first->second == component;
             }
-            break;
-        case PathType::DeadEnd:
-        {
-            if (upCell != PathType::Empty)
-                return ForwardFrom(pos, NavDir::Up);
-            if (downCell != PathType::Empty)
-                return ForwardFrom(pos, NavDir::Down);
-            if (leftCell != PathType::Empty)
-                return ForwardFrom(pos, NavDir::Left);
-            if (rightCell != PathType::Empty)
-                return ForwardFrom(pos, NavDir::Right);
-            return pos;
+            differences += same ? 0 : 1;
         }
-        case PathType::Isolated:
-            return pos;
-        // // Cell with two other cells to the sides. Either both horizontal or both vertical.
-        // default: // case PathType::Straight:
-        //     return ForwardFrom(pos, dir);
     }
-    Int2 nextPos = ForwardFrom(pos, dir);
-    int nextIndex = CellIndex(nextPos);
-    if (nextIndex == -1 || GetPathType(nextIndex) == PathType::Empty)
+    return differences;
+}
+
+void MapNavigation::SetEntryTiles(const Array<Int2>& tiles)
+{
+    components.SetEntryCells(tiles);
+}
+
+bool MapNavigation::IsReachableFromEntry(Int2 pos) const
+{
+    return components.IsReachableFromEntry(*this, pos);
+}
+
+void MapNavigation::AddDirt(Int2 pos, float amount)
+{
+    dirt.Add(*this, pos, amount);
+}
+
+float MapNavigation::GetDirt(Int2 pos) const
+{
+    return dirt.Get(*this, pos);
+}
+
+Array<Int2> MapNavigation::GetDirtiestTiles(int count) const
+{
+    Array<Int2> result;
+    dirt.Dirtiest(*this, count, result);
+    return result;
+}
+
+float MapNavigation::GetRegionDirt(Int2 from, Int2 to) const
+{
+    return dirt.RegionTotal(*this, from, to);
+}
+
+int MapNavigation::TurnOutcome(const TurnEntry &entry, float rng)
+{
+    int value = (int)(rng * TURN_SCALE);
+    for (int ix = 0; ix < 4; ++ix)
     {
-        // Must turn left or right.
-        Int2 leftPos = ForwardFrom(pos, TurnDirection(dir, NavDir::Left));
-        Int2 rightPos = ForwardFrom(pos, TurnDirection(dir, NavDir::Right));
-        int leftEmpty = CellIndex(leftPos) == -1 || GetPathType(CellIndex(leftPos)) == PathType::Empty;
-        int rightEmpty = CellIndex(rightPos) == -1 || GetPathType(CellIndex(rightPos)) == PathType::Empty;
-        if (leftEmpty && !rightEmpty)
-            return rightPos;
-        if (rightEmpty && !leftEmpty)
-            return leftPos;
-        else if (!leftEmpty && !rightEmpty)
-            return Randomizer::Rand() < 0.5 ? leftPos : rightPos;
+        if (value < entry.thresholds[ix])
+            return ix;
     }
+    return TURN_STAY;
+}
 
-    return nextPos;
+int MapNavigation::TurnOutcome(const TurnEntry &entry, uint8 crowded, float rng)
+{
+    if (crowded == 0)
+        return TurnOutcome(entry, rng);
+
+    // The same random number is compared to the probabilities after the crowded moves were scaled down.
+    float weights[5];
+    float total = 0.0f;
+    int previous = 0;
+    for (int ix = 0; ix < 4; ++ix)
+    {
+        weights[ix] = (float)(entry.thresholds[ix] - previous);
+        if ((crowded & (1 << ix)) != 0)
+            weights[ix] *= CROWDED_TURN_WEIGHT;
+        previous = entry.thresholds[ix];
+        total += weights[ix];
+    }
+    weights[TURN_STAY] = (float)(TURN_SCALE - previous);
+    total += weights[TURN_STAY];
+
+    float value = rng * total;
+    int outcome = TURN_STAY;
+    for (int ix = 0; ix <= TURN_STAY; ++ix)
+    {
+        if (weights[ix] <= 0.0f)
+            continue;
+        outcome = ix;
+        if (value < weights[ix])
+            break;
+        value -= weights[ix];
+    }
+    return outcome;
+}
+
+Int2 MapNavigation::OutcomeTile(Int2 pos, int outcome)
+{
+    if (outcome == TURN_STAY)
+        return pos;
+    return ForwardFrom(pos, (NavDir)outcome);
 }
 
 void MapNavigation::SetCell(int index, CellType type)
 {
-    if (map_cells[index].cell_type != CellType::Empty)
+    if (GetCellType(index) != CellType::Empty)
         return;
 
-    Cell &cell = map_cells[index];
-    cell.cell_type = CellType::Path;
+    cell_types[index] = (uint8)type;
+    ++slot_path_counts[index / CHUNK_CELLS];
 }
 
 void MapNavigation::ClearCell(int index)
 {
-    if (map_cells[index].cell_type == CellType::Empty)
+    if (index == -1 || GetCellType(index) == CellType::Empty)
         return;
 
-    Cell &cell = map_cells[index];
-    cell.cell_type = CellType::Empty;
-    cell.data.reset();
+    cell_types[index] = (uint8)CellType::Empty;
+    path_types[index] = (uint8)PathType::Empty;
+    snapshot_dirty[index / CHUNK_CELLS] = true;
+    if (--slot_path_counts[index / CHUNK_CELLS] == 0)
+        emptied_slots.Add(index / CHUNK_CELLS);
 }
 
 
 
-Int2 MapNavigation::ForwardFrom(Int2 pos, NavDir dir) const
+Int2 MapNavigation::ForwardFrom(Int2 pos, NavDir dir)
 {
     switch(dir)
     {
@@ -319,7 +738,7 @@ Int2 MapNavigation::ForwardFrom(Int2 pos, NavDir dir) const
     return pos;
 }
 
-NavDir MapNavigation::TurnDirection(NavDir orig, NavDir side) const
+constexpr NavDir MapNavigation::TurnDirection(NavDir orig, NavDir side)
 {
     if (orig == NavDir::Up)
         return side;
@@ -340,85 +759,490 @@ int MapNavigation::CellIndex(Int2 pos) const
     if (!ValidPos(pos))
         return -1;
 
-    return pos.X + pos.Y * map_size.X;
+    const Int2 stored(pos.X + map_origin.X, pos.Y + map_origin.Y);
+    int32 slot = chunk_slots[(stored.Y >> CHUNK_SHIFT) * chunk_count.X + (stored.X >> CHUNK_SHIFT)];
+    if (slot == NO_CHUNK)
+        return -1;
+    return slot * CHUNK_CELLS + ((stored.Y & (CHUNK_SIZE - 1)) << CHUNK_SHIFT) + (stored.X & (CHUNK_SIZE - 1));
 }
 
-void MapNavigation::UpdatePathType(Int2 pos, HashSet<Int2> updated)
+Int2 MapNavigation::CellPos(int index) const
 {
-    if (!ValidPos(pos) || !updated.Add(pos))
+    Int2 origin = ChunkOrigin(index / CHUNK_CELLS);
+    int local = index & (CHUNK_CELLS - 1);
+    return Int2(origin.X + (local & (CHUNK_SIZE - 1)), origin.Y + (local >> CHUNK_SHIFT));
+}
+
+Int2 MapNavigation::ChunkOf(Int2 pos) const
+{
+    return Int2((pos.X + map_origin.X) >> CHUNK_SHIFT, (pos.Y + map_origin.Y) >> CHUNK_SHIFT);
+}
+
+int32 MapNavigation::ChunkSlot(Int2 chunk) const
+{
+    if (chunk.X < 0 || chunk.Y < 0 || chunk.X >= chunk_count.X || chunk.Y >= chunk_count.Y)
+        return NO_CHUNK;
+    return chunk_slots[chunk.Y * chunk_count.X + chunk.X];
+}
+
+bool MapNavigation::SlotUsed(int32 slot) const
+{
+    return slot_chunks[slot].X != -1;
+}
+
+Int2 MapNavigation::SlotChunk(int32 slot) const
+{
+    return slot_chunks[slot];
+}
+
+Int2 MapNavigation::ChunkOrigin(int32 slot) const
+{
+    Int2 chunk = slot_chunks[slot];
+    return Int2((chunk.X << CHUNK_SHIFT) - map_origin.X, (chunk.Y << CHUNK_SHIFT) - map_origin.Y);
+}
+
+int32 MapNavigation::ChunkSlotCount() const
+{
+    return slot_chunks.Count();
+}
+
+int32 MapNavigation::AllocateChunk(Int2 chunk)
+{
+    int32 slot;
+    if (free_slots.Count() != 0)
+    {
+        slot = free_slots.Last();
+        free_slots.RemoveLast();
+    }
+    else
+    {
+        slot = slot_chunks.Count();
+        slot_chunks.AddOne();
+        slot_path_counts.AddOne();
+    }
+    slot_chunks[slot] = chunk;
+    slot_path_counts[slot] = 0;
+    chunk_slots[chunk.Y * chunk_count.X + chunk.X] = slot;
+
+    // Cells of released slots are already empty.
+    FitLayer(cell_types, (uint8)CellType::Empty);
+    FitLayer(path_types, (uint8)PathType::Empty);
+    FitLayer(turn_contexts, (uint16)0);
+    FitLayer(update_bits, (uint64)0, CHUNK_CELLS / 64);
+    FitLayer(snapshot_dirty, false, 1);
+    snapshot_dirty[slot] = true;
+    crowd.Allocate(*this, slot);
+    return slot;
+}
+
+void MapNavigation::ReleaseChunk(int32 slot)
+{
+    Int2 chunk = slot_chunks[slot];
+    chunk_slots[chunk.Y * chunk_count.X + chunk.X] = NO_CHUNK;
+    slot_chunks[slot] = Int2(-1, -1);
+    free_slots.Add(slot);
+
+    // Free slots at the end are removed to give back their memory. The per-cell arrays of the parts of the
+    // navigation are shrunk on their next update.
+    if (slot != slot_chunks.Count() - 1)
+    {
+        crowd.Release(*this, slot);
         return;
+    }
+    while (slot_chunks.Count() != 0 && !SlotUsed(slot_chunks.Count() - 1))
+    {
+        slot_chunks.RemoveLast();
+        slot_path_counts.RemoveLast();
+    }
+    for (int ix = free_slots.Count() - 1; ix >= 0; --ix)
+    {
+        if (free_slots[ix] >= slot_chunks.Count())
+            free_slots.RemoveAt(ix);
+    }
+    FitLayer(cell_types, (uint8)CellType::Empty);
+    FitLayer(path_types, (uint8)PathType::Empty);
+    FitLayer(turn_contexts, (uint16)0);
+    FitLayer(update_bits, (uint64)0, CHUNK_CELLS / 64);
+    FitLayer(snapshot_dirty, false, 1);
+    crowd.Release(*this, slot);
+}
+
+uint8 MapNavigation::PathMask(Int2 pos) const
+{
+    uint8 mask = 0;
+    if (IsPathAt(Int2(pos.X - 1, pos.Y + 1)))
+        mask |= MaskUpLeft;
+    if (IsPathAt(Int2(pos.X, pos.Y + 1)))
+        mask |= MaskUp;
+    if (IsPathAt(Int2(pos.X + 1, pos.Y + 1)))
+        mask |= MaskUpRight;
+    if (IsPathAt(Int2(pos.X - 1, pos.Y)))
+        mask |= MaskLeft;
+    if (IsPathAt(Int2(pos.X + 1, pos.Y)))
+        mask |= MaskRight;
+    if (IsPathAt(Int2(pos.X - 1, pos.Y - 1)))
+        mask |= MaskDownLeft;
+    if (IsPathAt(Int2(pos.X, pos.Y - 1)))
+        mask |= MaskDown;
+    if (IsPathAt(Int2(pos.X + 1, pos.Y - 1)))
+        mask |= MaskDownRight;
+    return mask;
+}
 
+bool MapNavigation::IsPathAt(Int2 pos) const
+{
+    int index = CellIndex(pos);
+    return index != -1 && GetCellType(index) == CellType::Path;
+}
+
+auto MapNavigation::PathTypeAt(Int2 pos) const -> PathType
+{
     int index = CellIndex(pos);
-    if (map_cells[index].cell_type != CellType::Path)
+    return index == -1 ? PathType::Empty : GetPathType(index);
+}
+
+void MapNavigation::UpdatePathType(Int2 pos)
+{
+    int index = CellIndex(pos);
+    // Cells in chunks that were never allocated are empty.
+    if (index == -1 || GetCellType(index) != CellType::Path)
         return;
 
-    Array<Array<bool>> sides = {
-        {
-            pos.X > 0 && pos.Y < map_size.Y - 1 && GetPathType(index + map_size.X - 1) != PathType::Empty,
-            pos.X > 0 && GetPathType(index - 1) != PathType::Empty,
-            pos.X > 0 && pos.Y > 0 && GetPathType(index - map_size.X - 1) != PathType::Empty
-        },
+    SetPathType(index, path_type_table.types[PathMask(pos)]);
+}
+
+uint16 MapNavigation::TurnContext(Int2 pos) const
+{
+    PathType sides[4] = {
+        PathTypeAt(Int2(pos.X, pos.Y + 1)),
+        PathTypeAt(Int2(pos.X, pos.Y - 1)),
+        PathTypeAt(Int2(pos.X - 1, pos.Y)),
+        PathTypeAt(Int2(pos.X + 1, pos.Y))
+    };
+
+    uint8 neighbors = 0;
+    for (int ix = 0; ix < 4; ++ix)
+    {
+        if (sides[ix] != PathType::Empty)
+            neighbors |= 1 << (NEIGHBOR_PATH_SHIFT + ix);
+        if (sides[ix] == PathType::Straight || sides[ix] == PathType::DeadEnd)
+            neighbors |= 1 << (NEIGHBOR_LANE_SHIFT + ix);
+    }
+    return (uint16)TurnTable::Index(PathTypeAt(pos), NavDir::Up, neighbors);
+}
+
+void MapNavigation::RefreshContexts(const Array<Int2> &cells)
+{
+    // The context of a cell depends on the path types of its four neighbors.
+    context_cells.Clear();
+    for (Int2 pos : cells)
+    {
+        const Int2 around[5] = { pos, Int2(pos.X, pos.Y + 1), Int2(pos.X, pos.Y - 1), Int2(pos.X - 1, pos.Y), Int2(pos.X + 1, pos.Y) };
+        for (Int2 cell : around)
         {
-            pos.Y < map_size.Y - 1 && GetPathType(index + map_size.X) != PathType::Empty,
-            true,
-            pos.Y > 0 && GetPathType(index - map_size.X) != PathType::Empty
-        },
+            int index = CellIndex(cell);
+            if (index == -1 || (update_bits[index >> 6] & (1ull << (index & 63))) != 0)
+                continue;
+            update_bits[index >> 6] |= 1ull << (index & 63);
+            context_cells.Add(cell);
+        }
+    }
+    for (Int2 pos : context_cells)
+    {
+        int index = CellIndex(pos);
+        update_bits[index >> 6] &= ~(1ull << (index & 63));
+        const uint16 context = TurnContext(pos);
+        if (turn_contexts[index] == context)
+            continue;
+        turn_contexts[index] = context;
+        snapshot_dirty[index / CHUNK_CELLS] = true;
+    }
+    crowd.UpdateMasks(*this, context_cells, crowd_threshold);
+}
+
+auto MapNavigation::GetPathType(int index) const -> PathType
+{
+    return (PathType)path_types[index];
+}
+
+auto MapNavigation::GetCellType(int index) const -> CellType
+{
+    return (CellType)cell_types[index];
+}
+
+void MapNavigation::SetPathType(int index, PathType type)
+{
+    if (GetCellType(index) != CellType::Path || GetPathType(index) == type)
+        return;
+    path_types[index] = (uint8)type;
+    snapshot_dirty[index / CHUNK_CELLS] = true;
+}
+
+void MapNavigation::PublishSnapshot()
+{
+    NavSnapshot *previous = published.load();
+    NavSnapshot *snapshot = new NavSnapshot();
+    snapshot->version = ++snapshot_version;
+    snapshot->map_size = map_size;
+    snapshot->map_origin = map_origin;
+    snapshot->chunk_count = chunk_count;
+    snapshot->chunk_slots = chunk_slots;
+    snapshot->chunks.Resize(ChunkSlotCount());
+    snapshot->crowd_threshold = crowd_threshold;
+#if NAV_TRAFFIC_STATS
+    snapshot->traffic = &traffic;
+#endif
+    snapshot->crowd.Resize(ChunkSlotCount());
+    for (int32 slot = 0; slot < ChunkSlotCount(); ++slot)
+    {
+        if (!SlotUsed(slot))
+            continue;
+        snapshot->crowd[slot] = crowd.SlotBlock(slot);
+        if (!snapshot_dirty[slot] && previous != nullptr && slot < previous->chunks.Count() && previous->chunks[slot])
         {
-            pos.X < map_size.X - 1 && pos.Y < map_size.Y - 1 && GetPathType(index + map_size.X + 1) != PathType::Empty,
-            pos.X < map_size.X - 1 && GetPathType(index + 1) != PathType::Empty,
-            pos.X < map_size.X - 1 && pos.Y > 0 && GetPathType(index - map_size.X + 1) != PathType::Empty
+            snapshot->chunks[slot] = previous->chunks[slot];
+            continue;
         }
-    };
+        auto chunk = std::make_shared<NavSnapshot::Chunk>();
+        memcpy(chunk->path_types, path_types.Get() + slot * CHUNK_CELLS, CHUNK_CELLS);
+        memcpy(chunk->turn_contexts, turn_contexts.Get() + slot * CHUNK_CELLS, CHUNK_CELLS * sizeof(uint16));
+        snapshot->chunks[slot] = chunk;
+        snapshot_dirty[slot] = false;
+    }
 
-    int horz = (sides[0][1] ? 1 : 0) + (sides[2][1] ? 1 : 0);
-    int vert = (sides[1][0] ? 1 : 0) + (sides[1][2] ? 1 : 0);
-    int diagonals = (sides[0][0] ? 1 : 0) + (sides[2][2] ? 1 : 0) + (sides[0][2] ? 1 : 0) + (sides[2][0] ? 1 : 0);
+    published.store(snapshot);
+    if (previous != nullptr)
+        retired_snapshots.Add(previous);
+    ReclaimSnapshots();
+}
 
-    if (horz == 2 && vert == 2 && diagonals == 4)
-         SetPathType(index, PathType::Middle);
-    else if (horz == 0 && vert == 0)
-         SetPathType(index, PathType::Isolated);
-    else if (horz == 0 || vert == 0)
-    {
-        if (horz == 2 || vert == 2)
-             SetPathType(index, PathType::Straight);
-        else if (horz == 1 || vert == 1)
-             SetPathType(index, PathType::DeadEnd);
-    }
-    else if (horz == 1 && vert == 1)
-    {
-        if ((sides[0][0] && sides[0][1] && sides[1][0]) || (sides[2][0] && sides[1][0] && sides[2][1]) ||
-                (sides[0][2] && sides[0][1] && sides[1][2]) || (sides[2][2] && sides[1][2] && sides[2][1]))
-             SetPathType(index, PathType::OuterCorner);
-        else
-             SetPathType(index, PathType::Turn);
-    }
-    else if (horz + vert == 3 && diagonals == 2 && ((!sides[0][0] && !sides[1][0] && !sides[2][0]) ||
-            (!sides[0][0] && !sides[0][1] && !sides[0][2]) || (!sides[2][0] && !sides[2][1] && !sides[2][2]) ||
-            (!sides[0][2] && !sides[1][2] && !sides[2][2])))
-         SetPathType(index, PathType::Side);
-    else if ((!sides[0][0] && !sides[2][0]) || (!sides[0][0] && !sides[0][2]) || (!sides[2][0] && !sides[2][2]) || (!sides[0][2] && !sides[2][2]))
-         SetPathType(index, PathType::Crossing);
+void MapNavigation::ReclaimSnapshots()
+{
+    // Once no reader is between loading and pinning a snapshot, the replaced snapshots can't get new
+    // readers anymore.
+    if (pinning.load() != 0)
+        return;
+    for (int ix = retired_snapshots.Count() - 1; ix >= 0; --ix)
+    {
+        if (retired_snapshots[ix]->readers.load(std::memory_order_acquire) != 0)
+            continue;
+        delete retired_snapshots[ix];
+        retired_snapshots.RemoveAt(ix);
+    }
+}
+
+
+// Turn table generation. Every entry holds the probabilities of the possible moves for a visitor standing on
+// a cell of a given path type, walking in a direction, and with the given neighbor mask. The table is built
+// at compile time, so PickTile only needs a single lookup and at most one random number.
+
+constexpr bool MapNavigation::HasNeighbor(uint8 neighbors, int shift, NavDir side)
+{
+    return (neighbors & (1 << (shift + (int)side))) != 0;
+}
+
+constexpr void MapNavigation::AddForwardProbabilities(NavDir dir, uint8 neighbors, float weight, float *probabilities)
+{
+    // Walk forward if possible, or turn to the side that has a path. If both sides have a path, either
+    // one is picked.
+    NavDir left = TurnDirection(dir, NavDir::Left);
+    NavDir right = TurnDirection(dir, NavDir::Right);
+    bool forwardPath = HasNeighbor(neighbors, NEIGHBOR_PATH_SHIFT, dir);
+    bool leftPath = HasNeighbor(neighbors, NEIGHBOR_PATH_SHIFT, left);
+    bool rightPath = HasNeighbor(neighbors, NEIGHBOR_PATH_SHIFT, right);
+
+    if (forwardPath || (!leftPath && !rightPath))
+        probabilities[(int)dir] += weight;
+    else if (leftPath && rightPath)
+    {
+        probabilities[(int)left] += weight * 0.5f;
+        probabilities[(int)right] += weight * 0.5f;
+    }
     else
-         SetPathType(index, PathType::InnerCorner);
+        probabilities[leftPath ? (int)left : (int)right] += weight;
+}
 
+constexpr void MapNavigation::AddTurnProbabilities(PathType type, NavDir dir, uint8 neighbors, float *probabilities)
+{
+    NavDir left = TurnDirection(dir, NavDir::Left);
+    NavDir right = TurnDirection(dir, NavDir::Right);
+    bool forwardPath = HasNeighbor(neighbors, NEIGHBOR_PATH_SHIFT, dir);
+    bool leftPath = HasNeighbor(neighbors, NEIGHBOR_PATH_SHIFT, left);
+    bool rightPath = HasNeighbor(neighbors, NEIGHBOR_PATH_SHIFT, right);
+
+    switch (type)
+    {
+        // Path cell on each side, including diagonals. Low probability of turning.
+        case PathType::Middle:
+            probabilities[(int)left] += MIDDLE_TURN_PROBABILITY * 0.5f;
+            probabilities[(int)right] += MIDDLE_TURN_PROBABILITY * 0.5f;
+            AddForwardProbabilities(dir, neighbors, 1.0f - MIDDLE_TURN_PROBABILITY, probabilities);
+            break;
+        // Only turns when there's a path forward too, preferring the left side.
+        case PathType::Side:
+            if (forwardPath && (leftPath || rightPath))
+            {
+                probabilities[leftPath ? (int)left : (int)right] += MIDDLE_TURN_PROBABILITY;
+                AddForwardProbabilities(dir, neighbors, 1.0f - MIDDLE_TURN_PROBABILITY, probabilities);
+            }
+            else
+                AddForwardProbabilities(dir, neighbors, 1.0f, probabilities);
+            break;
+        // Path cell on most sides, apart from non-crossing diagonals.
+        case PathType::InnerCorner:
+            if (leftPath)
+                probabilities[(int)left] += INNER_CORNER_TURN_PROBABILITY * 0.5f;
+            else
+                AddForwardProbabilities(dir, neighbors, INNER_CORNER_TURN_PROBABILITY * 0.5f, probabilities);
+            if (rightPath)
+                probabilities[(int)right] += INNER_CORNER_TURN_PROBABILITY * 0.5f;
+            else
+                AddForwardProbabilities(dir, neighbors, INNER_CORNER_TURN_PROBABILITY * 0.5f, probabilities);
+            AddForwardProbabilities(dir, neighbors, 1.0f - INNER_CORNER_TURN_PROBABILITY, probabilities);
+            break;
+        // Follows the path to the side that wasn't the previous cell.
+        case PathType::Turn:
+        case PathType::OuterCorner:
+            if (HasNeighbor(neighbors, NEIGHBOR_PATH_SHIFT, NavDir::Left) && dir != NavDir::Right)
+                probabilities[(int)NavDir::Left] += 1.0f;
+            else if (HasNeighbor(neighbors, NEIGHBOR_PATH_SHIFT, NavDir::Right) && dir != NavDir::Left)
+                probabilities[(int)NavDir::Right] += 1.0f;
+            else if (HasNeighbor(neighbors, NEIGHBOR_PATH_SHIFT, NavDir::Up) && dir != NavDir::Down)
+                probabilities[(int)NavDir::Up] += 1.0f;
+            else
+                probabilities[(int)NavDir::Down] += 1.0f;
+            break;
+        // At least one path to a side with both neighboring diagonals missing. Turns to any of the
+        // lanes leading away with the same probability, apart from going back.
+        case PathType::Crossing:
+        {
+            const NavDir backwards[4] = { NavDir::Down, NavDir::Up, NavDir::Right, NavDir::Left };
+            int turnCnt = 0;
+            for (int side = 0; side < 4; ++side)
+            {
+                if (side != (int)backwards[(int)dir] && HasNeighbor(neighbors, NEIGHBOR_LANE_SHIFT, (NavDir)side))
+                    turnCnt++;
+            }
+            if (turnCnt != 0)
+            {
+                for (int side = 0; side < 4; ++side)
+                {
+                    if (side != (int)backwards[(int)dir] && HasNeighbor(neighbors, NEIGHBOR_LANE_SHIFT, (NavDir)side))
+                        probabilities[side] += CROSSING_TURN_PROBABILITY / turnCnt;
+                }
+                AddForwardProbabilities(dir, neighbors, 1.0f - CROSSING_TURN_PROBABILITY, probabilities);
+            }
+            else
+                AddForwardProbabilities(dir, neighbors, 1.0f, probabilities);
+            break;
+        }
+        case PathType::DeadEnd:
+        {
+            const NavDir order[4] = { NavDir::Up, NavDir::Down, NavDir::Left, NavDir::Right };
+            for (NavDir side : order)
+            {
+                if (HasNeighbor(neighbors, NEIGHBOR_PATH_SHIFT, side))
+                {
+                    probabilities[(int)side] += 1.0f;
+                    return;
+                }
+            }
+            probabilities[TURN_STAY] += 1.0f;
+            break;
+        }
+        case PathType::Isolated:
+            probabilities[TURN_STAY] += 1.0f;
+            break;
+        // Cell with two other cells to the sides. Either both horizontal or both vertical.
+        default: // case PathType::Straight:
+            AddForwardProbabilities(dir, neighbors, 1.0f, probabilities);
+            break;
+    }
 }
 
-auto MapNavigation::GetPathType(int index) const -> PathType
+constexpr MapNavigation::TurnTable MapNavigation::BuildTurnTable()
 {
-    const Cell &cell = map_cells[index];
-    if (cell.cell_type != CellType::Path || !cell.data)
-        return PathType::Empty;
+    TurnTable table = {};
+    for (int type = 0; type < (int)PathType::ValueMax; ++type)
+    {
+        for (int dir = 0; dir < 4; ++dir)
+        {
+            for (int neighbors = 0; neighbors < 256; ++neighbors)
+            {
+                float probabilities[5] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+                AddTurnProbabilities((PathType)type, (NavDir)dir, (uint8)neighbors, probabilities);
 
-    return ((PathCell*)&*cell.data)->type;
+                TurnEntry &entry = table.entries[TurnTable::Index((PathType)type, (NavDir)dir, (uint8)neighbors)];
+                entry.fixed = TURN_RANDOM;
+                entry.moves = 0;
+                float sum = 0.0f;
+                int last = 0;
+                for (int ix = 0; ix < 4; ++ix)
+                {
+                    sum += probabilities[ix];
+                    int threshold = (int)(sum * TURN_SCALE + 0.5f);
+                    threshold = threshold > TURN_SCALE ? TURN_SCALE : threshold;
+                    entry.thresholds[ix] = (uint16)threshold;
+                    if (threshold - last == TURN_SCALE)
+                        entry.fixed = (int8)ix;
+                    if (threshold != last)
+                        entry.moves |= 1 << ix;
+                    last = threshold;
+                }
+                if (last == 0)
+                    entry.fixed = TURN_STAY;
+            }
+        }
+    }
+    return table;
 }
 
-void MapNavigation::SetPathType(int index, PathType type)
+const MapNavigation::TurnTable MapNavigation::turn_table = MapNavigation::BuildTurnTable();
+
+
+// Path type classification of every possible neighbor mask, built at compile time.
+
+constexpr MapNavigation::PathType MapNavigation::ClassifyPath(uint8 mask)
 {
-    Cell &cell = map_cells[index];
-    if (cell.cell_type != CellType::Path)
-        return;
-    if (!cell.data)
-        cell.data.reset(new PathCell());
-    ((PathCell*)&*cell.data)->type = type;
+    const bool upLeft = (mask & MaskUpLeft) != 0;
+    const bool up = (mask & MaskUp) != 0;
+    const bool upRight = (mask & MaskUpRight) != 0;
+    const bool left = (mask & MaskLeft) != 0;
+    const bool right = (mask & MaskRight) != 0;
+    const bool downLeft = (mask & MaskDownLeft) != 0;
+    const bool down = (mask & MaskDown) != 0;
+    const bool downRight = (mask & MaskDownRight) != 0;
+
+    const int horz = (left ? 1 : 0) + (right ? 1 : 0);
+    const int vert = (up ? 1 : 0) + (down ? 1 : 0);
+    const int diagonals = (upLeft ? 1 : 0) + (upRight ? 1 : 0) + (downLeft ? 1 : 0) + (downRight ? 1 : 0);
+
+    if (horz == 2 && vert == 2 && diagonals == 4)
+        return PathType::Middle;
+    if (horz == 0 && vert == 0)
+        return PathType::Isolated;
+    if (horz == 0 || vert == 0)
+        return horz == 2 || vert == 2 ? PathType::Straight : PathType::DeadEnd;
+    if (horz == 1 && vert == 1)
+    {
+        if ((upLeft && left && up) || (upRight && up && right) || (downLeft && left && down) || (downRight && down && right))
+            return PathType::OuterCorner;
+        return PathType::Turn;
+    }
+    if (horz + vert == 3 && diagonals == 2 && ((!upLeft && !up && !upRight) || (!upLeft && !left && !downLeft) ||
+            (!upRight && !right && !downRight) || (!downLeft && !down && !downRight)))
+        return PathType::Side;
+    if ((!upLeft && !upRight) || (!upLeft && !downLeft) || (!upRight && !downRight) || (!downLeft && !downRight))
+        return PathType::Crossing;
+    return PathType::InnerCorner;
+}
+
+constexpr MapNavigation::PathTypeTable MapNavigation::BuildPathTypeTable()
+{
+    PathTypeTable table = {};
+    for (int mask = 0; mask < 256; ++mask)
+        table.types[mask] = ClassifyPath((uint8)mask);
+    return table;
 }
+
+const MapNavigation::PathTypeTable MapNavigation::path_type_table = MapNavigation::BuildPathTypeTable();
@@ -1,10 +1,21 @@
 ﻿#pragma once
 
-#include <memory>
+#include <atomic>
 #include <map>
 #include "Engine/Scripting/Script.h"
 #include "Engine/Core/Math/Vector2.h"
-#include "Engine/Core/Collections/HashSet.h"
+#include "Engine/Threading/JobSystem.h"
+#include "nav_flow_field.h"
+#include "nav_hierarchy.h"
+#include "nav_corridors.h"
+#include "nav_components.h"
+#include "nav_dirt.h"
+#include "nav_crowd.h"
+#include "nav_traffic.h"
+
+struct RandomizerStream;
+class NavSnapshot;
+class NavSnapshotRef;
 
 
 API_ENUM() enum class NavDir : uint8
@@ -23,7 +34,7 @@ DECLARE_SCRIPTING_TYPE(MapNavigation);
 
 private:
 
-    enum class CellType : uint16
+    enum class CellType : uint8
     {
         Empty,
         Path,
@@ -51,62 +62,373 @@ private:
         Turn,
         // All three cells in one side are empty, every other one is not. Low probability of turning
         Side,
+
+        ValueMax
     };
 
-    struct MapCell
+    // Bits of the neighbor mask used as the key in turn_table. The low 4 bits are set for path cells on the
+    // Up, Down, Left and Right sides, in NavDir order. The high 4 bits are set for the same sides if the
+    // path cell there is Straight or a DeadEnd, which a Crossing prefers to turn to.
+    static constexpr int NEIGHBOR_PATH_SHIFT = 0;
+    static constexpr int NEIGHBOR_LANE_SHIFT = 4;
+
+    // Turn probabilities used to generate turn_table.
+    static constexpr float MIDDLE_TURN_PROBABILITY = 0.1f;
+    static constexpr float INNER_CORNER_TURN_PROBABILITY = 0.2f;
+    static constexpr float CROSSING_TURN_PROBABILITY = 0.25f;
+    // Part of the probability a move to a crowded tile keeps when PickTile avoids crowds.
+    static constexpr float CROWDED_TURN_WEIGHT = 0.2f;
+
+    // Random numbers are scaled to this range when they are compared to the thresholds in a TurnEntry.
+    static constexpr int TURN_SCALE = 1 << 15;
+    // TurnEntry::fixed value when the decision needs a random number.
+    static constexpr int8 TURN_RANDOM = -1;
+    // Decision outcome of staying on the same cell. Outcomes 0-3 are moving in the NavDir of the same value.
+    static constexpr int8 TURN_STAY = 4;
+
+    // Decision for a path type, walking direction and neighbor mask.
+    struct TurnEntry
     {
+        // Cumulative probabilities of moving Up, Down, Left and Right, in TURN_SCALE units. Random numbers
+        // above the last threshold mean staying on the cell.
+        uint16 thresholds[4];
+        // The only possible outcome of the decision, or TURN_RANDOM.
+        int8 fixed;
+        // Bits in NavDir order for the moves with a chance to happen.
+        uint8 moves;
     };
 
-    struct PathCell : public MapCell
+    struct TurnTable
     {
-        PathType type;
-        uint32 dirt;
+        TurnEntry entries[(int)PathType::ValueMax * 4 * 256];
+
+        static constexpr int Index(PathType type, NavDir dir, uint8 neighbors)
+        {
+            return (((int)type * 4 + (int)dir) << 8) | neighbors;
+        }
     };
 
-    struct Cell
+    // Bits of the neighbor mask used as the key in path_type_table, set for the 8 surrounding cells that
+    // have a path.
+    enum PathMaskBit : uint8
     {
-        CellType cell_type;
-        std::shared_ptr<MapCell> data;
+        MaskUpLeft = 1 << 0,
+        MaskUp = 1 << 1,
+        MaskUpRight = 1 << 2,
+        MaskLeft = 1 << 3,
+        MaskRight = 1 << 4,
+        MaskDownLeft = 1 << 5,
+        MaskDown = 1 << 6,
+        MaskDownRight = 1 << 7,
     };
 
-    enum class ChangeType : uint8
+    struct PathTypeTable
     {
-        None,
-        Adding,
-        Removing,
-        Invalid
+        PathType types[256];
     };
 
+    // The map is split into square chunks of cells. Only the chunks that have path cells are allocated, so
+    // memory grows with the amount of paths instead of the size of the map. Every allocated chunk gets a slot,
+    // and per-cell data is stored in arrays with CHUNK_CELLS items for each slot.
+    static constexpr int CHUNK_SHIFT = 5;
+    static constexpr int CHUNK_SIZE = 1 << CHUNK_SHIFT;
+    static constexpr int CHUNK_CELLS = CHUNK_SIZE * CHUNK_SIZE;
+    static constexpr int32 NO_CHUNK = -1;
+
 public:
+    // Dirt left on a tile by a visitor walking through it.
+    static constexpr float FOOTSTEP_DIRT = 1.0f;
+    // Number of changes kept for Undo. The oldest change is forgotten when a new one is made.
+    static constexpr int MAX_UNDO_CHANGES = 64;
+
+    ~MapNavigation();
+
+    // [Script]
+    void OnUpdate() override;
+
     API_FUNCTION() void SetMapData(Int2 size);
+    // Changes the size of the map, keeping the paths. Tiles move by offset, so a positive offset adds the
+    // new land on the bottom and left sides. Paths outside the new size are removed. The cost depends on the
+    // length of the map borders and the number of chunks, not on the number of tiles.
+    API_FUNCTION() void ResizeMap(Int2 newSize, Int2 offset);
     API_FUNCTION() void AddPath(Int2 pos);
     API_FUNCTION() void RemovePath(Int2 pos);
+    // Paths can be added and removed in the same change, in any order. Only the last edit of each tile
+    // counts, and the map is updated once for all of them in EndChange.
     API_FUNCTION() void BeginChange();
     API_FUNCTION() void EndChange();
+    // Reverts the last change, or makes the last undone change again. Returns false if there is nothing to
+    // undo or redo. Resizing the map clears both lists.
+    API_FUNCTION() bool Undo();
+    API_FUNCTION() bool Redo();
     API_FUNCTION() Int2 PickTile(Int2 pos, NavDir dir);
+    // Picks the next tile for a whole batch of visitors in one call. Fills results with the same tiles
+    // that calling PickTile for each position and direction in order would return. The dirs and results
+    // spans must be at least as long as positions.
+    API_FUNCTION() void PickTiles(const Span<Int2>& positions, const Span<NavDir>& dirs, Span<Int2> results);
+    // Versions of PickTile and PickTiles that take their random numbers from the passed streams, one for
+    // each visitor. The batch is computed in parallel, and gives the same tiles as picking them one by one
+    // with the same streams.
+    Int2 PickTile(Int2 pos, NavDir dir, RandomizerStream &stream);
+    void PickTiles(const Span<Int2>& positions, const Span<NavDir>& dirs, Span<RandomizerStream> streams, Span<Int2> results);
+
+    // Pins the snapshot of the map published by the last change. It can be read from any thread, and stays
+    // unchanged while the map is changed. Include nav_snapshot.h to use it.
+    NavSnapshotRef AcquireSnapshot() const;
+    // Leaves dirt on the tiles visitors are standing on, for batches picked on a snapshot. Call it on the
+    // main thread.
+    void AddFootsteps(const Span<Int2>& positions);
+
+    // Number of visitors on each path tile. Visitors report moving from one tile to the next, and leaving
+    // the park from their last tile. Tiles without a path aren't counted.
+    API_FUNCTION() void MoveOccupant(Int2 from, Int2 to);
+    API_FUNCTION() void RemoveOccupant(Int2 pos);
+    API_FUNCTION() int GetOccupancy(Int2 pos) const;
+    // When PickTile decides randomly, moves to tiles with at least this many visitors become less likely,
+    // which spreads crowds over the park. 0 turns it off.
+    API_FUNCTION() void SetCrowdThreshold(int visitors);
+
+    // Registers a set of goal cells, like the park entrance. The walking distance from every path cell to
+    // the nearest goal cell is kept up to date as paths change. Returns the id of the goal.
+    API_FUNCTION() int AddGoal(const Array<Int2>& cells);
+    API_FUNCTION() void RemoveGoal(int goal);
+    // Number of steps from pos to the nearest cell of the goal, or -1 if the goal can't be reached.
+    API_FUNCTION() int GoalDistance(int goal, Int2 pos) const;
+    // Returns the neighbor tile of pos one step closer to the goal, preferring the tile in dir. Returns pos
+    // when it's a goal cell, or the goal can't be reached from it.
+    API_FUNCTION() Int2 StepTowardGoal(int goal, Int2 pos, NavDir dir) const;
+
+    // Returns the tiles of a short path between two path tiles, starting with from and ending with to. The
+    // result is empty if there's no path between them.
+    API_FUNCTION() Array<Int2> FindPath(Int2 from, Int2 to);
+
+    // Returns the first junction, turn or dead end tile reached by walking from pos in dir, skipping over
+    // straight lanes that have no other way to go. distance is set to the number of tiles to walk. Returns
+    // pos and zero distance if there's no path in dir.
+    API_FUNCTION() Int2 NextJunction(Int2 pos, NavDir dir, API_PARAM(Out) int& distance) const;
+    // Number of path tiles that are not inside straight lanes.
+    API_FUNCTION() int JunctionCount() const;
+
+    // Label of the connected group of path tiles pos belongs to, or -1 if it's not a path tile. Tiles
+    // with the same label are reachable from each other.
+    API_FUNCTION() int ComponentOf(Int2 pos) const;
+    // Sets the tiles where visitors enter the park, used by IsReachableFromEntry.
+    API_FUNCTION() void SetEntryTiles(const Array<Int2>& tiles);
+    API_FUNCTION() bool IsReachableFromEntry(Int2 pos) const;
+
+    // Adds dirt on a path tile, for example when a visitor vomits. Visitors picking their next tile add
+    // dirt to the tile they are on.
+    API_FUNCTION() void AddDirt(Int2 pos, float amount);
+    API_FUNCTION() float GetDirt(Int2 pos) const;
+    // Returns up to count tiles with the most dirt, starting with the dirtiest.
+    API_FUNCTION() Array<Int2> GetDirtiestTiles(int count) const;
+    // Sum of the dirt on the tiles in the rectangle between from and to, including both.
+    API_FUNCTION() float GetRegionDirt(Int2 from, Int2 to) const;
+
+    // Counts the cells where this map and other, a map of the same size and paths, give different answers:
+    // the cell and path types, the cached and published turn contexts, the corridors, the goal distances and
+    // the component groups. Used to check the incremental updates against a map built from scratch.
+    int CountDifferences(const MapNavigation &other) const;
+
+    // Traffic counters for finding the busy walkways and tuning the turn probabilities: the visits of every
+    // tile and the outcomes of the PickTile decisions. They are only counted when the game is built with
+    // NAV_TRAFFIC_STATS, otherwise GetTrafficStats and SaveTraffic return false.
+    bool GetTrafficStats(NavTrafficStats &stats) const;
+    // Writes the counters to path, as CSV if it ends with .csv and in a binary format otherwise.
+    API_FUNCTION() bool SaveTraffic(const StringView& path) const;
+    API_FUNCTION() void ResetTraffic();
 private:
+    friend class NavFlowField;
+    friend class NavHierarchy;
+    friend class NavCorridors;
+    friend class NavComponents;
+    friend class NavDirt;
+    friend class NavCrowd;
+    friend class NavSnapshot;
+    friend class NavTraffic;
+    friend class SimRecording;
+
+    // Decision outcome of a turn table entry for a random number between 0 and 1.
+    static int TurnOutcome(const TurnEntry &entry, float rng);
+    // Same as above, with the moves in the directions set in the crowded bit mask made less likely.
+    static int TurnOutcome(const TurnEntry &entry, uint8 crowded, float rng);
+    static Int2 OutcomeTile(Int2 pos, int outcome);
+    // Splits a batch of count picks into blocks and calls pickRange with the first and the end index of each.
+    // Batches of more than one block are picked in parallel on the job system.
+    static void PickBlocks(int count, const Function<void(int32, int32)>& pickRange);
+
+    // Publishes a snapshot of the map with copies of the chunks that changed since the last one.
+    void PublishSnapshot();
+    // Removes and adds the paths, then updates every part of the navigation around them in one pass.
+    // The removed cells must be paths and the added cells empty.
+    void ApplyChanges(const Array<Int2> &added, const Array<Int2> &removed);
+    // Frees the replaced snapshots that no reader holds.
+    void ReclaimSnapshots();
+    // Updates the turn contexts and crowded neighbor bits of the cells and their four neighbors, after the
+    // path types of the cells changed.
+    void RefreshContexts(const Array<Int2> &cells);
+
+    static constexpr TurnTable BuildTurnTable();
+    static constexpr bool HasNeighbor(uint8 neighbors, int shift, NavDir side);
+    static constexpr void AddTurnProbabilities(PathType type, NavDir dir, uint8 neighbors, float *probabilities);
+    static constexpr void AddForwardProbabilities(NavDir dir, uint8 neighbors, float weight, float *probabilities);
+
+    static constexpr PathTypeTable BuildPathTypeTable();
+    // Path type of a cell with the given mask of PathMaskBit neighbors.
+    static constexpr PathType ClassifyPath(uint8 mask);
 
     void SetCell(int index, CellType type);
     void ClearCell(int index);
 
-    Int2 ForwardFrom(Int2 pos, NavDir dir) const;
-    NavDir TurnDirection(NavDir orig, NavDir side) const;
+    static Int2 ForwardFrom(Int2 pos, NavDir dir);
+    static constexpr NavDir TurnDirection(NavDir orig, NavDir side);
     bool ValidPos(Int2 pos) const;
+    // Index of the cell in the per-cell arrays, or -1 if pos is outside the map or in a chunk that isn't
+    // allocated.
     int CellIndex(Int2 pos) const;
+    // Position of the cell at an index returned by CellIndex.
+    Int2 CellPos(int index) const;
+
+    // Chunk coordinates of the chunk pos is in. Chunks are aligned to map_origin, not to the map.
+    Int2 ChunkOf(Int2 pos) const;
+    // Slot of the chunk with the given chunk coordinates, or NO_CHUNK.
+    int32 ChunkSlot(Int2 chunk) const;
+    bool SlotUsed(int32 slot) const;
+    // Chunk coordinates of the chunk in a used slot.
+    Int2 SlotChunk(int32 slot) const;
+    // Position of the first cell of the chunk in a used slot. It can be outside the map.
+    Int2 ChunkOrigin(int32 slot) const;
+    // Number of slots, including free ones.
+    int32 ChunkSlotCount() const;
+    int32 AllocateChunk(Int2 chunk);
+    void ReleaseChunk(int32 slot);
+    // Resizes an array with per_chunk items for each chunk slot, setting the items of new slots to empty.
+    template<typename T>
+    void FitLayer(Array<T> &layer, T empty, int32 per_chunk = CHUNK_CELLS) const
+    {
+        const int32 count = ChunkSlotCount() * per_chunk;
+        if (layer.Count() > count)
+        {
+            layer.Resize(count);
+            layer.SetCapacity(count);
+            return;
+        }
+        const int32 first = layer.Count();
+        layer.Resize(count);
+        for (int32 ix = first; ix < count; ++ix)
+            layer[ix] = empty;
+    }
 
-    void UpdatePathType(Int2 pos, HashSet<Int2> updated);
+    // Mask of PathMaskBit values for the neighbors of pos that have a path.
+    uint8 PathMask(Int2 pos) const;
+    bool IsPathAt(Int2 pos) const;
+    PathType PathTypeAt(Int2 pos) const;
+    void UpdatePathType(Int2 pos);
     void SetPathType(int index, PathType type);
     PathType GetPathType(int index) const;
+    // turn_table index of the decision at pos when walking Up.
+    uint16 TurnContext(Int2 pos) const;
+    CellType GetCellType(int index) const;
 
 
     Int2 map_size;
-    Array<Cell> map_cells;
+    // Position of the first cell of the map in its chunk. Resizing the map with an offset moves this instead
+    // of the stored cells, so chunks never need to be copied.
+    Int2 map_origin;
+
+    // Number of chunks along each side of the map, and the slot of each chunk or NO_CHUNK.
+    Int2 chunk_count;
+    Array<int32> chunk_slots;
+    // Chunk coordinates of the chunk in each slot, with -1 coordinates for free slots.
+    Array<Int2> slot_chunks;
+    // Number of path cells in the chunk of each slot. Chunks are released when it drops to zero.
+    Array<int32> slot_path_counts;
+    Array<int32> free_slots;
+
+    // Cell data is stored in separate flat arrays per attribute, each indexed by CellIndex(). Cells of a
+    // chunk are next to each other, which keeps most neighbor lookups in PickTile and UpdatePathType on
+    // contiguous memory.
 
+    // CellType of each cell.
+    Array<uint8> cell_types;
+    // PathType of each cell. Empty for cells without a path, or path cells that weren't classified yet.
+    Array<uint8> path_types;
+    // turn_table index of each cell for walking Up, packing its path type and the types of its four
+    // neighbors. Adding (int)dir << 8 gives the index for the other directions, so PickTile reads a single
+    // value per decision. Kept up to date for the cells around every change.
+    Array<uint16> turn_contexts;
+
+    // Path edit made between BeginChange and EndChange.
+    struct PathEdit
+    {
+        Int2 pos;
+        bool add;
+    };
+
+    // Cells that a change turned into paths and into empty cells. Undoing it does the opposite.
+    struct ChangeRecord
+    {
+        Array<Int2> added;
+        Array<Int2> removed;
+    };
+
+    // Edits of the current change in the order they were made.
+    Array<PathEdit> edits;
     // A list of path items that are changed and need their cell type updated. 
     Array<Int2> changes;
-
-    ChangeType change_type;
     bool changing;
 
+    // Applied changes that can be undone, with the last one at the end, and the undone changes that can be
+    // made again.
+    Array<ChangeRecord> undo_records;
+    Array<ChangeRecord> redo_records;
+
+    // Scratch array for PickTiles with the turn_table index of positions that still need a decision using
+    // random numbers, or -1 for positions that are done.
+    Array<int> pick_entries;
+
+    // Scratch data of EndChange. Cells that need their path type updated, and a bit for each cell of the map
+    // that is set while the cell is in the list. Slots of chunks that lost all their path cells.
+    Array<Int2> update_cells;
+    Array<uint64> update_bits;
+    Array<int32> emptied_slots;
+    // Cells that need their turn context updated, and slots allocated by the change.
+    Array<Int2> context_cells;
+    Array<int32> allocated_slots;
+
+    static const TurnTable turn_table;
+    static const PathTypeTable path_type_table;
+
+    // Flow fields of the registered goals by goal id.
+    std::map<int, NavFlowField> flow_fields;
+    int next_goal_id;
+
+    // Clusters and entrances for FindPath.
+    NavHierarchy hierarchy;
+    // Straight lanes collapsed between junctions.
+    NavCorridors corridors;
+    // Connected component labels of path cells.
+    NavComponents components;
+    // Dirt left by visitors.
+    NavDirt dirt;
+    // Visitors on each cell, and the number of visitors that makes a cell crowded for PickTile.
+    NavCrowd crowd;
+    int crowd_threshold;
+#if NAV_TRAFFIC_STATS
+    // Visits and PickTile decisions, counted through the snapshots.
+    NavTraffic traffic;
+#endif
+
+    // Snapshot published by the last change, which PickTile reads as well.
+    std::atomic<NavSnapshot*> published;
+    // Number of readers between loading published and pinning it. Replaced snapshots are only freed while
+    // it's zero, so a reader can't pin a snapshot that is being freed.
+    mutable std::atomic<int32> pinning;
+    // Replaced snapshots waiting for their readers to release them.
+    Array<NavSnapshot*> retired_snapshots;
+    // Whether the chunk in each slot changed since the last snapshot.
+    Array<bool> snapshot_dirty;
+    uint64 snapshot_version;
+
 
 };
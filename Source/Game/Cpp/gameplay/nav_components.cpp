@@ -0,0 +1,278 @@
+#include "nav_components.h"
+#include "map_navigation.h"
+
+
+NavComponents::NavComponents() : search_stamp(0)
+{
+}
+
+void NavComponents::Rebuild(const MapNavigation &nav)
+{
+    cell_components.Clear();
+    cell_searches.Clear();
+    cell_stamps.Clear();
+    FitLayers(nav);
+    search_stamp = 0;
+    component_sizes.Clear();
+    free_components.Clear();
+
+    for (int index = 0; index < cell_components.Count(); ++index)
+    {
+        if (IsPath(nav, index) && cell_components[index] == NO_COMPONENT)
+            Relabel(nav, nav.CellPos(index), NO_COMPONENT, NewComponent());
+    }
+}
+
+void NavComponents::Update(const MapNavigation &nav, const Array<Int2> &changed)
+{
+    FitLayers(nav);
+
+    // Removed cells are taken out of their components first. Their neighbors might not be connected
+    // anymore, so they are the starting points of searches for the split parts.
+    Array<Int2> seeds;
+    for (Int2 pos : changed)
+    {
+        int index = nav.CellIndex(pos);
+        if (index == -1 || IsPath(nav, index) || cell_components[index] == NO_COMPONENT)
+            continue;
+
+        int32 component = cell_components[index];
+        cell_components[index] = NO_COMPONENT;
+        if (--component_sizes[component] == 0)
+            FreeComponent(component);
+
+        for (int side = 0; side < 4; ++side)
+        {
+            Int2 next = nav.ForwardFrom(pos, (NavDir)side);
+            int next_index = nav.CellIndex(next);
+            if (next_index != -1 && IsPath(nav, next_index) && cell_components[next_index] != NO_COMPONENT)
+                seeds.Add(next);
+        }
+    }
+    if (seeds.Count() != 0)
+        SplitComponents(nav, seeds);
+
+    for (Int2 pos : changed)
+    {
+        int index = nav.CellIndex(pos);
+        if (index != -1 && IsPath(nav, index) && cell_components[index] == NO_COMPONENT)
+            AddCell(nav, pos);
+    }
+}
+
+void NavComponents::Move(Int2 offset)
+{
+    for (Int2 &pos : entry_cells)
+        pos = Int2(pos.X + offset.X, pos.Y + offset.Y);
+}
+
+int32 NavComponents::ComponentOf(const MapNavigation &nav, Int2 pos) const
+{
+    int index = nav.CellIndex(pos);
+    if (index == -1 || index >= cell_components.Count())
+        return NO_COMPONENT;
+    return cell_components[index];
+}
+
+void NavComponents::SetEntryCells(const Array<Int2> &cells)
+{
+    entry_cells = cells;
+}
+
+bool NavComponents::IsReachableFromEntry(const MapNavigation &nav, Int2 pos) const
+{
+    int32 component = ComponentOf(nav, pos);
+    if (component == NO_COMPONENT)
+        return false;
+    for (Int2 entry : entry_cells)
+    {
+        if (ComponentOf(nav, entry) == component)
+            return true;
+    }
+    return false;
+}
+
+int32 NavComponents::NewComponent()
+{
+    if (free_components.Count() != 0)
+    {
+        int32 component = free_components.Last();
+        free_components.RemoveLast();
+        return component;
+    }
+    component_sizes.Add(0);
+    return component_sizes.Count() - 1;
+}
+
+void NavComponents::FreeComponent(int32 component)
+{
+    component_sizes[component] = 0;
+    free_components.Add(component);
+}
+
+int32 NavComponents::Relabel(const MapNavigation &nav, Int2 pos, int32 from, int32 to)
+{
+    // The walk finds cells by their old label, so it would never run out of cells if nothing changed.
+    if (from == to)
+        return 0;
+
+    relabel_queue.Clear();
+    cell_components[nav.CellIndex(pos)] = to;
+    relabel_queue.Add(pos);
+    for (int head = 0; head < relabel_queue.Count(); ++head)
+    {
+        Int2 current = relabel_queue[head];
+        for (int side = 0; side < 4; ++side)
+        {
+            Int2 next = nav.ForwardFrom(current, (NavDir)side);
+            int index = nav.CellIndex(next);
+            if (index == -1 || cell_components[index] != from || !IsPath(nav, index))
+                continue;
+            cell_components[index] = to;
+            relabel_queue.Add(next);
+        }
+    }
+
+    const int32 count = relabel_queue.Count();
+    if (from != NO_COMPONENT)
+        component_sizes[from] -= count;
+    component_sizes[to] += count;
+    return count;
+}
+
+void NavComponents::AddCell(const MapNavigation &nav, Int2 pos)
+{
+    // The cell joins the biggest component around it, and the rest are merged into that one.
+    int32 biggest = NO_COMPONENT;
+    for (int side = 0; side < 4; ++side)
+    {
+        int32 component = ComponentOf(nav, nav.ForwardFrom(pos, (NavDir)side));
+        if (component != NO_COMPONENT && (biggest == NO_COMPONENT || component_sizes[component] > component_sizes[biggest]))
+            biggest = component;
+    }
+
+    const int index = nav.CellIndex(pos);
+    if (biggest == NO_COMPONENT)
+    {
+        biggest = NewComponent();
+        cell_components[index] = biggest;
+        component_sizes[biggest] = 1;
+        return;
+    }
+
+    cell_components[index] = biggest;
+    ++component_sizes[biggest];
+    for (int side = 0; side < 4; ++side)
+    {
+        Int2 next = nav.ForwardFrom(pos, (NavDir)side);
+        int32 component = ComponentOf(nav, next);
+        if (component == NO_COMPONENT || component == biggest)
+            continue;
+        Relabel(nav, next, component, biggest);
+        FreeComponent(component);
+    }
+}
+
+void NavComponents::SplitComponents(const MapNavigation &nav, const Array<Int2> &seeds)
+{
+    if (++search_stamp == 0)
+    {
+        cell_stamps.SetAll(0);
+        search_stamp = 1;
+    }
+
+    component_searches.Resize(component_sizes.Count());
+    component_searches.SetAll(0);
+    searches.Clear();
+    for (Int2 seed : seeds)
+    {
+        int index = nav.CellIndex(seed);
+        if (cell_stamps[index] == search_stamp)
+            continue;
+        cell_stamps[index] = search_stamp;
+        cell_searches[index] = searches.Count();
+
+        Search &search = searches.AddOne();
+        search.component = cell_components[index];
+        search.queue.Add(seed);
+        search.head = 0;
+        search.merged = -1;
+        ++component_searches[search.component];
+    }
+
+    // Searches take turns walking one cell each, so the smallest parts are finished first. Searches that
+    // meet are merged, and a search that runs out of cells has found a separate part. The search left last
+    // in a component doesn't need to finish, its part keeps the old label.
+    bool walking = true;
+    while (walking)
+    {
+        walking = false;
+        for (int ix = 0; ix < searches.Count(); ++ix)
+        {
+            Search &search = searches[ix];
+            if (search.merged != -1 || search.head == -1 || component_searches[search.component] <= 1)
+                continue;
+            walking = true;
+
+            if (search.head == search.queue.Count())
+            {
+                int32 component = NewComponent();
+                Relabel(nav, search.queue[0], search.component, component);
+                --component_searches[search.component];
+                search.head = -1;
+                continue;
+            }
+
+            Int2 current = search.queue[search.head++];
+            for (int side = 0; side < 4; ++side)
+            {
+                Int2 next = nav.ForwardFrom(current, (NavDir)side);
+                int index = nav.CellIndex(next);
+                if (index == -1 || !IsPath(nav, index))
+                    continue;
+                // Cells added in the same change get their labels after the split. Every other path cell next
+                // to a part is in its component.
+                ASSERT(cell_components[index] == search.component || cell_components[index] == NO_COMPONENT);
+                if (cell_components[index] != search.component)
+                    continue;
+
+                if (cell_stamps[index] != search_stamp)
+                {
+                    cell_stamps[index] = search_stamp;
+                    cell_searches[index] = ix;
+                    search.queue.Add(next);
+                    continue;
+                }
+
+                int other = FindSearch(cell_searches[index]);
+                if (other == ix)
+                    continue;
+                Search &merged = searches[other];
+                for (int iy = merged.head; iy < merged.queue.Count(); ++iy)
+                    search.queue.Add(merged.queue[iy]);
+                merged.queue.Clear();
+                merged.merged = ix;
+                --component_searches[search.component];
+            }
+        }
+    }
+}
+
+int NavComponents::FindSearch(int search) const
+{
+    while (searches[search].merged != -1)
+        search = searches[search].merged;
+    return search;
+}
+
+void NavComponents::FitLayers(const MapNavigation &nav)
+{
+    nav.FitLayer(cell_components, NO_COMPONENT);
+    nav.FitLayer(cell_searches, 0);
+    nav.FitLayer(cell_stamps, 0u);
+}
+
+bool NavComponents::IsPath(const MapNavigation &nav, int index) const
+{
+    return nav.GetCellType(index) == MapNavigation::CellType::Path;
+}
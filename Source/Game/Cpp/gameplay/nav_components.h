@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Engine/Core/Math/Vector2.h"
+#include "Engine/Core/Collections/Array.h"
+
+class MapNavigation;
+
+
+// Connected component labels of the path cells of the navigation map. Added cells join the components
+// around them, relabeling the smaller ones when they connect several. Removing cells searches from their
+// neighbors side by side until all but one of the parts are fully walked, so a split only costs as much as
+// its smaller parts, which get new labels.
+class NavComponents
+{
+public:
+    static constexpr int32 NO_COMPONENT = -1;
+
+    NavComponents();
+
+    // Labels the path cells on the whole map from scratch.
+    void Rebuild(const MapNavigation &nav);
+    // Updates the labels after the passed cells were added to or removed from the navigation map. Removed
+    // cells are handled first, and cells added in the same change are labeled after the split is done.
+    void Update(const MapNavigation &nav, const Array<Int2> &changed);
+    // Moves the entry cells by offset after the map was resized.
+    void Move(Int2 offset);
+
+    // Component label of the path cell at pos, or NO_COMPONENT.
+    int32 ComponentOf(const MapNavigation &nav, Int2 pos) const;
+    void SetEntryCells(const Array<Int2> &cells);
+    // Whether pos is in the same component as one of the entry cells.
+    bool IsReachableFromEntry(const MapNavigation &nav, Int2 pos) const;
+
+private:
+    // Search of a removed cell's neighbor to find out which neighbors are still connected.
+    struct Search
+    {
+        int32 component;
+        Array<Int2> queue;
+        int head;
+        // Index of the search this one met and was merged into, or -1.
+        int merged;
+    };
+
+    int32 NewComponent();
+    void FreeComponent(int32 component);
+    // Changes the label of the cells connected to pos that have the from label. Returns their number, which
+    // is 0 when from and to are the same.
+    int32 Relabel(const MapNavigation &nav, Int2 pos, int32 from, int32 to);
+    void AddCell(const MapNavigation &nav, Int2 pos);
+    // Separates the parts of components that are no longer connected after cells were removed.
+    void SplitComponents(const MapNavigation &nav, const Array<Int2> &seeds);
+    int FindSearch(int search) const;
+    // Resizes the per-cell arrays to the allocated chunks of the map.
+    void FitLayers(const MapNavigation &nav);
+    bool IsPath(const MapNavigation &nav, int index) const;
+
+    // Component label of each cell.
+    Array<int32> cell_components;
+    // Number of cells of each component, or 0 if the label is unused.
+    Array<int32> component_sizes;
+    // Number of searches of each component that can still find a separate part.
+    Array<int32> component_searches;
+    Array<int32> free_components;
+    Array<Int2> entry_cells;
+
+    // Scratch data of updates.
+    Array<Int2> relabel_queue;
+    Array<Search> searches;
+    // Search index that reached each cell, and the update it happened in.
+    Array<int32> cell_searches;
+    Array<uint32> cell_stamps;
+    uint32 search_stamp;
+};
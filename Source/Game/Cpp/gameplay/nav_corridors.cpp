@@ -0,0 +1,205 @@
+#include "nav_corridors.h"
+#include "map_navigation.h"
+
+#include <cstdlib>
+
+
+NavCorridors::NavCorridors() : junction_count(0)
+{
+}
+
+void NavCorridors::Rebuild(const MapNavigation &nav)
+{
+    cell_corridors.Clear();
+    nav.FitLayer(cell_corridors, NO_PATH);
+    corridors.Clear();
+    free_corridors.Clear();
+    junction_count = 0;
+
+    for (int index = 0; index < cell_corridors.Count(); ++index)
+    {
+        if (nav.GetCellType(index) == MapNavigation::CellType::Path)
+            SetCell(index, JUNCTION);
+    }
+
+    for (int index = 0; index < cell_corridors.Count(); ++index)
+    {
+        if (cell_corridors[index] != JUNCTION)
+            continue;
+        Int2 pos = nav.CellPos(index);
+        Axis axis = CorridorAxis(nav, pos);
+        if (axis != Axis::None)
+            Trace(nav, pos, axis);
+    }
+}
+
+void NavCorridors::Update(const MapNavigation &nav, const Array<Int2> &changed)
+{
+    nav.FitLayer(cell_corridors, NO_PATH);
+
+    // A change can turn the cell itself and its neighbors into corridor cells or junctions. Corridors
+    // going through these cells are dissolved, and the cells are traced again.
+    Array<Int2> affected;
+    for (Int2 pos : changed)
+    {
+        affected.Add(pos);
+        for (int side = 0; side < 4; ++side)
+            affected.Add(nav.ForwardFrom(pos, (NavDir)side));
+    }
+
+    for (int ix = 0; ix < affected.Count(); ++ix)
+    {
+        int index = nav.CellIndex(affected[ix]);
+        if (index == -1)
+            continue;
+        if (cell_corridors[index] >= 0)
+            Dissolve(nav, cell_corridors[index], affected);
+
+        if (nav.GetCellType(index) != MapNavigation::CellType::Path)
+            SetCell(index, NO_PATH);
+        else if (cell_corridors[index] == NO_PATH)
+            SetCell(index, JUNCTION);
+    }
+
+    for (Int2 pos : affected)
+    {
+        int index = nav.CellIndex(pos);
+        if (index == -1 || cell_corridors[index] != JUNCTION)
+            continue;
+        Axis axis = CorridorAxis(nav, pos);
+        if (axis != Axis::None)
+            Trace(nav, pos, axis);
+    }
+}
+
+void NavCorridors::Move(Int2 offset)
+{
+    for (Corridor &corridor : corridors)
+    {
+        corridor.first = Int2(corridor.first.X + offset.X, corridor.first.Y + offset.Y);
+        corridor.last = Int2(corridor.last.X + offset.X, corridor.last.Y + offset.Y);
+    }
+}
+
+Int2 NavCorridors::NextJunction(const MapNavigation &nav, Int2 pos, NavDir dir, int32 &distance) const
+{
+    distance = 0;
+    int index = nav.CellIndex(pos);
+    if (index == -1 || index >= cell_corridors.Count() || cell_corridors[index] == NO_PATH)
+        return pos;
+
+    // Walking out of a junction either leads to another junction right away, or into a corridor that
+    // continues in the same direction.
+    int32 corridor = cell_corridors[index];
+    if (corridor == JUNCTION)
+    {
+        Int2 next = nav.ForwardFrom(pos, dir);
+        int next_index = nav.CellIndex(next);
+        if (next_index == -1 || cell_corridors[next_index] == NO_PATH)
+            return pos;
+        corridor = cell_corridors[next_index];
+        if (corridor == JUNCTION)
+        {
+            distance = 1;
+            return next;
+        }
+    }
+
+    const Corridor &data = corridors[corridor];
+    const bool vertical = dir == NavDir::Up || dir == NavDir::Down;
+    if (vertical != (data.axis == Axis::Vertical))
+        return pos;
+
+    Int2 end = dir == NavDir::Up || dir == NavDir::Right ? data.last : data.first;
+    distance = std::abs(end.X - pos.X) + std::abs(end.Y - pos.Y) + 1;
+    return nav.ForwardFrom(end, dir);
+}
+
+NavCorridors::Axis NavCorridors::CorridorAxis(const MapNavigation &nav, Int2 pos) const
+{
+    auto isPath = [&nav](Int2 cell) {
+        int index = nav.CellIndex(cell);
+        return index != -1 && nav.GetCellType(index) == MapNavigation::CellType::Path;
+    };
+
+    if (!isPath(pos))
+        return Axis::None;
+
+    bool up = isPath(nav.ForwardFrom(pos, NavDir::Up));
+    bool down = isPath(nav.ForwardFrom(pos, NavDir::Down));
+    bool left = isPath(nav.ForwardFrom(pos, NavDir::Left));
+    bool right = isPath(nav.ForwardFrom(pos, NavDir::Right));
+    if (up && down && !left && !right)
+        return Axis::Vertical;
+    if (left && right && !up && !down)
+        return Axis::Horizontal;
+    return Axis::None;
+}
+
+void NavCorridors::Trace(const MapNavigation &nav, Int2 pos, Axis axis)
+{
+    const NavDir backward = axis == Axis::Vertical ? NavDir::Down : NavDir::Left;
+    const NavDir forward = axis == Axis::Vertical ? NavDir::Up : NavDir::Right;
+
+    Int2 first = pos;
+    while (CorridorAxis(nav, nav.ForwardFrom(first, backward)) == axis)
+        first = nav.ForwardFrom(first, backward);
+    Int2 last = pos;
+    while (CorridorAxis(nav, nav.ForwardFrom(last, forward)) == axis)
+        last = nav.ForwardFrom(last, forward);
+
+    int32 corridor;
+    if (free_corridors.Count() != 0)
+    {
+        corridor = free_corridors.Last();
+        free_corridors.RemoveLast();
+    }
+    else
+    {
+        corridor = corridors.Count();
+        corridors.AddDefault(1);
+    }
+    corridors[corridor] = Corridor{ first, last, axis };
+
+    // A new corridor cell can join corridors that weren't affected by the change. Those are completely
+    // inside the new run, and are freed when their first cell is reached.
+    for (Int2 cell = first; ; cell = nav.ForwardFrom(cell, forward))
+    {
+        int index = nav.CellIndex(cell);
+        int32 old = cell_corridors[index];
+        if (old >= 0 && old != corridor && corridors[old].first == cell)
+            FreeCorridor(old);
+        SetCell(index, corridor);
+        if (cell == last)
+            break;
+    }
+}
+
+void NavCorridors::Dissolve(const MapNavigation &nav, int32 corridor, Array<Int2> &cells)
+{
+    const Corridor data = corridors[corridor];
+    const NavDir forward = data.axis == Axis::Vertical ? NavDir::Up : NavDir::Right;
+    for (Int2 cell = data.first; ; cell = nav.ForwardFrom(cell, forward))
+    {
+        SetCell(nav.CellIndex(cell), JUNCTION);
+        cells.Add(cell);
+        if (cell == data.last)
+            break;
+    }
+    FreeCorridor(corridor);
+}
+
+void NavCorridors::FreeCorridor(int32 corridor)
+{
+    corridors[corridor].axis = Axis::None;
+    free_corridors.Add(corridor);
+}
+
+void NavCorridors::SetCell(int index, int32 value)
+{
+    if (cell_corridors[index] == JUNCTION)
+        --junction_count;
+    if (value == JUNCTION)
+        ++junction_count;
+    cell_corridors[index] = value;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Engine/Core/Math/Vector2.h"
+#include "Engine/Core/Collections/Array.h"
+
+class MapNavigation;
+enum class NavDir : uint8;
+
+
+// Compacted graph of the navigation map, where runs of straight lane cells are collapsed into corridors.
+// A corridor cell has path cells on two opposite sides and no path on the other two, so walking into it
+// can only lead to the other end. Every other path cell is a junction, and corridors are the weighted
+// edges between the junctions at their two ends.
+class NavCorridors
+{
+public:
+    // Values in cell_corridors for cells that are not in a corridor.
+    static constexpr int32 NO_PATH = -2;
+    static constexpr int32 JUNCTION = -1;
+
+    NavCorridors();
+
+    // Finds the corridors on the whole map from scratch.
+    void Rebuild(const MapNavigation &nav);
+    // Updates the corridors around the passed cells after they were added to or removed from the map.
+    void Update(const MapNavigation &nav, const Array<Int2> &changed);
+    // Moves the corridor ends by offset after the map was resized.
+    void Move(Int2 offset);
+
+    // First junction reached by walking from pos in dir, skipping the cells of corridors. Sets distance to
+    // the number of steps to the junction. Returns pos with zero distance when there's no path in dir.
+    Int2 NextJunction(const MapNavigation &nav, Int2 pos, NavDir dir, int32 &distance) const;
+    int32 JunctionCount() const { return junction_count; }
+    int32 CorridorCount() const { return corridors.Count() - free_corridors.Count(); }
+
+private:
+    enum class Axis : uint8
+    {
+        None,
+        Vertical,
+        Horizontal,
+    };
+
+    struct Corridor
+    {
+        // Cells at the two ends of the corridor. The first cell has the lower coordinate.
+        Int2 first;
+        Int2 last;
+        Axis axis;
+    };
+
+    // Direction of the lane if pos is a corridor cell, or None.
+    Axis CorridorAxis(const MapNavigation &nav, Int2 pos) const;
+    // Creates a corridor from the run of corridor cells that contains pos.
+    void Trace(const MapNavigation &nav, Int2 pos, Axis axis);
+    // Removes the corridor, turning its cells into junctions that are added to the cells array.
+    void Dissolve(const MapNavigation &nav, int32 corridor, Array<Int2> &cells);
+    void FreeCorridor(int32 corridor);
+    void SetCell(int index, int32 value);
+
+    // Corridor index of each cell, or NO_PATH or JUNCTION.
+    Array<int32> cell_corridors;
+    Array<Corridor> corridors;
+    // Indexes of unused items in corridors.
+    Array<int32> free_corridors;
+    int32 junction_count;
+};
@@ -0,0 +1,76 @@
+#include "nav_crowd.h"
+#include "map_navigation.h"
+
+
+NavCrowd::Block::Block()
+{
+    for (int ix = 0; ix < BLOCK_CELLS; ++ix)
+    {
+        counts[ix].store(0, std::memory_order_relaxed);
+        crowded[ix].store(0, std::memory_order_relaxed);
+#if NAV_TRAFFIC_STATS
+        visits[ix].store(0, std::memory_order_relaxed);
+#endif
+    }
+}
+
+void NavCrowd::Rebuild(const MapNavigation &nav)
+{
+    static_assert(BLOCK_CELLS == MapNavigation::CHUNK_CELLS, "Crowd blocks must match the navigation chunks.");
+
+    blocks.Clear();
+    nav.FitLayer(blocks, std::shared_ptr<Block>(), 1);
+}
+
+void NavCrowd::Allocate(const MapNavigation &nav, int32 slot)
+{
+    nav.FitLayer(blocks, std::shared_ptr<Block>(), 1);
+    blocks[slot] = std::make_shared<Block>();
+}
+
+void NavCrowd::Release(const MapNavigation &nav, int32 slot)
+{
+    if (slot < blocks.Count())
+        blocks[slot].reset();
+    nav.FitLayer(blocks, std::shared_ptr<Block>(), 1);
+}
+
+void NavCrowd::UpdateMasks(const MapNavigation &nav, const Array<Int2> &cells, int32 threshold)
+{
+    for (Int2 pos : cells)
+    {
+        int index = nav.CellIndex(pos);
+        if (index != -1)
+            blocks[index / BLOCK_CELLS]->crowded[index % BLOCK_CELLS].store(NeighborMask(nav, pos, threshold), std::memory_order_relaxed);
+    }
+}
+
+void NavCrowd::RebuildMasks(const MapNavigation &nav, int32 threshold)
+{
+    for (int32 slot = 0; slot < blocks.Count(); ++slot)
+    {
+        if (!blocks[slot])
+            continue;
+        for (int ix = 0; ix < BLOCK_CELLS; ++ix)
+            blocks[slot]->crowded[ix].store(NeighborMask(nav, nav.CellPos(slot * BLOCK_CELLS + ix), threshold), std::memory_order_relaxed);
+    }
+}
+
+uint8 NavCrowd::NeighborMask(const MapNavigation &nav, Int2 pos, int32 threshold) const
+{
+    if (threshold <= 0)
+        return 0;
+    uint8 mask = 0;
+    for (int dir = 0; dir < 4; ++dir)
+    {
+        int index = nav.CellIndex(MapNavigation::ForwardFrom(pos, (NavDir)dir));
+        if (index != -1 && blocks[index / BLOCK_CELLS]->counts[index % BLOCK_CELLS].load(std::memory_order_relaxed) >= threshold)
+            mask |= 1 << dir;
+    }
+    return mask;
+}
+
+const std::shared_ptr<NavCrowd::Block>& NavCrowd::SlotBlock(int32 slot) const
+{
+    return blocks[slot];
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include "Engine/Core/Math/Vector2.h"
+#include "Engine/Core/Collections/Array.h"
+#include "nav_traffic.h"
+
+class MapNavigation;
+
+
+// Number of visitors on each path cell of the navigation map. Visitors report moving from tile to tile, and
+// PickTile can make them avoid crowded tiles. The counters of each allocated chunk are in a block that the
+// published snapshots share, so they can be read and updated on any thread through a snapshot.
+class NavCrowd
+{
+public:
+    static constexpr int BLOCK_CELLS = 32 * 32;
+
+    struct Block
+    {
+        Block();
+
+        std::atomic<int32> counts[BLOCK_CELLS];
+        // Bits in NavDir order for the neighbors with at least the crowd threshold of visitors. Kept up to
+        // date when a count crosses the threshold, but visitors moving around the same cell on several threads
+        // at once can leave a bit stale until the next change around the cell.
+        std::atomic<uint8> crowded[BLOCK_CELLS];
+#if NAV_TRAFFIC_STATS
+        // Number of times visitors entered each cell, for NavTraffic.
+        std::atomic<uint32> visits[BLOCK_CELLS];
+#endif
+    };
+
+    // Drops the counters of every chunk.
+    void Rebuild(const MapNavigation &nav);
+    // Starts counting on a newly allocated chunk.
+    void Allocate(const MapNavigation &nav, int32 slot);
+    // Drops the counters of a released chunk. Snapshots that still share the block keep it alive.
+    void Release(const MapNavigation &nav, int32 slot);
+
+    // Recomputes the crowded neighbor bits of the cells.
+    void UpdateMasks(const MapNavigation &nav, const Array<Int2> &cells, int32 threshold);
+    // Recomputes the crowded neighbor bits of every cell, after the threshold changed.
+    void RebuildMasks(const MapNavigation &nav, int32 threshold);
+
+    const std::shared_ptr<Block>& SlotBlock(int32 slot) const;
+
+private:
+    uint8 NeighborMask(const MapNavigation &nav, Int2 pos, int32 threshold) const;
+
+    // Counters of the chunk in each slot, or null for free slots.
+    Array<std::shared_ptr<Block>> blocks;
+};
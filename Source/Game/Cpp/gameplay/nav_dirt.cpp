@@ -0,0 +1,250 @@
+#include "nav_dirt.h"
+#include "map_navigation.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NAV_DIRT_SSE 1
+#else
+#define NAV_DIRT_SSE 0
+#endif
+
+
+NavDirt::NavDirt() : time(0.0f)
+{
+    const float decay = std::pow(0.5f, TICK_INTERVAL / HALF_LIFE);
+    keep_factor = decay * (1.0f - 4.0f * SPREAD);
+    spread_factor = decay * SPREAD;
+}
+
+void NavDirt::Rebuild(const MapNavigation &nav)
+{
+    static_assert(BLOCK_STRIDE == MapNavigation::CHUNK_SIZE + 2, "Dirt blocks must match the navigation chunks.");
+
+    dirt.Clear();
+    next_dirt.Clear();
+    path_mask.Clear();
+    nav.FitLayer(dirt, 0.0f, BLOCK_CELLS);
+    nav.FitLayer(next_dirt, 0.0f, BLOCK_CELLS);
+    nav.FitLayer(path_mask, 0.0f, BLOCK_CELLS);
+    time = 0.0f;
+
+    for (int index = 0, count = nav.ChunkSlotCount() * MapNavigation::CHUNK_CELLS; index < count; ++index)
+    {
+        if (nav.GetCellType(index) == MapNavigation::CellType::Path)
+            path_mask[BlockIndex(index)] = 1.0f;
+    }
+}
+
+void NavDirt::Update(const MapNavigation &nav, const Array<Int2> &changed)
+{
+    nav.FitLayer(dirt, 0.0f, BLOCK_CELLS);
+    nav.FitLayer(next_dirt, 0.0f, BLOCK_CELLS);
+    nav.FitLayer(path_mask, 0.0f, BLOCK_CELLS);
+
+    for (Int2 pos : changed)
+    {
+        int index = nav.CellIndex(pos);
+        if (index == -1)
+            continue;
+        bool path = nav.GetCellType(index) == MapNavigation::CellType::Path;
+        path_mask[BlockIndex(index)] = path ? 1.0f : 0.0f;
+        if (!path)
+            dirt[BlockIndex(index)] = 0.0f;
+    }
+}
+
+void NavDirt::Advance(const MapNavigation &nav, float delta)
+{
+    time += delta;
+    int ticks = 0;
+    while (time >= TICK_INTERVAL && ticks < MAX_TICKS_PER_UPDATE)
+    {
+        time -= TICK_INTERVAL;
+        Tick(nav);
+        ++ticks;
+    }
+    if (ticks == MAX_TICKS_PER_UPDATE)
+        time = std::min(time, TICK_INTERVAL);
+}
+
+void NavDirt::Tick(const MapNavigation &nav)
+{
+    // Borders are filled for every block first, as the tick writes to the other buffer.
+    const int32 slots = std::min(nav.ChunkSlotCount(), dirt.Count() / BLOCK_CELLS);
+    for (int32 slot = 0; slot < slots; ++slot)
+    {
+        if (nav.SlotUsed(slot))
+            FillBorder(nav, slot);
+    }
+    for (int32 slot = 0; slot < slots; ++slot)
+    {
+        if (nav.SlotUsed(slot))
+            TickBlock(slot);
+    }
+    dirt.Swap(next_dirt);
+}
+
+void NavDirt::Add(const MapNavigation &nav, Int2 pos, float amount)
+{
+    int index = BlockIndex(nav.CellIndex(pos));
+    if (index == -1 || index >= dirt.Count())
+        return;
+    dirt[index] += amount * path_mask[index];
+}
+
+float NavDirt::Get(const MapNavigation &nav, Int2 pos) const
+{
+    int index = BlockIndex(nav.CellIndex(pos));
+    if (index == -1 || index >= dirt.Count())
+        return 0.0f;
+    return dirt[index];
+}
+
+void NavDirt::Dirtiest(const MapNavigation &nav, int count, Array<Int2> &result) const
+{
+    if (count <= 0)
+        return;
+
+    struct Candidate
+    {
+        float dirt;
+        int index;
+    };
+
+    // Min heap of the dirtiest cells found so far, so the least dirty one can be replaced. Cells without
+    // a path have no dirt, so free slots and the borders are skipped by the same check.
+    auto compare = [](const Candidate &a, const Candidate &b) { return a.dirt > b.dirt; };
+    Array<Candidate> heap;
+
+    const int cells = std::min(nav.ChunkSlotCount(), dirt.Count() / BLOCK_CELLS) * MapNavigation::CHUNK_CELLS;
+    for (int index = 0; index < cells; ++index)
+    {
+        float value = dirt[BlockIndex(index)];
+        if (value <= 0.0f)
+            continue;
+        if (heap.Count() < count)
+        {
+            heap.Add(Candidate{ value, index });
+            std::push_heap(heap.Get(), heap.Get() + heap.Count(), compare);
+        }
+        else if (value > heap[0].dirt)
+        {
+            std::pop_heap(heap.Get(), heap.Get() + heap.Count(), compare);
+            heap.Last() = Candidate{ value, index };
+            std::push_heap(heap.Get(), heap.Get() + heap.Count(), compare);
+        }
+    }
+
+    std::sort_heap(heap.Get(), heap.Get() + heap.Count(), compare);
+    for (const Candidate &candidate : heap)
+        result.Add(nav.CellPos(candidate.index));
+}
+
+float NavDirt::RegionTotal(const MapNavigation &nav, Int2 from, Int2 to) const
+{
+    const int left = std::max(0, std::min(from.X, to.X));
+    const int right = std::min(nav.map_size.X - 1, std::max(from.X, to.X));
+    const int bottom = std::max(0, std::min(from.Y, to.Y));
+    const int top = std::min(nav.map_size.Y - 1, std::max(from.Y, to.Y));
+    if (left > right || bottom > top)
+        return 0.0f;
+
+    // Only the allocated chunks overlapping the rectangle are summed.
+    float total = 0.0f;
+    const Int2 first = nav.ChunkOf(Int2(left, bottom));
+    const Int2 last = nav.ChunkOf(Int2(right, top));
+    for (int chunkY = first.Y; chunkY <= last.Y; ++chunkY)
+    {
+        for (int chunkX = first.X; chunkX <= last.X; ++chunkX)
+        {
+            int32 slot = nav.ChunkSlot(Int2(chunkX, chunkY));
+            if (slot == MapNavigation::NO_CHUNK || (slot + 1) * BLOCK_CELLS > dirt.Count())
+                continue;
+
+            const Int2 origin = nav.ChunkOrigin(slot);
+            const int x0 = std::max(left, origin.X) - origin.X;
+            const int x1 = std::min(right, origin.X + MapNavigation::CHUNK_SIZE - 1) - origin.X;
+            const int y0 = std::max(bottom, origin.Y) - origin.Y;
+            const int y1 = std::min(top, origin.Y + MapNavigation::CHUNK_SIZE - 1) - origin.Y;
+            for (int y = y0; y <= y1; ++y)
+            {
+                const float *row = dirt.Get() + slot * BLOCK_CELLS + (y + 1) * BLOCK_STRIDE + 1;
+                for (int x = x0; x <= x1; ++x)
+                    total += row[x];
+            }
+        }
+    }
+    return total;
+}
+
+int NavDirt::BlockIndex(int cell_index)
+{
+    if (cell_index == -1)
+        return -1;
+    const int slot = cell_index / MapNavigation::CHUNK_CELLS;
+    const int local = cell_index & (MapNavigation::CHUNK_CELLS - 1);
+    return slot * BLOCK_CELLS + ((local >> MapNavigation::CHUNK_SHIFT) + 1) * BLOCK_STRIDE + (local & (MapNavigation::CHUNK_SIZE - 1)) + 1;
+}
+
+void NavDirt::FillBorder(const MapNavigation &nav, int32 slot)
+{
+    // Missing neighbors and cells outside the map leave zero in the border, so no dirt comes from there.
+    const int SIZE = MapNavigation::CHUNK_SIZE;
+    const Int2 chunk = nav.SlotChunk(slot);
+    float *block = dirt.Get() + slot * BLOCK_CELLS;
+    auto neighborBlock = [&](int dx, int dy) -> const float* {
+        int32 other = nav.ChunkSlot(Int2(chunk.X + dx, chunk.Y + dy));
+        return other == MapNavigation::NO_CHUNK ? nullptr : dirt.Get() + other * BLOCK_CELLS;
+    };
+
+    const float *below = neighborBlock(0, -1);
+    const float *above = neighborBlock(0, 1);
+    const float *left = neighborBlock(-1, 0);
+    const float *right = neighborBlock(1, 0);
+    for (int ix = 1; ix <= SIZE; ++ix)
+    {
+        block[ix] = below != nullptr ? below[SIZE * BLOCK_STRIDE + ix] : 0.0f;
+        block[(SIZE + 1) * BLOCK_STRIDE + ix] = above != nullptr ? above[BLOCK_STRIDE + ix] : 0.0f;
+        block[ix * BLOCK_STRIDE] = left != nullptr ? left[ix * BLOCK_STRIDE + SIZE] : 0.0f;
+        block[ix * BLOCK_STRIDE + SIZE + 1] = right != nullptr ? right[ix * BLOCK_STRIDE + 1] : 0.0f;
+    }
+}
+
+void NavDirt::TickBlock(int32 slot)
+{
+    // Every cell keeps part of its dirt and receives part of the dirt of its 4 neighbors. Dirt that would
+    // spread to cells without a path is lost.
+    const int SIZE = MapNavigation::CHUNK_SIZE;
+    const float *source = dirt.Get() + slot * BLOCK_CELLS;
+    const float *mask = path_mask.Get() + slot * BLOCK_CELLS;
+    float *target = next_dirt.Get() + slot * BLOCK_CELLS;
+
+    for (int y = 1; y <= SIZE; ++y)
+    {
+        const int rowStart = y * BLOCK_STRIDE + 1;
+        const int rowEnd = rowStart + SIZE;
+        int index = rowStart;
+
+#if NAV_DIRT_SSE
+        const __m128 keep = _mm_set1_ps(keep_factor);
+        const __m128 spread = _mm_set1_ps(spread_factor);
+        for (; index + 4 <= rowEnd; index += 4)
+        {
+            __m128 neighbors = _mm_add_ps(
+                    _mm_add_ps(_mm_loadu_ps(source + index - 1), _mm_loadu_ps(source + index + 1)),
+                    _mm_add_ps(_mm_loadu_ps(source + index - BLOCK_STRIDE), _mm_loadu_ps(source + index + BLOCK_STRIDE)));
+            __m128 value = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(source + index), keep), _mm_mul_ps(neighbors, spread));
+            _mm_storeu_ps(target + index, _mm_mul_ps(value, _mm_loadu_ps(mask + index)));
+        }
+#endif
+
+        for (; index < rowEnd; ++index)
+        {
+            float neighbors = source[index - 1] + source[index + 1] + source[index - BLOCK_STRIDE] + source[index + BLOCK_STRIDE];
+            target[index] = (source[index] * keep_factor + neighbors * spread_factor) * mask[index];
+        }
+    }
+}
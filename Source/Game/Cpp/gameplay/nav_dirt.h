@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Engine/Core/Math/Vector2.h"
+#include "Engine/Core/Collections/Array.h"
+
+class MapNavigation;
+
+
+// Dirt on the path cells of the navigation map. Visitors leave dirt where they walk, and dirt is added by
+// events like vomiting. At a fixed tick the dirt slowly spreads to the neighboring path cells and decays.
+// Dirt is stored in a block for each allocated chunk of the map, with a border of one cell around it that is
+// filled from the neighboring chunks before a tick. This way the tick can run over whole rows of a block
+// with SIMD instructions without checking the chunk edges.
+class NavDirt
+{
+public:
+    // Seconds between ticks.
+    static constexpr float TICK_INTERVAL = 0.5f;
+    // Ticks run at most this many times in one update to catch up after a long frame.
+    static constexpr int MAX_TICKS_PER_UPDATE = 4;
+    // Seconds for dirt to decay to half of its amount.
+    static constexpr float HALF_LIFE = 600.0f;
+    // Part of the dirt moving to each of the 4 neighbors in a tick.
+    static constexpr float SPREAD = 0.02f;
+
+    NavDirt();
+
+    // Side of a block including the border, and the number of cells in it.
+    static constexpr int BLOCK_STRIDE = 32 + 2;
+    static constexpr int BLOCK_CELLS = BLOCK_STRIDE * BLOCK_STRIDE;
+
+    // Clears the dirt and sets up the blocks for the chunks of the map.
+    void Rebuild(const MapNavigation &nav);
+    // Updates which cells can hold dirt after the passed cells were added to or removed from the map.
+    void Update(const MapNavigation &nav, const Array<Int2> &changed);
+
+    // Runs the ticks that are due after delta seconds passed.
+    void Advance(const MapNavigation &nav, float delta);
+    void Tick(const MapNavigation &nav);
+
+    void Add(const MapNavigation &nav, Int2 pos, float amount);
+    float Get(const MapNavigation &nav, Int2 pos) const;
+    // Fills result with up to count cells with the most dirt, starting with the dirtiest.
+    void Dirtiest(const MapNavigation &nav, int count, Array<Int2> &result) const;
+    // Sum of the dirt in the rectangle between the from and to cells, including both.
+    float RegionTotal(const MapNavigation &nav, Int2 from, Int2 to) const;
+
+private:
+    // Index in the blocks of the cell at an index returned by MapNavigation::CellIndex, or -1.
+    static int BlockIndex(int cell_index);
+    // Copies the edges of the neighboring chunks into the border of the block in slot.
+    void FillBorder(const MapNavigation &nav, int32 slot);
+    // Runs the tick on the block in slot.
+    void TickBlock(int32 slot);
+
+    // Dirt of each block cell, and the dirt after the next tick.
+    Array<float> dirt;
+    Array<float> next_dirt;
+    // 1 for path cells that can hold dirt, 0 for the rest and the borders.
+    Array<float> path_mask;
+
+    // Time passed since the last tick.
+    float time;
+    // Multipliers of the dirt on a cell, and on its neighbors to get the dirt after a tick.
+    float keep_factor;
+    float spread_factor;
+};
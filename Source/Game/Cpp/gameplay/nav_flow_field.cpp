@@ -0,0 +1,205 @@
+#include "nav_flow_field.h"
+#include "map_navigation.h"
+
+#include <algorithm>
+
+
+NavFlowField::NavFlowField(const Array<Int2> &goal_cells)
+{
+    for (Int2 pos : goal_cells)
+    {
+        if (goals.Add(pos))
+            goal_list.Add(pos);
+    }
+}
+
+void NavFlowField::Rebuild(const MapNavigation &nav)
+{
+    distances.Clear();
+    nav.FitLayer(distances, UNREACHABLE);
+
+    Array<Int2> seeds;
+    for (Int2 pos : goal_list)
+    {
+        int index = nav.CellIndex(pos);
+        if (index == -1 || nav.GetCellType(index) != MapNavigation::CellType::Path)
+            continue;
+        distances[index] = 0;
+        seeds.Add(pos);
+    }
+    Propagate(nav, seeds);
+}
+
+void NavFlowField::Update(const MapNavigation &nav, const Array<Int2> &changed)
+{
+    nav.FitLayer(distances, UNREACHABLE);
+
+    // Removed cells can only make distances longer. Cells that lost their shortest path are invalidated
+    // first, and then get their new distances from the valid cells around them.
+    Array<Int2> removed;
+    Array<Int2> seeds;
+    for (Int2 pos : changed)
+    {
+        int index = nav.CellIndex(pos);
+        if (index == -1)
+            continue;
+        if (nav.GetCellType(index) != MapNavigation::CellType::Path)
+        {
+            if (distances[index] != UNREACHABLE)
+                removed.Add(pos);
+        }
+        else
+            seeds.Add(pos);
+    }
+
+    if (removed.Count() != 0)
+        Invalidate(nav, removed, seeds);
+
+    // Added cells and invalidated cells get the best distance from their neighbors, which is then
+    // spread to the rest of the map.
+    for (int ix = seeds.Count() - 1; ix >= 0; --ix)
+    {
+        int index = nav.CellIndex(seeds[ix]);
+        int32 best = BestDistance(nav, seeds[ix]);
+        if (best < distances[index])
+            distances[index] = best;
+        if (distances[index] == UNREACHABLE)
+            seeds.RemoveAt(ix);
+    }
+    Propagate(nav, seeds);
+}
+
+void NavFlowField::Move(Int2 offset)
+{
+    goals.Clear();
+    for (Int2 &pos : goal_list)
+    {
+        pos = Int2(pos.X + offset.X, pos.Y + offset.Y);
+        goals.Add(pos);
+    }
+}
+
+int32 NavFlowField::Distance(const MapNavigation &nav, Int2 pos) const
+{
+    int index = nav.CellIndex(pos);
+    if (index == -1 || index >= distances.Count())
+        return UNREACHABLE;
+    return distances[index];
+}
+
+Int2 NavFlowField::Step(const MapNavigation &nav, Int2 pos, NavDir dir) const
+{
+    int32 distance = Distance(nav, pos);
+    if (distance == 0 || distance == UNREACHABLE)
+        return pos;
+
+    Int2 next = nav.ForwardFrom(pos, dir);
+    if (Distance(nav, next) == distance - 1)
+        return next;
+
+    for (int side = 0; side < 4; ++side)
+    {
+        next = nav.ForwardFrom(pos, (NavDir)side);
+        if (Distance(nav, next) == distance - 1)
+            return next;
+    }
+    return pos;
+}
+
+int32 NavFlowField::BestDistance(const MapNavigation &nav, Int2 pos) const
+{
+    if (goals.Contains(pos))
+        return 0;
+
+    int32 best = UNREACHABLE;
+    for (int side = 0; side < 4; ++side)
+    {
+        int32 distance = Distance(nav, nav.ForwardFrom(pos, (NavDir)side));
+        if (distance != UNREACHABLE)
+            best = std::min(best, distance + 1);
+    }
+    return best;
+}
+
+void NavFlowField::Propagate(const MapNavigation &nav, Array<Int2> &seeds)
+{
+    // Breadth first search, started from the seeds in the order of their distance. The seeds and the
+    // cells found by the search are merged, so cells are visited in the order of their distance as well.
+    std::sort(seeds.Get(), seeds.Get() + seeds.Count(), [&](const Int2 &a, const Int2 &b) {
+        return distances[nav.CellIndex(a)] < distances[nav.CellIndex(b)];
+    });
+
+    Array<Int2> queue;
+    int head = 0;
+    int seed = 0;
+    while (seed < seeds.Count() || head < queue.Count())
+    {
+        Int2 pos;
+        if (head == queue.Count() || (seed < seeds.Count() &&
+                distances[nav.CellIndex(seeds[seed])] <= distances[nav.CellIndex(queue[head])]))
+            pos = seeds[seed++];
+        else
+            pos = queue[head++];
+
+        int32 next_distance = distances[nav.CellIndex(pos)] + 1;
+        for (int side = 0; side < 4; ++side)
+        {
+            Int2 next = nav.ForwardFrom(pos, (NavDir)side);
+            int index = nav.CellIndex(next);
+            if (index == -1 || nav.GetCellType(index) != MapNavigation::CellType::Path || distances[index] <= next_distance)
+                continue;
+            distances[index] = next_distance;
+            queue.Add(next);
+        }
+    }
+}
+
+void NavFlowField::Invalidate(const MapNavigation &nav, const Array<Int2> &removed, Array<Int2> &invalidated)
+{
+    // Candidates are checked in the order of their old distance. By the time a cell is checked, every
+    // cell closer to the goal was already invalidated if it had to be, so a neighbor one step closer
+    // means the cell can still reach the goal the same way.
+    Array<Candidate> heap;
+    auto compare = [](const Candidate &a, const Candidate &b) { return a.distance > b.distance; };
+    auto addDependents = [&](Int2 pos, int32 distance)
+    {
+        for (int side = 0; side < 4; ++side)
+        {
+            Int2 next = nav.ForwardFrom(pos, (NavDir)side);
+            int index = nav.CellIndex(next);
+            if (index == -1 || distances[index] != distance + 1)
+                continue;
+            heap.Add(Candidate{ distance + 1, next });
+            std::push_heap(heap.Get(), heap.Get() + heap.Count(), compare);
+        }
+    };
+
+    for (Int2 pos : removed)
+    {
+        int index = nav.CellIndex(pos);
+        int32 distance = distances[index];
+        distances[index] = UNREACHABLE;
+        addDependents(pos, distance);
+    }
+
+    while (heap.Count() != 0)
+    {
+        std::pop_heap(heap.Get(), heap.Get() + heap.Count(), compare);
+        Candidate candidate = heap.Last();
+        heap.RemoveLast();
+
+        int index = nav.CellIndex(candidate.pos);
+        if (distances[index] != candidate.distance || goals.Contains(candidate.pos))
+            continue;
+
+        bool supported = false;
+        for (int side = 0; side < 4 && !supported; ++side)
+            supported = Distance(nav, nav.ForwardFrom(candidate.pos, (NavDir)side)) == candidate.distance - 1;
+        if (supported)
+            continue;
+
+        distances[index] = UNREACHABLE;
+        invalidated.Add(candidate.pos);
+        addDependents(candidate.pos, candidate.distance);
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Engine/Core/Math/Vector2.h"
+#include "Engine/Core/Collections/Array.h"
+#include "Engine/Core/Collections/HashSet.h"
+
+class MapNavigation;
+enum class NavDir : uint8;
+
+
+// Walking distance from every path cell of the navigation map to the nearest cell of a goal set. The
+// distances are updated incrementally when path cells are added or removed, only touching the cells whose
+// distance actually changes. Visitors heading for the goal step to a neighbor with a smaller distance.
+class NavFlowField
+{
+public:
+    static constexpr int32 UNREACHABLE = 0x7fffffff;
+
+    NavFlowField(const Array<Int2> &goal_cells);
+
+    // Computes the distances on the whole map from scratch.
+    void Rebuild(const MapNavigation &nav);
+    // Updates the distances after the passed cells were added to or removed from the navigation map.
+    void Update(const MapNavigation &nav, const Array<Int2> &changed);
+    // Moves the goal cells by offset after the map was resized.
+    void Move(Int2 offset);
+
+    // Number of steps from pos to the nearest goal cell, or UNREACHABLE.
+    int32 Distance(const MapNavigation &nav, Int2 pos) const;
+    // Neighbor of pos that is one step closer to the goal, preferring the one in the walking direction.
+    // Returns pos if it's a goal cell or when no goal can be reached from it.
+    Int2 Step(const MapNavigation &nav, Int2 pos, NavDir dir) const;
+
+private:
+    struct Candidate
+    {
+        int32 distance;
+        Int2 pos;
+    };
+
+    // Lowest distance of pos through one of its neighbors, or 0 if it's a goal.
+    int32 BestDistance(const MapNavigation &nav, Int2 pos) const;
+    // Decreases distances starting from the seed cells until no shorter path is found.
+    void Propagate(const MapNavigation &nav, Array<Int2> &seeds);
+    // Invalidates the distances that depended on the removed cells, and returns the cells that need
+    // a new distance.
+    void Invalidate(const MapNavigation &nav, const Array<Int2> &removed, Array<Int2> &invalidated);
+
+    HashSet<Int2> goals;
+    Array<Int2> goal_list;
+    Array<int32> distances;
+};
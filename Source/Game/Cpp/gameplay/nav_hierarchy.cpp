@@ -0,0 +1,428 @@
+#include "nav_hierarchy.h"
+#include "map_navigation.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+
+namespace
+{
+    // Runs of entrance cells at least this long get an entrance at both ends instead of one in the middle.
+    constexpr int LONG_RUN_LENGTH = 6;
+
+    NavDir OppositeDirection(NavDir dir)
+    {
+        // Up and Down, and Left and Right only differ in the lowest bit.
+        return (NavDir)((int)dir ^ 1);
+    }
+
+    int32 ManhattanDistance(Int2 a, Int2 b)
+    {
+        return std::abs(a.X - b.X) + std::abs(a.Y - b.Y);
+    }
+}
+
+
+NavHierarchy::NavHierarchy() : cluster_count(0, 0), cell_offset(0, 0), node_count(0), search_stamp(0)
+{
+    local_distances.AddUninitialized(CLUSTER_SIZE * CLUSTER_SIZE);
+}
+
+void NavHierarchy::Rebuild(const MapNavigation &nav)
+{
+    cell_offset = nav.map_origin;
+    cluster_count = ClusterCount(nav);
+    clusters.Clear();
+    clusters.Resize(cluster_count.X * cluster_count.Y);
+    for (int ix = 0; ix < clusters.Count(); ++ix)
+        RefreshCluster(nav, ix);
+    for (int ix = 0; ix < clusters.Count(); ++ix)
+        LinkPartners(nav, ix);
+    UpdateNodes();
+}
+
+void NavHierarchy::Update(const MapNavigation &nav, const Array<Int2> &changed)
+{
+    if (cell_offset != nav.map_origin || cluster_count != ClusterCount(nav))
+    {
+        Rebuild(nav);
+        return;
+    }
+
+    // Entrances depend on the cells on both sides of a cluster border, so a change on the border refreshes
+    // the cluster on the other side too.
+    Array<int> dirty;
+    auto markCluster = [](Array<int> &list, int cluster) {
+        if (!list.Contains(cluster))
+            list.Add(cluster);
+    };
+
+    for (Int2 pos : changed)
+    {
+        if (nav.CellIndex(pos) == -1)
+            continue;
+        int cluster = ClusterIndex(pos);
+        Int2 local = pos - ClusterOrigin(cluster);
+        Int2 coords(cluster % cluster_count.X, cluster / cluster_count.X);
+        markCluster(dirty, cluster);
+        if (local.X == 0 && coords.X > 0)
+            markCluster(dirty, cluster - 1);
+        if (local.X == CLUSTER_SIZE - 1 && coords.X < cluster_count.X - 1)
+            markCluster(dirty, cluster + 1);
+        if (local.Y == 0 && coords.Y > 0)
+            markCluster(dirty, cluster - cluster_count.X);
+        if (local.Y == CLUSTER_SIZE - 1 && coords.Y < cluster_count.Y - 1)
+            markCluster(dirty, cluster + cluster_count.X);
+    }
+
+    if (dirty.Count() == 0)
+        return;
+
+    // Partners are linked by their index in the neighboring cluster, which changes on a refresh, so the
+    // neighbors of refreshed clusters are linked again as well.
+    Array<int> relink;
+    for (int cluster : dirty)
+    {
+        RefreshCluster(nav, cluster);
+
+        Int2 coords(cluster % cluster_count.X, cluster / cluster_count.X);
+        markCluster(relink, cluster);
+        if (coords.X > 0)
+            markCluster(relink, cluster - 1);
+        if (coords.X < cluster_count.X - 1)
+            markCluster(relink, cluster + 1);
+        if (coords.Y > 0)
+            markCluster(relink, cluster - cluster_count.X);
+        if (coords.Y < cluster_count.Y - 1)
+            markCluster(relink, cluster + cluster_count.X);
+    }
+    for (int cluster : relink)
+        LinkPartners(nav, cluster);
+    UpdateNodes();
+}
+
+void NavHierarchy::Resize(const MapNavigation &nav, Int2 offset)
+{
+    const Int2 old_count = cluster_count;
+    const Int2 old_offset = cell_offset;
+    Array<Cluster> old_clusters;
+    old_clusters.Swap(clusters);
+
+    cell_offset = nav.map_origin;
+    cluster_count = ClusterCount(nav);
+    clusters.Resize(cluster_count.X * cluster_count.Y);
+
+    // Cells moved by offset on the map, and the clusters by the change of their origin, which is always a
+    // whole number of clusters as the map origin stays inside the first chunk.
+    const Int2 moved((offset.X + cell_offset.X - old_offset.X) / CLUSTER_SIZE, (offset.Y + cell_offset.Y - old_offset.Y) / CLUSTER_SIZE);
+    for (int ix = 0; ix < old_clusters.Count(); ++ix)
+    {
+        Int2 coords(ix % old_count.X + moved.X, ix / old_count.X + moved.Y);
+        if (coords.X < 0 || coords.Y < 0 || coords.X >= cluster_count.X || coords.Y >= cluster_count.Y)
+            continue;
+
+        Cluster &cluster = clusters[coords.X + coords.Y * cluster_count.X];
+        cluster.entrances.Swap(old_clusters[ix].entrances);
+        cluster.distances.Swap(old_clusters[ix].distances);
+        for (Entrance &entrance : cluster.entrances)
+            entrance.pos = Int2(entrance.pos.X + offset.X, entrance.pos.Y + offset.Y);
+    }
+    UpdateNodes();
+}
+
+bool NavHierarchy::FindPath(const MapNavigation &nav, Int2 from, Int2 to, Array<Int2> &path)
+{
+    if (!IsPath(nav, from) || !IsPath(nav, to) || clusters.Count() == 0)
+        return false;
+    if (from == to)
+    {
+        path.Add(from);
+        return true;
+    }
+
+    // The start and the goal are the last two nodes, connected to the entrances of their clusters.
+    const int32 start = node_count - 2;
+    const int32 goal = start + 1;
+    const int from_cluster = ClusterIndex(from);
+    const int to_cluster = ClusterIndex(to);
+
+    if (++search_stamp == 0)
+    {
+        node_stamps.SetAll(0);
+        search_stamp = 1;
+    }
+    open.Clear();
+
+    SearchCluster(nav, to_cluster, to);
+    const Cluster &target = clusters[to_cluster];
+    goal_costs.Clear();
+    for (const Entrance &entrance : target.entrances)
+        goal_costs.Add(LocalDistance(to_cluster, entrance.pos));
+
+    SearchCluster(nav, from_cluster, from);
+    const Cluster &source = clusters[from_cluster];
+    node_stamps[start] = search_stamp;
+    node_clusters[start] = from_cluster;
+    node_positions[start] = from;
+    node_costs[start] = 0;
+    node_parents[start] = -1;
+    for (int ix = 0; ix < source.entrances.Count(); ++ix)
+    {
+        int32 distance = LocalDistance(from_cluster, source.entrances[ix].pos);
+        if (distance != UNREACHABLE)
+            Relax(first_nodes[from_cluster] + ix, from_cluster, source.entrances[ix].pos, distance, start, to);
+    }
+    if (from_cluster == to_cluster && LocalDistance(from_cluster, to) != UNREACHABLE)
+        Relax(goal, to_cluster, to, LocalDistance(from_cluster, to), start, to);
+
+    while (open.Count() != 0)
+    {
+        std::pop_heap(open.Get(), open.Get() + open.Count(), CandidateAfter);
+        Candidate candidate = open.Last();
+        open.RemoveLast();
+
+        const int32 node = candidate.node;
+        const int32 cost = node_costs[node];
+        // Nodes are added again when a shorter distance is found, which makes the old candidate stale.
+        if (cost != candidate.cost)
+            continue;
+        if (node == goal)
+            break;
+
+        const int cluster = node_clusters[node];
+        const int entrance = node - first_nodes[cluster];
+        const Cluster &data = clusters[cluster];
+        const int count = data.entrances.Count();
+        for (int ix = 0; ix < count; ++ix)
+        {
+            int32 distance = data.distances[entrance * count + ix];
+            if (ix != entrance && distance != UNREACHABLE)
+                Relax(first_nodes[cluster] + ix, cluster, data.entrances[ix].pos, cost + distance, node, to);
+        }
+
+        const Entrance &current = data.entrances[entrance];
+        if (current.partner != -1)
+        {
+            int partner_cluster = ClusterIndex(nav.ForwardFrom(current.pos, current.side));
+            const Entrance &partner = clusters[partner_cluster].entrances[current.partner];
+            Relax(first_nodes[partner_cluster] + current.partner, partner_cluster, partner.pos, cost + 1, node, to);
+        }
+
+        if (cluster == to_cluster && goal_costs[entrance] != UNREACHABLE)
+            Relax(goal, to_cluster, to, cost + goal_costs[entrance], node, to);
+    }
+
+    if (node_stamps[goal] != search_stamp)
+        return false;
+
+    route.Clear();
+    for (int32 node = goal; node != -1; node = node_parents[node])
+        route.Add(node);
+
+    // Consecutive nodes are either in the same cluster, or on the two sides of a cluster border.
+    path.Add(from);
+    for (int ix = route.Count() - 1; ix > 0; --ix)
+    {
+        Int2 a = node_positions[route[ix]];
+        Int2 b = node_positions[route[ix - 1]];
+        if (a == b)
+            continue;
+        if (ClusterIndex(a) != ClusterIndex(b))
+            path.Add(b);
+        else
+            AddLocalPath(nav, ClusterIndex(a), a, b, path);
+    }
+    return true;
+}
+
+Int2 NavHierarchy::ClusterCount(const MapNavigation &nav) const
+{
+    return Int2((nav.map_size.X + nav.map_origin.X + CLUSTER_SIZE - 1) / CLUSTER_SIZE, (nav.map_size.Y + nav.map_origin.Y + CLUSTER_SIZE - 1) / CLUSTER_SIZE);
+}
+
+int NavHierarchy::ClusterIndex(Int2 pos) const
+{
+    return (pos.X + cell_offset.X) / CLUSTER_SIZE + ((pos.Y + cell_offset.Y) / CLUSTER_SIZE) * cluster_count.X;
+}
+
+Int2 NavHierarchy::ClusterOrigin(int cluster) const
+{
+    return Int2((cluster % cluster_count.X) * CLUSTER_SIZE - cell_offset.X, (cluster / cluster_count.X) * CLUSTER_SIZE - cell_offset.Y);
+}
+
+void NavHierarchy::RefreshCluster(const MapNavigation &nav, int cluster)
+{
+    Cluster &data = clusters[cluster];
+    const Int2 origin = ClusterOrigin(cluster);
+    const Int2 coords(cluster % cluster_count.X, cluster / cluster_count.X);
+
+    // Clusters on the map border can be partly outside the map, where there are no path cells.
+    data.entrances.Clear();
+    if (coords.Y > 0)
+        AddBorderEntrances(nav, origin, Int2(1, 0), CLUSTER_SIZE, NavDir::Down, data.entrances);
+    if (coords.Y < cluster_count.Y - 1)
+        AddBorderEntrances(nav, Int2(origin.X, origin.Y + CLUSTER_SIZE - 1), Int2(1, 0), CLUSTER_SIZE, NavDir::Up, data.entrances);
+    if (coords.X > 0)
+        AddBorderEntrances(nav, origin, Int2(0, 1), CLUSTER_SIZE, NavDir::Left, data.entrances);
+    if (coords.X < cluster_count.X - 1)
+        AddBorderEntrances(nav, Int2(origin.X + CLUSTER_SIZE - 1, origin.Y), Int2(0, 1), CLUSTER_SIZE, NavDir::Right, data.entrances);
+
+    const int count = data.entrances.Count();
+    data.distances.Clear();
+    data.distances.AddUninitialized(count * count);
+    for (int ix = 0; ix < count; ++ix)
+    {
+        SearchCluster(nav, cluster, data.entrances[ix].pos);
+        for (int iy = 0; iy < count; ++iy)
+            data.distances[ix * count + iy] = LocalDistance(cluster, data.entrances[iy].pos);
+    }
+}
+
+void NavHierarchy::AddBorderEntrances(const MapNavigation &nav, Int2 start, Int2 step, int length, NavDir side, Array<Entrance> &entrances) const
+{
+    // The clusters on both sides of the border find the same runs, so every entrance has a partner on the
+    // other side at the same position along the border.
+    auto borderCell = [start, step](int ix) { return Int2(start.X + step.X * ix, start.Y + step.Y * ix); };
+    int run_start = 0;
+    for (int ix = 0; ix <= length; ++ix)
+    {
+        Int2 pos = borderCell(ix);
+        if (ix < length && IsPath(nav, pos) && IsPath(nav, nav.ForwardFrom(pos, side)))
+            continue;
+
+        int run_length = ix - run_start;
+        if (run_length >= LONG_RUN_LENGTH)
+        {
+            entrances.Add(Entrance{ borderCell(run_start), side, -1 });
+            entrances.Add(Entrance{ borderCell(ix - 1), side, -1 });
+        }
+        else if (run_length > 0)
+            entrances.Add(Entrance{ borderCell(run_start + (run_length - 1) / 2), side, -1 });
+        run_start = ix + 1;
+    }
+}
+
+void NavHierarchy::LinkPartners(const MapNavigation &nav, int cluster)
+{
+    for (Entrance &entrance : clusters[cluster].entrances)
+    {
+        const Int2 pos = nav.ForwardFrom(entrance.pos, entrance.side);
+        const NavDir side = OppositeDirection(entrance.side);
+        const Array<Entrance> &entrances = clusters[ClusterIndex(pos)].entrances;
+        entrance.partner = -1;
+        for (int ix = 0; ix < entrances.Count() && entrance.partner == -1; ++ix)
+        {
+            if (entrances[ix].pos == pos && entrances[ix].side == side)
+                entrance.partner = ix;
+        }
+    }
+}
+
+void NavHierarchy::UpdateNodes()
+{
+    first_nodes.Clear();
+    node_count = 0;
+    for (const Cluster &cluster : clusters)
+    {
+        first_nodes.Add(node_count);
+        node_count += cluster.entrances.Count();
+    }
+    // Start and goal nodes of searches.
+    node_count += 2;
+
+    // Stamps are only compared to the current search, so only the new nodes need to be cleared.
+    const int cleared = node_stamps.Count();
+    if (node_count > cleared)
+    {
+        node_clusters.Resize(node_count);
+        node_positions.Resize(node_count);
+        node_costs.Resize(node_count);
+        node_parents.Resize(node_count);
+        node_stamps.Resize(node_count);
+        for (int ix = cleared; ix < node_count; ++ix)
+            node_stamps[ix] = 0;
+    }
+}
+
+void NavHierarchy::SearchCluster(const MapNavigation &nav, int cluster, Int2 pos)
+{
+    const Int2 origin = ClusterOrigin(cluster);
+
+    local_distances.SetAll(UNREACHABLE);
+    local_queue.Clear();
+    local_distances[(pos.X - origin.X) + (pos.Y - origin.Y) * CLUSTER_SIZE] = 0;
+    local_queue.Add(pos);
+
+    for (int head = 0; head < local_queue.Count(); ++head)
+    {
+        Int2 current = local_queue[head];
+        int32 distance = local_distances[(current.X - origin.X) + (current.Y - origin.Y) * CLUSTER_SIZE] + 1;
+        for (int side = 0; side < 4; ++side)
+        {
+            Int2 next = nav.ForwardFrom(current, (NavDir)side);
+            Int2 local = next - origin;
+            if (local.X < 0 || local.Y < 0 || local.X >= CLUSTER_SIZE || local.Y >= CLUSTER_SIZE)
+                continue;
+            int32 &next_distance = local_distances[local.X + local.Y * CLUSTER_SIZE];
+            if (next_distance != UNREACHABLE || !IsPath(nav, next))
+                continue;
+            next_distance = distance;
+            local_queue.Add(next);
+        }
+    }
+}
+
+int32 NavHierarchy::LocalDistance(int cluster, Int2 pos) const
+{
+    Int2 local = pos - ClusterOrigin(cluster);
+    if (local.X < 0 || local.Y < 0 || local.X >= CLUSTER_SIZE || local.Y >= CLUSTER_SIZE)
+        return UNREACHABLE;
+    return local_distances[local.X + local.Y * CLUSTER_SIZE];
+}
+
+void NavHierarchy::AddLocalPath(const MapNavigation &nav, int cluster, Int2 from, Int2 to, Array<Int2> &path)
+{
+    // Searching from the end lets the path follow decreasing distances from the start.
+    SearchCluster(nav, cluster, to);
+    Int2 pos = from;
+    for (int32 distance = LocalDistance(cluster, from); distance > 0 && distance != UNREACHABLE; --distance)
+    {
+        for (int side = 0; side < 4; ++side)
+        {
+            Int2 next = nav.ForwardFrom(pos, (NavDir)side);
+            if (LocalDistance(cluster, next) == distance - 1)
+            {
+                pos = next;
+                break;
+            }
+        }
+        path.Add(pos);
+    }
+}
+
+void NavHierarchy::Relax(int32 node, int cluster, Int2 pos, int32 cost, int32 parent, Int2 goal)
+{
+    if (node_stamps[node] == search_stamp && node_costs[node] <= cost)
+        return;
+
+    node_stamps[node] = search_stamp;
+    node_clusters[node] = cluster;
+    node_positions[node] = pos;
+    node_costs[node] = cost;
+    node_parents[node] = parent;
+    open.Add(Candidate{ cost + ManhattanDistance(pos, goal), cost, node });
+    std::push_heap(open.Get(), open.Get() + open.Count(), CandidateAfter);
+}
+
+bool NavHierarchy::CandidateAfter(const Candidate &a, const Candidate &b)
+{
+    if (a.estimate != b.estimate)
+        return a.estimate > b.estimate;
+    return a.cost < b.cost;
+}
+
+bool NavHierarchy::IsPath(const MapNavigation &nav, Int2 pos) const
+{
+    int index = nav.CellIndex(pos);
+    return index != -1 && nav.GetCellType(index) == MapNavigation::CellType::Path;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "Engine/Core/Math/Vector2.h"
+#include "Engine/Core/Collections/Array.h"
+
+class MapNavigation;
+enum class NavDir : uint8;
+
+
+// Hierarchical pathfinding (HPA*) over the path cells of the navigation map. The map is split into square
+// clusters, and the path cells where two clusters meet are the entrances between them. The walking distance
+// between every pair of entrances of a cluster is cached, so searches only have to visit entrances, and the
+// cell by cell path is only looked up inside the clusters along the way. When path cells change, only the
+// clusters they are in, or on the border of, are updated.
+class NavHierarchy
+{
+public:
+    static constexpr int CLUSTER_SIZE = 16;
+    static constexpr int32 UNREACHABLE = 0x7fffffff;
+
+    NavHierarchy();
+
+    // Computes the clusters and entrances on the whole map from scratch.
+    void Rebuild(const MapNavigation &nav);
+    // Updates the clusters that contain, or have an entrance next to the passed changed cells.
+    void Update(const MapNavigation &nav, const Array<Int2> &changed);
+    // Moves the clusters to their place on the resized map. Clusters are aligned to the chunks of the map,
+    // so they keep their cells, and paths outside the map must have been removed already.
+    void Resize(const MapNavigation &nav, Int2 offset);
+
+    // Adds the cells of a path from one path cell to another to the path array, including the first and
+    // last cells. Returns false if no path was found.
+    bool FindPath(const MapNavigation &nav, Int2 from, Int2 to, Array<Int2> &path);
+
+private:
+    // Path cell on the border of a cluster, with a path cell next to it on the other side.
+    struct Entrance
+    {
+        Int2 pos;
+        // Direction of the neighboring cluster.
+        NavDir side;
+        // Index of the entrance on the other side of the border in the neighboring cluster.
+        int partner;
+    };
+
+    struct Cluster
+    {
+        Array<Entrance> entrances;
+        // Walking distance between each pair of entrances without leaving the cluster, in an
+        // entrances.Count() * entrances.Count() matrix.
+        Array<int32> distances;
+    };
+
+    struct Candidate
+    {
+        // Walking distance from the start, plus the lowest possible distance to the goal.
+        int32 estimate;
+        int32 cost;
+        int32 node;
+    };
+
+    // Number of clusters along each side of the map.
+    Int2 ClusterCount(const MapNavigation &nav) const;
+    int ClusterIndex(Int2 pos) const;
+    // Position of the first cell of the cluster, which can be outside the map for clusters on the border.
+    Int2 ClusterOrigin(int cluster) const;
+
+    void RefreshCluster(const MapNavigation &nav, int cluster);
+    // Adds an entrance for each run of path cells along one border of the cluster, or two at the ends of long runs.
+    void AddBorderEntrances(const MapNavigation &nav, Int2 start, Int2 step, int length, NavDir side, Array<Entrance> &entrances) const;
+    // Finds the partners of the entrances of a cluster.
+    void LinkPartners(const MapNavigation &nav, int cluster);
+    // Assigns the node numbers used in searches to the entrances of every cluster.
+    void UpdateNodes();
+
+    // Fills local_distances with the walking distance from pos to the cells of its cluster.
+    void SearchCluster(const MapNavigation &nav, int cluster, Int2 pos);
+    int32 LocalDistance(int cluster, Int2 pos) const;
+    // Adds the cells of the path inside the cluster from one cell to another, not including the first cell.
+    void AddLocalPath(const MapNavigation &nav, int cluster, Int2 from, Int2 to, Array<Int2> &path);
+
+    // Sets the walking distance of a node in the search if it's lower than the one already found.
+    void Relax(int32 node, int cluster, Int2 pos, int32 cost, int32 parent, Int2 goal);
+    // Ordering of the open heap with the lowest estimate on top, preferring candidates further from the start.
+    static bool CandidateAfter(const Candidate &a, const Candidate &b);
+    bool IsPath(const MapNavigation &nav, Int2 pos) const;
+
+    Int2 cluster_count;
+    // Position of the first cell of the map in its cluster, the map_origin of the navigation.
+    Int2 cell_offset;
+    Array<Cluster> clusters;
+    // Node number of the first entrance of each cluster. Nodes of a cluster are numbered consecutively,
+    // and the start and goal of searches are the last two nodes.
+    Array<int32> first_nodes;
+    int32 node_count;
+
+    // Scratch data of searches.
+    Array<int32> local_distances;
+    Array<Int2> local_queue;
+    // Cluster and position of the nodes reached in the search.
+    Array<int32> node_clusters;
+    Array<Int2> node_positions;
+    Array<int32> node_costs;
+    Array<int32> node_parents;
+    Array<uint32> node_stamps;
+    uint32 search_stamp;
+    Array<Candidate> open;
+    Array<int32> goal_costs;
+    Array<int32> route;
+};
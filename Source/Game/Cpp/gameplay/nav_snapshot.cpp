@@ -0,0 +1,235 @@
+#include "nav_snapshot.h"
+#include "Engine/Debug/DebugLog.h"
+#include "../util/randomizer.h"
+
+#include <algorithm>
+
+
+NavSnapshot::NavSnapshot() : version(0), readers(0), map_size(0, 0), map_origin(0, 0), chunk_count(0, 0), crowd_threshold(0)
+#if NAV_TRAFFIC_STATS
+    , traffic(nullptr)
+#endif
+{
+}
+
+uint64 NavSnapshot::Version() const
+{
+    return version;
+}
+
+Int2 NavSnapshot::MapSize() const
+{
+    return map_size;
+}
+
+bool NavSnapshot::IsPath(Int2 pos) const
+{
+    // Every path cell is classified by the time the snapshot is published.
+    return PathTypeAt(pos) != MapNavigation::PathType::Empty;
+}
+
+Int2 NavSnapshot::PickTile(Int2 pos, NavDir dir, RandomizerStream &stream) const
+{
+    if (pos.Y < 0)
+        return EnterTile(pos, dir);
+
+    const int entryIndex = TurnIndex(pos, dir);
+    const MapNavigation::TurnEntry &entry = MapNavigation::turn_table.entries[entryIndex];
+    const int outcome = entry.fixed != MapNavigation::TURN_RANDOM ? entry.fixed : RandomOutcome(pos, entry, stream.Rand());
+#if NAV_TRAFFIC_STATS
+    traffic->AddDecision(entryIndex, outcome);
+#endif
+    return MapNavigation::OutcomeTile(pos, outcome);
+}
+
+void NavSnapshot::PickTiles(const Span<Int2>& positions, const Span<NavDir>& dirs, Span<RandomizerStream> streams, Span<Int2> results) const
+{
+    const int count = positions.Length();
+    if (dirs.Length() < count || streams.Length() < count || results.Length() < count)
+    {
+        DebugLog::LogError(TEXT("PickTiles needs a direction, a random stream and a result slot for every position."));
+        return;
+    }
+
+    // Every visitor has its own stream, so the order the batch is computed in doesn't matter.
+    MapNavigation::PickBlocks(count, [&](int32 from, int32 to)
+    {
+        for (int ix = from; ix < to; ++ix)
+            results[ix] = PickTile(positions[ix], dirs[ix], streams[ix]);
+    });
+}
+
+int32 NavSnapshot::Occupancy(Int2 pos) const
+{
+    std::atomic<int32> *counter = Counter(pos);
+    return counter != nullptr ? std::max(counter->load(std::memory_order_relaxed), 0) : 0;
+}
+
+void NavSnapshot::MoveOccupant(Int2 from, Int2 to) const
+{
+    if (from == to)
+        return;
+    // Visitors on a tile that was only added after they entered it can take the counter below zero for a
+    // while, which reads as an empty tile.
+    if (std::atomic<int32> *counter = Counter(from))
+    {
+        if (counter->fetch_sub(1, std::memory_order_relaxed) == crowd_threshold && crowd_threshold > 0)
+            MarkCrowded(from, false);
+    }
+    int local;
+    const int32 slot = CellSlot(to, local);
+    if (slot != MapNavigation::NO_CHUNK)
+    {
+        NavCrowd::Block &block = *crowd[slot];
+        if (block.counts[local].fetch_add(1, std::memory_order_relaxed) + 1 == crowd_threshold && crowd_threshold > 0)
+            MarkCrowded(to, true);
+#if NAV_TRAFFIC_STATS
+        block.visits[local].fetch_add(1, std::memory_order_relaxed);
+#endif
+    }
+}
+
+void NavSnapshot::MarkCrowded(Int2 pos, bool crowded) const
+{
+    // The neighbor in dir sees pos in the opposite direction, which is the other one of its NavDir pair.
+    for (int dir = 0; dir < 4; ++dir)
+    {
+        int local;
+        const int32 slot = CellSlot(MapNavigation::ForwardFrom(pos, (NavDir)dir), local);
+        if (slot == MapNavigation::NO_CHUNK)
+            continue;
+        const uint8 bit = 1 << (dir ^ 1);
+        if (crowded)
+            crowd[slot]->crowded[local].fetch_or(bit, std::memory_order_relaxed);
+        else
+            crowd[slot]->crowded[local].fetch_and((uint8)~bit, std::memory_order_relaxed);
+    }
+}
+
+int32 NavSnapshot::CellSlot(Int2 pos, int &local) const
+{
+    if (pos.X < 0 || pos.Y < 0 || pos.X >= map_size.X || pos.Y >= map_size.Y)
+        return MapNavigation::NO_CHUNK;
+
+    const Int2 stored(pos.X + map_origin.X, pos.Y + map_origin.Y);
+    local = ((stored.Y & (MapNavigation::CHUNK_SIZE - 1)) << MapNavigation::CHUNK_SHIFT) + (stored.X & (MapNavigation::CHUNK_SIZE - 1));
+    return chunk_slots[(stored.Y >> MapNavigation::CHUNK_SHIFT) * chunk_count.X + (stored.X >> MapNavigation::CHUNK_SHIFT)];
+}
+
+MapNavigation::PathType NavSnapshot::PathTypeAt(Int2 pos) const
+{
+    int local;
+    const int32 slot = CellSlot(pos, local);
+    if (slot == MapNavigation::NO_CHUNK)
+        return MapNavigation::PathType::Empty;
+    return (MapNavigation::PathType)chunks[slot]->path_types[local];
+}
+
+std::atomic<int32>* NavSnapshot::Counter(Int2 pos) const
+{
+    int local;
+    const int32 slot = CellSlot(pos, local);
+    if (slot == MapNavigation::NO_CHUNK)
+        return nullptr;
+    return &crowd[slot]->counts[local];
+}
+
+int NavSnapshot::RandomOutcome(Int2 pos, const MapNavigation::TurnEntry &entry, float rng) const
+{
+    if (crowd_threshold <= 0)
+        return MapNavigation::TurnOutcome(entry, rng);
+
+    // Cells in a chunk keep the crowded bits of their neighbors, only the possible moves count.
+    int local;
+    const int32 slot = CellSlot(pos, local);
+    if (slot != MapNavigation::NO_CHUNK)
+        return MapNavigation::TurnOutcome(entry, crowd[slot]->crowded[local].load(std::memory_order_relaxed) & entry.moves, rng);
+
+    // Only the four tiles a visitor can move to are checked, so avoiding crowds costs the same for every
+    // visitor no matter how many are around.
+    uint8 crowded = 0;
+    int previous = 0;
+    for (int ix = 0; ix < 4; ++ix)
+    {
+        if (entry.thresholds[ix] != previous && Occupancy(MapNavigation::ForwardFrom(pos, (NavDir)ix)) >= crowd_threshold)
+            crowded |= 1 << ix;
+        previous = entry.thresholds[ix];
+    }
+    return MapNavigation::TurnOutcome(entry, crowded, rng);
+}
+
+int NavSnapshot::TurnIndex(Int2 pos, NavDir dir) const
+{
+    int local;
+    const int32 slot = CellSlot(pos, local);
+    if (slot == MapNavigation::NO_CHUNK)
+        return ComputeTurnIndex(pos, dir);
+    return chunks[slot]->turn_contexts[local] + ((int)dir << 8);
+}
+
+int NavSnapshot::ComputeTurnIndex(Int2 pos, NavDir dir) const
+{
+    MapNavigation::PathType sides[4] = {
+        PathTypeAt(Int2(pos.X, pos.Y + 1)),
+        PathTypeAt(Int2(pos.X, pos.Y - 1)),
+        PathTypeAt(Int2(pos.X - 1, pos.Y)),
+        PathTypeAt(Int2(pos.X + 1, pos.Y))
+    };
+
+    uint8 neighbors = 0;
+    for (int ix = 0; ix < 4; ++ix)
+    {
+        if (sides[ix] != MapNavigation::PathType::Empty)
+            neighbors |= 1 << (MapNavigation::NEIGHBOR_PATH_SHIFT + ix);
+        if (sides[ix] == MapNavigation::PathType::Straight || sides[ix] == MapNavigation::PathType::DeadEnd)
+            neighbors |= 1 << (MapNavigation::NEIGHBOR_LANE_SHIFT + ix);
+    }
+
+    return MapNavigation::TurnTable::Index(PathTypeAt(pos), dir, neighbors);
+}
+
+Int2 NavSnapshot::EnterTile(Int2 pos, NavDir dir) const
+{
+    Int2 nextCell = MapNavigation::ForwardFrom(pos, dir);
+    // First time entering:
+    if (!IsPath(nextCell))
+        return pos;
+    return nextCell;
+}
+
+
+NavSnapshotRef::NavSnapshotRef() : snapshot(nullptr)
+{
+}
+
+NavSnapshotRef::NavSnapshotRef(const NavSnapshot *snapshot) : snapshot(snapshot)
+{
+}
+
+NavSnapshotRef::NavSnapshotRef(NavSnapshotRef &&other) noexcept : snapshot(other.snapshot)
+{
+    other.snapshot = nullptr;
+}
+
+NavSnapshotRef::~NavSnapshotRef()
+{
+    Release();
+}
+
+NavSnapshotRef& NavSnapshotRef::operator=(NavSnapshotRef &&other) noexcept
+{
+    if (this != &other)
+    {
+        Release();
+        snapshot = other.snapshot;
+        other.snapshot = nullptr;
+    }
+    return *this;
+}
+
+void NavSnapshotRef::Release()
+{
+    if (snapshot != nullptr)
+        snapshot->readers.fetch_sub(1, std::memory_order_release);
+    snapshot = nullptr;
+}
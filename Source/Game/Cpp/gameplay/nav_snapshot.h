@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include "map_navigation.h"
+
+
+// Read-only copy of the path types of the navigation map, published by MapNavigation at the end of every
+// change. Chunks that didn't change are shared with the previous snapshot, so publishing only copies the
+// chunks of the changed cells. Snapshots can be read from any thread while the map is changed on the main
+// thread. Readers pin a snapshot with MapNavigation::AcquireSnapshot, and replaced snapshots are only freed
+// once no reader holds them.
+class NavSnapshot
+{
+public:
+    // Number of the change that published the snapshot. Increases by one with every change.
+    uint64 Version() const;
+    Int2 MapSize() const;
+    bool IsPath(Int2 pos) const;
+
+    // Picks the next tile the same way as MapNavigation::PickTile, but without leaving dirt on the map.
+    Int2 PickTile(Int2 pos, NavDir dir, RandomizerStream &stream) const;
+    // Picks the next tile for a batch of visitors in parallel, with one random stream for each.
+    void PickTiles(const Span<Int2>& positions, const Span<NavDir>& dirs, Span<RandomizerStream> streams, Span<Int2> results) const;
+
+    // Visitor counters are shared with the map and atomic, so they can be read and updated from any thread.
+    // Counts reported through an older snapshot are kept, apart from chunks that were removed since.
+    int32 Occupancy(Int2 pos) const;
+    void MoveOccupant(Int2 from, Int2 to) const;
+
+private:
+    friend class MapNavigation;
+    friend class NavSnapshotRef;
+
+    struct Chunk
+    {
+        uint8 path_types[MapNavigation::CHUNK_CELLS];
+        uint16 turn_contexts[MapNavigation::CHUNK_CELLS];
+    };
+
+    NavSnapshot();
+
+    // Slot of the chunk of pos and the index of pos in it, or NO_CHUNK.
+    int32 CellSlot(Int2 pos, int &local) const;
+    MapNavigation::PathType PathTypeAt(Int2 pos) const;
+    // Visitor counter of the cell at pos, or null if there's no chunk there.
+    std::atomic<int32>* Counter(Int2 pos) const;
+    // Sets or clears the crowded bit pointing at pos in its four neighbors.
+    void MarkCrowded(Int2 pos, bool crowded) const;
+    // Outcome of a decision that needs a random number, avoiding crowded tiles if there's a crowd threshold.
+    int RandomOutcome(Int2 pos, const MapNavigation::TurnEntry &entry, float rng) const;
+    // Index in MapNavigation::turn_table for the decision at pos when walking in dir. Reads the cached turn
+    // context of the cell, and only looks at the neighbors for cells outside the allocated chunks.
+    int TurnIndex(Int2 pos, NavDir dir) const;
+    int ComputeTurnIndex(Int2 pos, NavDir dir) const;
+    // Tile to move to from outside the map when first entering the park.
+    Int2 EnterTile(Int2 pos, NavDir dir) const;
+
+    uint64 version;
+    // Number of readers holding the snapshot.
+    mutable std::atomic<int32> readers;
+
+    Int2 map_size;
+    Int2 map_origin;
+    Int2 chunk_count;
+    // Slot of each chunk like in MapNavigation, and the path types of the chunk in each slot, or null for
+    // free slots.
+    Array<int32> chunk_slots;
+    Array<std::shared_ptr<const Chunk>> chunks;
+    // Visitor counters of the chunk in each slot, shared with the map.
+    Array<std::shared_ptr<NavCrowd::Block>> crowd;
+    int32 crowd_threshold;
+#if NAV_TRAFFIC_STATS
+    // Traffic counters of the map, which outlives its snapshots.
+    NavTraffic *traffic;
+#endif
+};
+
+
+// Pinned snapshot of the navigation map. The snapshot stays valid until the reference is destroyed.
+class NavSnapshotRef
+{
+public:
+    NavSnapshotRef();
+    explicit NavSnapshotRef(const NavSnapshot *snapshot);
+    NavSnapshotRef(NavSnapshotRef &&other) noexcept;
+    NavSnapshotRef(const NavSnapshotRef &other) = delete;
+    ~NavSnapshotRef();
+
+    NavSnapshotRef& operator=(NavSnapshotRef &&other) noexcept;
+    NavSnapshotRef& operator=(const NavSnapshotRef &other) = delete;
+
+    const NavSnapshot* Get() const { return snapshot; }
+    const NavSnapshot* operator->() const { return snapshot; }
+    operator bool() const { return snapshot != nullptr; }
+
+    // Unpins the snapshot early.
+    void Release();
+
+private:
+    const NavSnapshot *snapshot;
+};
@@ -0,0 +1,168 @@
+#include "nav_traffic.h"
+#include "map_navigation.h"
+#include "Engine/Platform/File.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+
+namespace
+{
+    // Names of MapNavigation::PathType values for the CSV file.
+    const char *PATH_TYPE_NAMES[NavTrafficStats::PATH_TYPES] = {
+        "Empty", "Middle", "InnerCorner", "OuterCorner", "Crossing", "DeadEnd", "Isolated", "Straight", "Turn", "Side"
+    };
+    const char *DIRECTION_NAMES[NavTrafficStats::DIRECTIONS] = { "Up", "Down", "Left", "Right" };
+    const char *OUTCOME_NAMES[NavTrafficStats::OUTCOMES] = { "Up", "Down", "Left", "Right", "Stay" };
+
+    // Binary file layout: the magic and version, the map size, the visits row by row, then the decisions.
+    // Values are little endian.
+    constexpr uint32 TRAFFIC_MAGIC = 0x4652544e; // "NTRF"
+    constexpr uint32 TRAFFIC_VERSION = 1;
+
+    void AppendText(Array<byte> &data, const char *format, ...)
+    {
+        char line[256];
+        va_list args;
+        va_start(args, format);
+        const int length = std::vsnprintf(line, sizeof(line), format, args);
+        va_end(args);
+        if (length > 0)
+            data.Add((const byte*)line, std::min(length, (int)sizeof(line) - 1));
+    }
+
+    template<typename T>
+    void AppendRaw(Array<byte> &data, T value)
+    {
+        byte bytes[sizeof(T)];
+        for (int ix = 0; ix < (int)sizeof(T); ++ix)
+            bytes[ix] = (byte)((uint64)value >> (ix * 8));
+        data.Add(bytes, sizeof(T));
+    }
+}
+
+
+uint32 NavTrafficStats::Visits(Int2 pos) const
+{
+    if (pos.X < 0 || pos.Y < 0 || pos.X >= map_size.X || pos.Y >= map_size.Y)
+        return 0;
+    return visits[pos.Y * map_size.X + pos.X];
+}
+
+bool NavTrafficStats::Save(const StringView& path) const
+{
+    Array<byte> data;
+    const int length = path.Length();
+    const bool csv = length >= 4 && path[length - 4] == '.' && (path[length - 3] | 0x20) == 'c' && (path[length - 2] | 0x20) == 's' && (path[length - 1] | 0x20) == 'v';
+    if (csv)
+    {
+        // Two tables, the visited cells and the decisions, each with its own header.
+        AppendText(data, "x,y,visits\n");
+        for (int y = 0; y < map_size.Y; ++y)
+        {
+            for (int x = 0; x < map_size.X; ++x)
+            {
+                if (const uint32 count = visits[y * map_size.X + x])
+                    AppendText(data, "%d,%d,%u\n", x, y, count);
+            }
+        }
+        AppendText(data, "\npath_type,direction,outcome,decisions\n");
+        for (int type = 0; type < PATH_TYPES; ++type)
+        {
+            for (int dir = 0; dir < DIRECTIONS; ++dir)
+            {
+                for (int outcome = 0; outcome < OUTCOMES; ++outcome)
+                {
+                    if (const uint64 count = decisions[type][dir][outcome])
+                        AppendText(data, "%s,%s,%s,%llu\n", PATH_TYPE_NAMES[type], DIRECTION_NAMES[dir], OUTCOME_NAMES[outcome], (unsigned long long)count);
+                }
+            }
+        }
+    }
+    else
+    {
+        AppendRaw(data, TRAFFIC_MAGIC);
+        AppendRaw(data, TRAFFIC_VERSION);
+        AppendRaw(data, (uint32)map_size.X);
+        AppendRaw(data, (uint32)map_size.Y);
+        for (uint32 count : visits)
+            AppendRaw(data, count);
+        AppendRaw(data, (uint32)PATH_TYPES);
+        AppendRaw(data, (uint32)DIRECTIONS);
+        AppendRaw(data, (uint32)OUTCOMES);
+        for (int type = 0; type < PATH_TYPES; ++type)
+        {
+            for (int dir = 0; dir < DIRECTIONS; ++dir)
+            {
+                for (int outcome = 0; outcome < OUTCOMES; ++outcome)
+                    AppendRaw(data, decisions[type][dir][outcome]);
+            }
+        }
+    }
+    return !File::WriteAllBytes(path, data);
+}
+
+
+NavTraffic::NavTraffic()
+{
+    for (auto &outcomes : decisions)
+    {
+        for (auto &count : outcomes)
+            count.store(0, std::memory_order_relaxed);
+    }
+}
+
+void NavTraffic::Reset([[maybe_unused]] const MapNavigation &nav)
+{
+    static_assert(NavTrafficStats::PATH_TYPES == (int)MapNavigation::PathType::ValueMax, "Traffic decisions must match the path types.");
+    static_assert(NavTrafficStats::OUTCOMES == MapNavigation::TURN_STAY + 1, "Traffic decisions must match the turn outcomes.");
+
+    for (auto &outcomes : decisions)
+    {
+        for (auto &count : outcomes)
+            count.store(0, std::memory_order_relaxed);
+    }
+#if NAV_TRAFFIC_STATS
+    for (int32 slot = 0; slot < nav.ChunkSlotCount(); ++slot)
+    {
+        if (!nav.SlotUsed(slot))
+            continue;
+        NavCrowd::Block &block = *nav.crowd.SlotBlock(slot);
+        for (auto &count : block.visits)
+            count.store(0, std::memory_order_relaxed);
+    }
+#endif
+}
+
+void NavTraffic::GetStats(const MapNavigation &nav, NavTrafficStats &stats) const
+{
+    stats.map_size = nav.map_size;
+    stats.visits.Clear();
+    stats.visits.AddZeroed(nav.map_size.X * nav.map_size.Y);
+    for (int type = 0; type < NavTrafficStats::PATH_TYPES; ++type)
+    {
+        for (int dir = 0; dir < NavTrafficStats::DIRECTIONS; ++dir)
+        {
+            for (int outcome = 0; outcome < NavTrafficStats::OUTCOMES; ++outcome)
+                stats.decisions[type][dir][outcome] = decisions[type * NavTrafficStats::DIRECTIONS + dir][outcome].load(std::memory_order_relaxed);
+        }
+    }
+
+#if NAV_TRAFFIC_STATS
+    // Only allocated chunks have visits, and their cells can be outside the map.
+    for (int32 slot = 0; slot < nav.ChunkSlotCount(); ++slot)
+    {
+        if (!nav.SlotUsed(slot))
+            continue;
+        const NavCrowd::Block &block = *nav.crowd.SlotBlock(slot);
+        for (int local = 0; local < MapNavigation::CHUNK_CELLS; ++local)
+        {
+            const Int2 pos = nav.CellPos(slot * MapNavigation::CHUNK_CELLS + local);
+            if (nav.ValidPos(pos))
+                stats.visits[pos.Y * nav.map_size.X + pos.X] = block.visits[local].load(std::memory_order_relaxed);
+        }
+    }
+#endif
+}
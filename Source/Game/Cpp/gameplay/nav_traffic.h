@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include "Engine/Core/Math/Vector2.h"
+#include "Engine/Core/Collections/Array.h"
+#include "Engine/Core/Types/StringView.h"
+
+// Build with NAV_TRAFFIC_STATS defined to 1 to count the traffic on the navigation map. Without it, the
+// counters and every place that updates them are compiled out.
+#ifndef NAV_TRAFFIC_STATS
+#define NAV_TRAFFIC_STATS 0
+#endif
+
+class MapNavigation;
+
+
+// Copy of the traffic counters of the navigation map, taken by MapNavigation::GetTrafficStats.
+struct NavTrafficStats
+{
+    // Number of path types, walking directions and decision outcomes in decisions. Outcomes 0-3 are
+    // moving in the NavDir of the same value, and 4 is staying on the cell.
+    static constexpr int PATH_TYPES = 10;
+    static constexpr int DIRECTIONS = 4;
+    static constexpr int OUTCOMES = 5;
+
+    Int2 map_size;
+    // Number of times visitors entered each cell of the map, row by row.
+    Array<uint32> visits;
+    // Number of PickTile decisions for each path type of the tile, walking direction and outcome.
+    uint64 decisions[PATH_TYPES][DIRECTIONS][OUTCOMES];
+
+    uint32 Visits(Int2 pos) const;
+
+    // Writes the counters to path, as text if it ends with .csv and in a binary format otherwise. Returns
+    // false if the file couldn't be written.
+    bool Save(const StringView& path) const;
+};
+
+
+// Traffic counters of the navigation map: the visits of each cell and a histogram of the PickTile
+// decisions. The counters are updated with relaxed atomics from any thread through the snapshots, so they
+// don't slow down the simulation beyond the atomic adds. Visits are kept in the crowd blocks of the chunks,
+// and are dropped with the chunk when it loses all its paths.
+class NavTraffic
+{
+public:
+    NavTraffic();
+
+    // Counts a decision for a turn_table index and its outcome.
+    void AddDecision(int turnIndex, int outcome)
+    {
+        decisions[turnIndex >> 8][outcome].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Clears the decisions and the visits of every chunk.
+    void Reset(const MapNavigation &nav);
+    void GetStats(const MapNavigation &nav, NavTrafficStats &stats) const;
+
+private:
+    // Indexed by the path type and walking direction part of the turn_table index.
+    std::atomic<uint64> decisions[NavTrafficStats::PATH_TYPES * NavTrafficStats::DIRECTIONS][NavTrafficStats::OUTCOMES];
+};
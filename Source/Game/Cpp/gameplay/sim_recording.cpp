@@ -0,0 +1,440 @@
+﻿#include "sim_recording.h"
+#include "map_navigation.h"
+#include "visitor_system.h"
+#include "../script_globals.h"
+#include "../util/randomizer.h"
+#include "Engine/Core/Types/Variant.h"
+#include "Engine/Debug/DebugLog.h"
+#include "Engine/Level/Actors/AnimatedModel.h"
+#include "Engine/Platform/File.h"
+
+#include <cstring>
+
+
+namespace
+{
+    bool recording = false;
+    Array<byte> recorded;
+    // Finished ticks, and the tick the last event was stamped with.
+    uint32 ticks = 0;
+    uint32 stamped_tick = 0;
+    uint64 state_hash = 0;
+
+    // Last recorded values, to only record changes. The settings are the tile dimension and the visitor
+    // system fields the walking depends on.
+    bool has_interval = false;
+    float last_interval = 0.0f;
+    int camera_state = -1;
+    Float3 last_camera;
+    bool has_settings = false;
+    float last_settings[5];
+
+    void WriteRaw(uint64 value, int bytes)
+    {
+        for (int ix = 0; ix < bytes; ++ix)
+            recorded.Add((byte)(value >> (ix * 8)));
+    }
+}
+
+
+void SimRecording::Start()
+{
+    recorded.Clear();
+    ticks = 0;
+    stamped_tick = 0;
+    state_hash = 0;
+    has_interval = false;
+    camera_state = -1;
+    has_settings = false;
+    recording = true;
+
+    WriteRaw(MAGIC, 4);
+    WriteUInt(VERSION);
+    WriteRaw(Randomizer::GetSeed(), 8);
+}
+
+bool SimRecording::Stop(const StringView& path)
+{
+    if (!recording)
+        return false;
+    recording = false;
+
+    // The state hash and the tick count close the log, so they can be read without going through the events.
+    WriteEvent(Event::End);
+    WriteRaw(state_hash, 8);
+    WriteRaw(ticks, 4);
+    const bool failed = File::WriteAllBytes(path, recorded);
+    recorded.Clear();
+    return !failed;
+}
+
+bool SimRecording::IsRecording()
+{
+    return recording;
+}
+
+void SimRecording::RecordMapData(Int2 size)
+{
+    if (!recording)
+        return;
+    WriteEvent(Event::MapData);
+    WriteInt2(size);
+}
+
+void SimRecording::RecordResize(Int2 newSize, Int2 offset)
+{
+    if (!recording)
+        return;
+    WriteEvent(Event::Resize);
+    WriteInt2(newSize);
+    WriteInt2(offset);
+}
+
+void SimRecording::RecordChange(const MapNavigation &nav)
+{
+    if (!recording)
+        return;
+    // Only valid positions are added to a change, so they are never negative, and the lowest bit of Y
+    // can hold whether the edit adds a path.
+    WriteEvent(Event::Change);
+    WriteUInt(nav.edits.Count());
+    for (const MapNavigation::PathEdit &edit : nav.edits)
+    {
+        WriteUInt(edit.pos.X);
+        WriteUInt(((uint64)edit.pos.Y << 1) | (edit.add ? 1 : 0));
+    }
+}
+
+void SimRecording::RecordUndo()
+{
+    if (recording)
+        WriteEvent(Event::Undo);
+}
+
+void SimRecording::RecordRedo()
+{
+    if (recording)
+        WriteEvent(Event::Redo);
+}
+
+void SimRecording::RecordCrowdThreshold(int visitors)
+{
+    if (!recording)
+        return;
+    WriteEvent(Event::CrowdThreshold);
+    WriteInt(visitors);
+}
+
+void SimRecording::RecordSpawn(const VisitorSystem &visitors, float walkingSpeed, Int2 spawnTile, Int2 entryTile)
+{
+    if (!recording)
+        return;
+    RecordSettings(visitors);
+    WriteEvent(Event::Spawn);
+    WriteFloat(walkingSpeed);
+    WriteInt2(spawnTile);
+    WriteInt2(entryTile);
+}
+
+void SimRecording::RecordRemove(int id)
+{
+    if (!recording)
+        return;
+    WriteEvent(Event::Remove);
+    WriteUInt(id);
+}
+
+void SimRecording::RecordTickStart(const VisitorSystem &visitors, float delta, const Float3 *camera)
+{
+    if (!recording)
+        return;
+    RecordSettings(visitors);
+    if (!has_interval || last_interval != delta)
+    {
+        has_interval = true;
+        last_interval = delta;
+        WriteEvent(Event::Interval);
+        WriteFloat(delta);
+    }
+
+    if (camera == nullptr)
+    {
+        if (camera_state != 0)
+            WriteEvent(Event::NoCamera);
+        camera_state = 0;
+    }
+    else if (camera_state != 1 || std::memcmp(&last_camera, camera, sizeof(Float3)) != 0)
+    {
+        camera_state = 1;
+        last_camera = *camera;
+        WriteEvent(Event::Camera);
+        WriteFloat(camera->X);
+        WriteFloat(camera->Y);
+        WriteFloat(camera->Z);
+    }
+}
+
+void SimRecording::RecordBarfEnd(int id)
+{
+    if (!recording)
+        return;
+    WriteEvent(Event::BarfEnd);
+    WriteUInt(id);
+}
+
+void SimRecording::RecordTickEnd(const VisitorSystem &visitors)
+{
+    if (!recording)
+        return;
+    ++ticks;
+    state_hash = visitors.StateHash();
+}
+
+void SimRecording::RecordSettings(const VisitorSystem &visitors)
+{
+    const float settings[5] = { ScriptGlobals::tile_dimension, visitors.MaximumTurnRadius, visitors.LaneSideDistance, visitors.MidDistance, visitors.FarDistance };
+    if (has_settings && std::memcmp(last_settings, settings, sizeof(settings)) == 0)
+        return;
+    has_settings = true;
+    std::memcpy(last_settings, settings, sizeof(settings));
+    WriteEvent(Event::Settings);
+    for (float value : settings)
+        WriteFloat(value);
+}
+
+void SimRecording::WriteEvent(Event event)
+{
+    WriteUInt(ticks - stamped_tick);
+    stamped_tick = ticks;
+    recorded.Add((byte)event);
+}
+
+void SimRecording::WriteUInt(uint64 value)
+{
+    while (value >= 0x80)
+    {
+        recorded.Add((byte)(value | 0x80));
+        value >>= 7;
+    }
+    recorded.Add((byte)value);
+}
+
+void SimRecording::WriteInt(int64 value)
+{
+    WriteUInt(((uint64)value << 1) ^ (uint64)(value >> 63));
+}
+
+void SimRecording::WriteFloat(float value)
+{
+    uint32 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    WriteRaw(bits, 4);
+}
+
+void SimRecording::WriteInt2(Int2 value)
+{
+    WriteInt(value.X);
+    WriteInt(value.Y);
+}
+
+
+SimReplay::SimReplay() : position(0), tick_count(0), current_tick(0), recorded_hash(0), replayed_hash(0), event_tick(0), interval(0.0f), has_camera(false)
+{
+}
+
+bool SimReplay::Load(const StringView& path)
+{
+    data.Clear();
+    position = 0;
+    current_tick = 0;
+    replayed_hash = 0;
+    has_camera = false;
+    // Header, end event, state hash and tick count.
+    if (File::ReadAllBytes(path, data) || data.Count() < 14 + SimRecording::TRAILER_SIZE)
+    {
+        DebugLog::LogError(TEXT("Couldn't read the simulation recording."));
+        return false;
+    }
+
+    uint32 magic = 0;
+    for (int ix = 0; ix < 4; ++ix)
+        magic |= (uint32)data[position++] << (ix * 8);
+    if (magic != SimRecording::MAGIC || ReadUInt() != SimRecording::VERSION)
+    {
+        DebugLog::LogError(TEXT("The file is not a simulation recording, or it was made by a different version."));
+        return false;
+    }
+    uint64 seed = 0;
+    for (int ix = 0; ix < 8; ++ix)
+        seed |= (uint64)data[position++] << (ix * 8);
+    recorded_hash = 0;
+    for (int ix = 0; ix < 8; ++ix)
+        recorded_hash |= (uint64)data[data.Count() - SimRecording::TRAILER_SIZE + ix] << (ix * 8);
+    tick_count = 0;
+    for (int ix = 0; ix < 4; ++ix)
+        tick_count |= (uint32)data[data.Count() - 4 + ix] << (ix * 8);
+
+    Randomizer::SetSeed(seed);
+    event_tick = (uint32)ReadUInt();
+    return true;
+}
+
+uint32 SimReplay::TickCount() const
+{
+    return tick_count;
+}
+
+uint32 SimReplay::CurrentTick() const
+{
+    return current_tick;
+}
+
+uint64 SimReplay::RecordedStateHash() const
+{
+    return recorded_hash;
+}
+
+uint64 SimReplay::ReplayedStateHash() const
+{
+    return replayed_hash;
+}
+
+bool SimReplay::Step(MapNavigation &nav, VisitorSystem &visitors, const Function<AnimatedModel*()>& createActor)
+{
+    ScriptGlobals::map_navigation = &nav;
+    if (!ApplyEvents(nav, visitors, createActor) || current_tick >= tick_count)
+        return false;
+    visitors.Tick(interval, &nav, has_camera ? &camera : nullptr);
+    if (++current_tick == tick_count)
+        replayed_hash = visitors.StateHash();
+    return true;
+}
+
+bool SimReplay::ApplyEvents(MapNavigation &nav, VisitorSystem &visitors, const Function<AnimatedModel*()>& createActor)
+{
+    using Event = SimRecording::Event;
+    const int32 end = data.Count() - SimRecording::TRAILER_SIZE;
+    while (event_tick == current_tick)
+    {
+        if (position >= end)
+            return false;
+        switch ((Event)data[position++])
+        {
+        case Event::MapData:
+            nav.SetMapData(ReadInt2());
+            break;
+        case Event::Resize:
+        {
+            const Int2 size = ReadInt2();
+            nav.ResizeMap(size, ReadInt2());
+            break;
+        }
+        case Event::Change:
+        {
+            nav.BeginChange();
+            for (uint64 ix = 0, siz = ReadUInt(); ix < siz && position < end; ++ix)
+            {
+                const int32 x = (int32)ReadUInt();
+                const uint64 yAdd = ReadUInt();
+                const Int2 pos(x, (int32)(yAdd >> 1));
+                if ((yAdd & 1) != 0)
+                    nav.AddPath(pos);
+                else
+                    nav.RemovePath(pos);
+            }
+            nav.EndChange();
+            break;
+        }
+        case Event::Undo:
+            nav.Undo();
+            break;
+        case Event::Redo:
+            nav.Redo();
+            break;
+        case Event::CrowdThreshold:
+            nav.SetCrowdThreshold((int)ReadInt());
+            break;
+        case Event::Settings:
+            ScriptGlobals::tile_dimension = ReadFloat();
+            visitors.MaximumTurnRadius = ReadFloat();
+            visitors.LaneSideDistance = ReadFloat();
+            visitors.MidDistance = ReadFloat();
+            visitors.FarDistance = ReadFloat();
+            break;
+        case Event::Spawn:
+        {
+            const float speed = ReadFloat();
+            const Int2 spawnTile = ReadInt2();
+            visitors.AddVisitor(createActor(), speed, spawnTile, ReadInt2());
+            break;
+        }
+        case Event::Remove:
+            visitors.RemoveVisitor((int)ReadUInt());
+            break;
+        case Event::Interval:
+            interval = ReadFloat();
+            break;
+        case Event::Camera:
+            has_camera = true;
+            camera.X = ReadFloat();
+            camera.Y = ReadFloat();
+            camera.Z = ReadFloat();
+            break;
+        case Event::NoCamera:
+            has_camera = false;
+            break;
+        case Event::BarfEnd:
+        {
+            // The animation is what ends barfing in the game, which the replay does instead.
+            const int id = (int)ReadUInt();
+            if (id >= 0 && id < visitors.visitor_indices.Count() && visitors.visitor_indices[id] != -1)
+                visitors.actors[visitors.visitor_indices[id]]->SetParameterValue(TEXT("Barfing"), Variant(false));
+            break;
+        }
+        case Event::End:
+            return false;
+        default:
+            DebugLog::LogError(TEXT("Unknown event in the simulation recording."));
+            position = end;
+            return false;
+        }
+        event_tick += (uint32)ReadUInt();
+    }
+    return true;
+}
+
+uint64 SimReplay::ReadUInt()
+{
+    uint64 value = 0;
+    const int32 end = data.Count() - SimRecording::TRAILER_SIZE;
+    for (int shift = 0; position < end && shift < 64; shift += 7)
+    {
+        const byte next = data[position++];
+        value |= (uint64)(next & 0x7f) << shift;
+        if ((next & 0x80) == 0)
+            break;
+    }
+    return value;
+}
+
+int64 SimReplay::ReadInt()
+{
+    const uint64 value = ReadUInt();
+    return (int64)(value >> 1) ^ -(int64)(value & 1);
+}
+
+float SimReplay::ReadFloat()
+{
+    uint32 bits = 0;
+    for (int ix = 0; ix < 4 && position < data.Count() - SimRecording::TRAILER_SIZE; ++ix)
+        bits |= (uint32)data[position++] << (ix * 8);
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+Int2 SimReplay::ReadInt2()
+{
+    const int32 x = (int32)ReadInt();
+    return Int2(x, (int32)ReadInt());
+}
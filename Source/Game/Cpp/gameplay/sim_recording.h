@@ -0,0 +1,127 @@
+﻿#pragma once
+
+#include "Engine/Scripting/Script.h"
+#include "Engine/Core/Math/Vector2.h"
+#include "Engine/Core/Math/Vector3.h"
+#include "Engine/Core/Types/StringView.h"
+#include "Engine/Threading/JobSystem.h"
+
+class MapNavigation;
+class VisitorSystem;
+class AnimatedModel;
+
+
+// Records everything the visitor simulation depends on into a compact binary log: the random seed, map
+// changes, visitor spawns and removals, the tick intervals, the camera position for the level of detail,
+// and when the barf animations ended. Start it before the map and the visitors are created, so the log
+// covers the whole simulation. Replaying the log with SimReplay gives the same visitor decisions bit by bit.
+// The log ends with the visitor state hash after the last tick, so replays can check that they matched.
+API_CLASS(Static) class GAME_API SimRecording
+{
+DECLARE_SCRIPTING_TYPE_MINIMAL(SimRecording);
+
+    API_FUNCTION() static void Start();
+    // Stops recording and writes the log to path. Returns false if nothing was recorded or the file
+    // couldn't be written.
+    API_FUNCTION() static bool Stop(const StringView& path);
+    API_FUNCTION() static bool IsRecording();
+
+    // Called by the simulation. They do nothing when not recording. Events are stamped with the number of
+    // finished ticks, and replayed before the next tick.
+    static void RecordMapData(Int2 size);
+    static void RecordResize(Int2 newSize, Int2 offset);
+    // Records the edits of the change that is ending.
+    static void RecordChange(const MapNavigation &nav);
+    static void RecordUndo();
+    static void RecordRedo();
+    static void RecordCrowdThreshold(int visitors);
+    static void RecordSpawn(const VisitorSystem &visitors, float walkingSpeed, Int2 spawnTile, Int2 entryTile);
+    static void RecordRemove(int id);
+    // Called at the start of a tick with its interval and the camera used for the level of detail, which
+    // is null if there is none.
+    static void RecordTickStart(const VisitorSystem &visitors, float delta, const Float3 *camera);
+    // A barf animation ended during the running tick.
+    static void RecordBarfEnd(int id);
+    // Keeps the state hash of the visitors for the end of the log.
+    static void RecordTickEnd(const VisitorSystem &visitors);
+
+private:
+    friend class SimReplay;
+
+    enum class Event : uint8
+    {
+        MapData,
+        Resize,
+        Change,
+        Undo,
+        Redo,
+        CrowdThreshold,
+        Settings,
+        Spawn,
+        Remove,
+        Interval,
+        Camera,
+        NoCamera,
+        BarfEnd,
+        End
+    };
+
+    static constexpr uint32 MAGIC = 0x43455253; // SREC
+    static constexpr uint32 VERSION = 2;
+    // The log ends with the visitor state hash and the tick count.
+    static constexpr int32 TRAILER_SIZE = 12;
+
+    // Records the settings of the visitor system if they changed.
+    static void RecordSettings(const VisitorSystem &visitors);
+    static void WriteEvent(Event event);
+    static void WriteUInt(uint64 value);
+    // Signed values are zigzag encoded, so small negative numbers stay short.
+    static void WriteInt(int64 value);
+    static void WriteFloat(float value);
+    static void WriteInt2(Int2 value);
+};
+
+
+// Plays back a log written by SimRecording on a navigation map and visitor system that were just created.
+// Nothing is rendered, so it runs as fast as the simulation can.
+class GAME_API SimReplay
+{
+public:
+    SimReplay();
+
+    // Reads a log, and sets the seed of the Randomizer to the recorded one. Returns false if the file
+    // can't be read or isn't a recording.
+    bool Load(const StringView& path);
+    // Number of ticks in the recording.
+    uint32 TickCount() const;
+    uint32 CurrentTick() const;
+    // Visitor state hash after the last tick of the recording, and after the same tick of the replay. The
+    // replayed hash is only set once the replay ran all the ticks.
+    uint64 RecordedStateHash() const;
+    uint64 ReplayedStateHash() const;
+
+    // Applies the events before the next tick and runs it. createActor gives the actor for each spawned
+    // visitor. Returns false when the recording is over.
+    bool Step(MapNavigation &nav, VisitorSystem &visitors, const Function<AnimatedModel*()>& createActor);
+
+private:
+    // Applies the events stamped with the current tick. Returns false at the end of the log.
+    bool ApplyEvents(MapNavigation &nav, VisitorSystem &visitors, const Function<AnimatedModel*()>& createActor);
+
+    uint64 ReadUInt();
+    int64 ReadInt();
+    float ReadFloat();
+    Int2 ReadInt2();
+
+    Array<byte> data;
+    int32 position;
+    uint32 tick_count;
+    uint32 current_tick;
+    uint64 recorded_hash;
+    uint64 replayed_hash;
+    // Tick the next event is stamped with.
+    uint32 event_tick;
+    float interval;
+    bool has_camera;
+    Float3 camera;
+};
@@ -0,0 +1,607 @@
+﻿#include "visitor_system.h"
+#include "sim_recording.h"
+#include "../script_globals.h"
+#include "Engine/Level/Actors/AnimatedModel.h"
+#include "Engine/Level/Actors/Camera.h"
+#include "Engine/Core/Math/Transform.h"
+#include "Engine/Debug/DebugLog.h"
+#include "Engine/Engine/Time.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+// Leftover time below this is not walked anymore in an update.
+static constexpr float MIN_STEP_TIME = 0.1e-4f;
+static constexpr float PI_OVER_TWO = 1.57079632679f;
+
+// Orientation of an actor facing against vec on the X and Z axes, the same as Quaternion::FromDirection of the
+// negated vector. With vec a unit vector, the half angle formulas give the rotation around the Y axis without
+// trigonometry.
+static Quaternion FacingRotation(Float2 vec)
+{
+    const float cosYaw = -vec.Y;
+    const float halfSin = std::sqrt(std::max(0.0f, (1.0f - cosYaw) * 0.5f));
+    const float halfCos = std::sqrt(std::max(0.0f, (1.0f + cosYaw) * 0.5f));
+    return Quaternion(0.0f, vec.X > 0.0f ? -halfSin : halfSin, 0.0f, halfCos);
+}
+
+
+VisitorSystem::VisitorSystem(const SpawnParams& params)
+    : Script(params), MaximumTurnRadius(50.0f), LaneSideDistance(0.25f), TickRate(20.0f), MidDistance(3000.0f), FarDistance(8000.0f),
+      tile_dim(200.0f), tick_time(0.0f), tick_count(0), next_stream_id(0)
+{
+    // Enable ticking OnUpdate function
+    _tickUpdate = true;
+}
+
+void VisitorSystem::OnUpdate()
+{
+    MapNavigation *nav = static_cast<MapNavigation*>(ScriptGlobals::map_navigation);
+    if (nav == nullptr)
+        return;
+
+    Camera *mainCamera = Camera::GetMainCamera();
+    Float3 cameraPosition;
+    if (mainCamera != nullptr)
+    {
+        const Vector3 position = mainCamera->GetPosition();
+        cameraPosition = Float3((float)position.X, (float)position.Y, (float)position.Z);
+    }
+    const Float3 *camera = mainCamera != nullptr ? &cameraPosition : nullptr;
+
+    const float delta = Time::GetDeltaTime();
+    if (TickRate <= 0.0f)
+    {
+        Tick(delta, nav, camera);
+        UpdateActors(1.0f);
+        return;
+    }
+
+    const float interval = 1.0f / TickRate;
+    tick_time += delta;
+    int ticks = 0;
+    while (tick_time >= interval && ticks < MAX_TICKS_PER_UPDATE)
+    {
+        tick_time -= interval;
+        Tick(interval, nav, camera);
+        ++ticks;
+    }
+    if (ticks == MAX_TICKS_PER_UPDATE)
+        tick_time = std::min(tick_time, interval);
+    UpdateActors(tick_time / interval);
+}
+
+void VisitorSystem::Tick(float delta, MapNavigation *nav, const Float3 *camera)
+{
+    SimRecording::RecordTickStart(*this, delta, camera);
+    const float midSquared = MidDistance * MidDistance;
+    const float farSquared = FarDistance * FarDistance;
+
+    ++tick_count;
+    const int count = actors.Count();
+    for (int ix = 0; ix < count; ++ix)
+    {
+        if (camera != nullptr)
+        {
+            const float x = positions[ix].X - camera->X;
+            const float y = camera->Y;
+            const float z = positions[ix].Y - camera->Z;
+            const float distance = x * x + y * y + z * z;
+            target_tiers[ix] = distance >= farSquared ? LodTier::Far : distance >= midSquared ? LodTier::Mid : LodTier::Near;
+        }
+
+        // The Barfing parameter is turned off by the animation when it finished playing.
+        barf_timers[ix] -= delta;
+        if (barf_timers[ix] <= 0.0f && states[ix] != VisitorState::Barfing)
+        {
+            states[ix] = VisitorState::Barfing;
+            actors[ix]->SetParameterValue(TEXT("Barfing"), Variant(true));
+        }
+        if (states[ix] == VisitorState::Barfing && !(bool)actors[ix]->GetParameterValue(TEXT("Barfing")))
+        {
+            SimRecording::RecordBarfEnd(visitor_ids[ix]);
+            states[ix] = VisitorState::Walking;
+            GenerateBarfTime(ix);
+        }
+
+        const bool barfing = states[ix] == VisitorState::Barfing;
+
+        // Far visitors take turns being ticked, walking all the time since their last tick at once.
+        float walkTime = delta;
+        if (lod_tiers[ix] == LodTier::Far)
+        {
+            if (!barfing)
+                pending_times[ix] += delta;
+            if ((tick_count + (uint32)ix) % FAR_TICK_INTERVAL != 0)
+                continue;
+            walkTime = pending_times[ix];
+            pending_times[ix] = 0.0f;
+            hopped[ix] = true;
+        }
+
+        previous_positions[ix] = positions[ix];
+        previous_vecs[ix] = current_vecs[ix];
+        if (!barfing)
+            Walk(ix, walkTime, nav);
+    }
+    SimRecording::RecordTickEnd(*this);
+}
+
+void VisitorSystem::UpdateActors(float alpha)
+{
+    for (int ix = 0, count = actors.Count(); ix < count; ++ix)
+    {
+        AnimatedModel *actor = actors[ix];
+        if (walking_dirty[ix])
+        {
+            actor->SetParameterValue(TEXT("Walking"), Variant(walking[ix]));
+            walking_dirty[ix] = false;
+        }
+        if (lod_tiers[ix] == LodTier::Far)
+        {
+            // Far visitors hop to their position when they are ticked.
+            if (!hopped[ix])
+                continue;
+            hopped[ix] = false;
+            settled[ix] = false;
+            Transform transform = actor->GetTransform();
+            transform.Translation.X = positions[ix].X;
+            transform.Translation.Z = positions[ix].Y;
+            transform.Orientation = FacingRotation(current_vecs[ix]);
+            actor->SetTransform(transform);
+            continue;
+        }
+
+        // A visitor that stopped still needs one write at its final position, as the actor was shown
+        // somewhere between the last two ticks.
+        const bool moving = positions[ix].X != previous_positions[ix].X || positions[ix].Y != previous_positions[ix].Y ||
+                current_vecs[ix].X != previous_vecs[ix].X || current_vecs[ix].Y != previous_vecs[ix].Y;
+        if (!moving && settled[ix])
+            continue;
+        settled[ix] = !moving;
+
+        const Float2 position = previous_positions[ix] + (positions[ix] - previous_positions[ix]) * alpha;
+        // The walking vector turns by a few degrees in a tick at most, so the normalized linear blend is
+        // close enough to rotating it.
+        Float2 vec = previous_vecs[ix] + (current_vecs[ix] - previous_vecs[ix]) * alpha;
+        const float length = std::sqrt(vec.X * vec.X + vec.Y * vec.Y);
+        vec = length > 0.1e-3f ? vec * (1.0f / length) : current_vecs[ix];
+
+        Transform transform = actor->GetTransform();
+        transform.Translation.X = position.X;
+        transform.Translation.Z = position.Y;
+        transform.Orientation = FacingRotation(vec);
+        actor->SetTransform(transform);
+    }
+}
+
+int VisitorSystem::AddVisitor(AnimatedModel *actor, float walkingSpeed, Int2 spawnTile, Int2 entryTile)
+{
+    if (actor == nullptr || walkingSpeed <= 0.0f)
+    {
+        DebugLog::LogError(TEXT("Visitors need an actor and a positive walking speed."));
+        return -1;
+    }
+    SimRecording::RecordSpawn(*this, walkingSpeed, spawnTile, entryTile);
+    tile_dim = ScriptGlobals::tile_dimension;
+
+    int32 id;
+    if (free_ids.Count() != 0)
+    {
+        id = free_ids.Last();
+        free_ids.RemoveLast();
+    }
+    else
+    {
+        id = visitor_indices.Count();
+        visitor_indices.AddOne();
+    }
+    const int ix = actors.Count();
+    visitor_indices[id] = ix;
+    visitor_ids.Add(id);
+
+    const NavDir destDir = WalkDirection(spawnTile, entryTile, NavDir::Up);
+    actors.Add(actor);
+    states.Add(VisitorState::ParkEntry);
+    walking_speeds.Add(walkingSpeed);
+    positions.Add(ArrivePosition(NavDir::Up, spawnTile));
+    previous_positions.Add(positions[ix]);
+    previous_vecs.Add(WalkVector(NavDir::Up));
+    current_tiles.Add(spawnTile);
+    current_dirs.Add(NavDir::Up);
+    current_vecs.Add(WalkVector(NavDir::Up));
+    dest_tiles.Add(entryTile);
+    dest_positions.Add(ArrivePosition(destDir, entryTile));
+    dest_dirs.Add(destDir);
+    move_states.Add(MoveState::GoForward);
+    turn_sides.Add(TurnSide::CCW);
+    turn_distances.Add(0.0f);
+    turn_radii.Add(0.0f);
+    turn_arcs.Add(0.0f);
+    turn_centers.Add(Float2(0.0f, 0.0f));
+    turn_start_vecs.Add(WalkVector(NavDir::Up));
+    walk_distances.Add(0.0f);
+    barf_timers.Add(0.0f);
+    streams.Add(Randomizer::Stream(next_stream_id++));
+    barf_streams.Add(Randomizer::Stream(next_stream_id++));
+    lod_tiers.Add(LodTier::Near);
+    target_tiers.Add(LodTier::Near);
+    pending_times.Add(0.0f);
+    hopped.Add(false);
+    walking.Add(true);
+    walking_dirty.Add(true);
+    settled.Add(false);
+
+    GenerateBarfTime(ix);
+    if (spawnTile.X == entryTile.X)
+        CalculateForward(ix);
+    else
+        CalculateTurn(ix);
+    return id;
+}
+
+void VisitorSystem::RemoveVisitor(int id)
+{
+    if (id < 0 || id >= visitor_indices.Count() || visitor_indices[id] == -1)
+        return;
+    SimRecording::RecordRemove(id);
+
+    const int ix = visitor_indices[id];
+    MapNavigation *nav = static_cast<MapNavigation*>(ScriptGlobals::map_navigation);
+    if (nav != nullptr)
+        nav->RemoveOccupant(current_tiles[ix]);
+
+    RemoveAt(ix);
+    visitor_indices[id] = -1;
+    free_ids.Add(id);
+}
+
+int VisitorSystem::VisitorCount() const
+{
+    return actors.Count();
+}
+
+Int2 VisitorSystem::GetVisitorTile(int id) const
+{
+    if (id < 0 || id >= visitor_indices.Count() || visitor_indices[id] == -1)
+        return Int2(-1, -1);
+    return current_tiles[visitor_indices[id]];
+}
+
+uint64 VisitorSystem::StateHash() const
+{
+    // 64 bit FNV-1a over the bytes of the values, so floats are compared bit by bit.
+    uint64 hash = 14695981039346656037ull;
+    auto add = [&hash](const auto &value) {
+        const byte *bytes = (const byte*)&value;
+        for (int ix = 0; ix < (int)sizeof(value); ++ix)
+        {
+            hash ^= bytes[ix];
+            hash *= 1099511628211ull;
+        }
+    };
+    for (int ix = 0, count = actors.Count(); ix < count; ++ix)
+    {
+        add(visitor_ids[ix]);
+        add(positions[ix].X);
+        add(positions[ix].Y);
+        add(current_tiles[ix].X);
+        add(current_tiles[ix].Y);
+        add(dest_tiles[ix].X);
+        add(dest_tiles[ix].Y);
+        add(current_dirs[ix]);
+        add(dest_dirs[ix]);
+        add(states[ix]);
+        add(move_states[ix]);
+        add(barf_timers[ix]);
+    }
+    return hash;
+}
+
+void VisitorSystem::Walk(int ix, float delta, MapNavigation *nav)
+{
+    const float speed = walking_speeds[ix];
+    while (delta > MIN_STEP_TIME)
+    {
+        if (move_states[ix] == MoveState::ApproachFullTurn)
+        {
+            const float dist = std::min(speed * delta, walk_distances[ix]);
+            delta = std::max(0.0f, delta - dist / speed);
+            walk_distances[ix] -= dist;
+            positions[ix] = positions[ix] + current_vecs[ix] * dist;
+
+            if (delta > MIN_STEP_TIME)
+                move_states[ix] = MoveState::TurningFullTurn;
+        }
+
+        if (move_states[ix] == MoveState::TurningFullTurn)
+        {
+            WalkTurn(ix, delta);
+            if (delta > MIN_STEP_TIME)
+            {
+                // The full turn ends facing to the left of the original direction.
+                static constexpr NavDir leftOf[4] = { NavDir::Left, NavDir::Right, NavDir::Down, NavDir::Up };
+                current_dirs[ix] = leftOf[(int)current_dirs[ix]];
+                current_vecs[ix] = WalkVector(current_dirs[ix]);
+                CalculateTurn(ix);
+            }
+        }
+
+        if (move_states[ix] == MoveState::ApproachTurn)
+        {
+            const float dist = std::min(speed * delta, turn_distances[ix]);
+            delta = std::max(0.0f, delta - dist / speed);
+            turn_distances[ix] -= dist;
+            positions[ix] = positions[ix] + current_vecs[ix] * dist;
+
+            if (delta > MIN_STEP_TIME)
+                move_states[ix] = MoveState::Turning;
+        }
+
+        if (move_states[ix] == MoveState::Turning)
+        {
+            WalkTurn(ix, delta);
+            if (delta > MIN_STEP_TIME)
+            {
+                move_states[ix] = MoveState::GoForward;
+                current_dirs[ix] = dest_dirs[ix];
+                current_vecs[ix] = WalkVector(dest_dirs[ix]);
+                walk_distances[ix] = dest_dirs[ix] == NavDir::Left || dest_dirs[ix] == NavDir::Right
+                        ? std::abs(dest_positions[ix].X - positions[ix].X) : std::abs(dest_positions[ix].Y - positions[ix].Y);
+            }
+        }
+
+        if (move_states[ix] == MoveState::GoForward)
+        {
+            const float dist = std::min(speed * delta, walk_distances[ix]);
+            walk_distances[ix] -= dist;
+            delta = std::max(0.0f, delta - dist / speed);
+            positions[ix] = positions[ix] + current_vecs[ix] * dist;
+
+            if (delta > MIN_STEP_TIME && !CalculateNext(ix, nav))
+                delta = 0.0f;
+        }
+    }
+}
+
+void VisitorSystem::WalkTurn(int ix, float &delta)
+{
+    // How much distance over the turning arc is remaining
+    const float arcSize = turn_radii[ix] * PI_OVER_TWO * turn_arcs[ix];
+    if (arcSize <= 0.1e-6f || turn_arcs[ix] < 0.1e-6f)
+        return;
+
+    const float speed = walking_speeds[ix];
+    const float arcDist = std::min(speed * delta, arcSize);
+    delta = std::max(0.0f, delta - arcDist / speed);
+    turn_arcs[ix] -= arcDist / arcSize * turn_arcs[ix];
+
+    // The walking vector is the one at the start of the turn rotated by the part of the turn done so far,
+    // and the position is on the circle on the inner side of it. Both come from the same sine and cosine.
+    const TurnSide side = turn_sides[ix];
+    const float angle = PI_OVER_TWO * (1.0f - turn_arcs[ix]) * (side == TurnSide::CCW ? 1.0f : -1.0f);
+    const float sin = std::sin(angle);
+    const float cos = std::cos(angle);
+    const Float2 start = turn_start_vecs[ix];
+    const Float2 vec(cos * start.X - sin * start.Y, sin * start.X + cos * start.Y);
+    current_vecs[ix] = vec;
+    positions[ix] = turn_centers[ix] - NormalOnSide(vec, side) * turn_radii[ix];
+}
+
+bool VisitorSystem::CalculateNext(int ix, MapNavigation *nav)
+{
+    // On arriving at a tile, the position and direction are the same in every tier.
+    lod_tiers[ix] = target_tiers[ix];
+    nav->MoveOccupant(current_tiles[ix], dest_tiles[ix]);
+    current_tiles[ix] = dest_tiles[ix];
+    current_dirs[ix] = dest_dirs[ix];
+    current_vecs[ix] = WalkVector(dest_dirs[ix]);
+
+    if (states[ix] == VisitorState::ParkEntry)
+    {
+        states[ix] = VisitorState::Walking;
+        dest_tiles[ix].Y = -1;
+    }
+    else
+        dest_tiles[ix] = nav->PickTile(current_tiles[ix], dest_dirs[ix], streams[ix]);
+
+    const Int2 current = current_tiles[ix];
+    const Int2 dest = dest_tiles[ix];
+    const bool result = dest != current;
+    if (walking[ix] != result)
+    {
+        walking[ix] = result;
+        walking_dirty[ix] = true;
+    }
+    if (!result)
+        return false;
+
+    dest_dirs[ix] = WalkDirection(current, dest, dest_dirs[ix]);
+    dest_positions[ix] = ArrivePosition(dest_dirs[ix], dest);
+    if (lod_tiers[ix] != LodTier::Near)
+    {
+        CalculateLine(ix);
+        return true;
+    }
+
+    // The destination is ahead, behind or to a side of the walking direction.
+    const Float2 forward = WalkVector(current_dirs[ix]);
+    const float ahead = forward.X * (float)(dest.X - current.X) + forward.Y * (float)(dest.Y - current.Y);
+    if (ahead > 0.0f)
+        CalculateForward(ix);
+    else if (ahead < 0.0f)
+        CalculateFullTurn(ix);
+    else
+        CalculateTurn(ix);
+    return true;
+}
+
+void VisitorSystem::CalculateForward(int ix)
+{
+    move_states[ix] = MoveState::GoForward;
+    if (current_dirs[ix] == NavDir::Up || current_dirs[ix] == NavDir::Down)
+        walk_distances[ix] = std::abs(dest_positions[ix].Y - positions[ix].Y);
+    else
+        walk_distances[ix] = std::abs(dest_positions[ix].X - positions[ix].X);
+}
+
+void VisitorSystem::CalculateTurn(int ix)
+{
+    const NavDir currentDir = current_dirs[ix];
+    float lineDist = 0.0f;
+    TurnSide side = TurnSide::CCW;
+    switch (dest_dirs[ix])
+    {
+    case NavDir::Right:
+        lineDist = std::abs(dest_positions[ix].Y - positions[ix].Y);
+        side = currentDir == NavDir::Up ? TurnSide::CW : TurnSide::CCW;
+        break;
+    case NavDir::Left:
+        lineDist = std::abs(dest_positions[ix].Y - positions[ix].Y);
+        side = currentDir == NavDir::Up ? TurnSide::CCW : TurnSide::CW;
+        break;
+    case NavDir::Up:
+        lineDist = std::abs(dest_positions[ix].X - positions[ix].X);
+        side = currentDir == NavDir::Right ? TurnSide::CCW : TurnSide::CW;
+        break;
+    case NavDir::Down:
+        lineDist = std::abs(dest_positions[ix].X - positions[ix].X);
+        side = currentDir == NavDir::Right ? TurnSide::CW : TurnSide::CCW;
+        break;
+    }
+
+    const float distance = std::max(lineDist - MaximumTurnRadius, 0.0f);
+    const float radius = lineDist - distance;
+    move_states[ix] = distance != 0.0f ? MoveState::ApproachTurn : MoveState::Turning;
+    turn_sides[ix] = side;
+    turn_distances[ix] = distance;
+    turn_radii[ix] = radius;
+    turn_arcs[ix] = 1.0f;
+    turn_start_vecs[ix] = current_vecs[ix];
+    turn_centers[ix] = positions[ix] + current_vecs[ix] * distance + NormalOnSide(current_vecs[ix], side) * radius;
+}
+
+void VisitorSystem::CalculateFullTurn(int ix)
+{
+    move_states[ix] = MoveState::ApproachFullTurn;
+    walk_distances[ix] = tile_dim * (1.0f - LaneSideDistance * 0.5f) - MaximumTurnRadius;
+    turn_arcs[ix] = 1.0f;
+    turn_radii[ix] = std::min(MaximumTurnRadius, tile_dim * (0.5f - LaneSideDistance));
+    turn_sides[ix] = TurnSide::CCW;
+    turn_start_vecs[ix] = current_vecs[ix];
+    turn_centers[ix] = positions[ix] + current_vecs[ix] * walk_distances[ix] + NormalOnSide(current_vecs[ix], TurnSide::CCW) * turn_radii[ix];
+}
+
+void VisitorSystem::CalculateLine(int ix)
+{
+    // Walking forward moves along the walking vector, which can point in any direction.
+    const Float2 line = dest_positions[ix] - positions[ix];
+    const float length = std::sqrt(line.X * line.X + line.Y * line.Y);
+    move_states[ix] = MoveState::GoForward;
+    walk_distances[ix] = length;
+    if (length > 0.1e-3f)
+        current_vecs[ix] = line * (1.0f / length);
+}
+
+void VisitorSystem::GenerateBarfTime(int ix)
+{
+    barf_timers[ix] = barf_streams[ix].Rand() * 20.0f + 5.0f;
+}
+
+Float2 VisitorSystem::ArrivePosition(NavDir dir, Int2 tile) const
+{
+    Float2 result(tile.X * tile_dim + tile_dim * 0.5f, tile.Y * tile_dim + tile_dim * 0.5f);
+    const float lane = tile_dim * (0.5f - LaneSideDistance);
+    const float half = tile_dim * 0.5f;
+    switch (dir)
+    {
+    case NavDir::Up:
+        result = Float2(result.X + lane, result.Y - half);
+        break;
+    case NavDir::Down:
+        result = Float2(result.X - lane, result.Y + half);
+        break;
+    case NavDir::Right:
+        result = Float2(result.X - half, result.Y - lane);
+        break;
+    case NavDir::Left:
+        result = Float2(result.X + half, result.Y + lane);
+        break;
+    }
+    return result;
+}
+
+void VisitorSystem::RemoveAt(int ix)
+{
+    // The last visitor is moved in place of the removed one.
+    const int last = actors.Count() - 1;
+    visitor_indices[visitor_ids[last]] = ix;
+
+    visitor_ids.RemoveAt(ix);
+    actors.RemoveAt(ix);
+    states.RemoveAt(ix);
+    walking_speeds.RemoveAt(ix);
+    positions.RemoveAt(ix);
+    previous_positions.RemoveAt(ix);
+    previous_vecs.RemoveAt(ix);
+    current_tiles.RemoveAt(ix);
+    current_dirs.RemoveAt(ix);
+    current_vecs.RemoveAt(ix);
+    dest_tiles.RemoveAt(ix);
+    dest_positions.RemoveAt(ix);
+    dest_dirs.RemoveAt(ix);
+    move_states.RemoveAt(ix);
+    turn_sides.RemoveAt(ix);
+    turn_distances.RemoveAt(ix);
+    turn_radii.RemoveAt(ix);
+    turn_arcs.RemoveAt(ix);
+    turn_centers.RemoveAt(ix);
+    turn_start_vecs.RemoveAt(ix);
+    walk_distances.RemoveAt(ix);
+    barf_timers.RemoveAt(ix);
+    streams.RemoveAt(ix);
+    barf_streams.RemoveAt(ix);
+    lod_tiers.RemoveAt(ix);
+    target_tiers.RemoveAt(ix);
+    pending_times.RemoveAt(ix);
+    hopped.RemoveAt(ix);
+    walking.RemoveAt(ix);
+    walking_dirty.RemoveAt(ix);
+    settled.RemoveAt(ix);
+}
+
+Float2 VisitorSystem::WalkVector(NavDir dir)
+{
+    switch (dir)
+    {
+    case NavDir::Down:
+        return Float2(0.0f, -1.0f);
+    case NavDir::Right:
+        return Float2(1.0f, 0.0f);
+    case NavDir::Left:
+        return Float2(-1.0f, 0.0f);
+    default:
+        return Float2(0.0f, 1.0f);
+    }
+}
+
+Float2 VisitorSystem::NormalOnSide(Float2 direction, TurnSide side)
+{
+    if (side == TurnSide::CW)
+        return Float2(direction.Y, -direction.X);
+    return Float2(-direction.Y, direction.X);
+}
+
+NavDir VisitorSystem::WalkDirection(Int2 from, Int2 to, NavDir defaultDir)
+{
+    if (to.X < from.X)
+        return NavDir::Left;
+    if (to.X > from.X)
+        return NavDir::Right;
+    if (to.Y < from.Y)
+        return NavDir::Down;
+    if (to.Y > from.Y)
+        return NavDir::Up;
+    return defaultDir;
+}
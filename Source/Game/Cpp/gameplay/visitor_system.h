@@ -0,0 +1,182 @@
+﻿#pragma once
+
+#include "Engine/Scripting/Script.h"
+#include "Engine/Core/Math/Vector2.h"
+#include "Engine/Core/Math/Vector3.h"
+#include "map_navigation.h"
+#include "../util/randomizer.h"
+
+class AnimatedModel;
+
+
+// Moves every visitor of the park. Visitor state is kept in parallel arrays, one item per visitor, and
+// advanced for all of them in a single loop. Only the final transforms and animation parameters are written
+// to the actors afterwards. Visitors are simulated at a fixed tick rate, so the cost and the results don't
+// depend on the frame rate, and actors are interpolated between the last two ticks when rendered.
+//
+// Visitors far from the camera are simulated with less detail. Near ones walk the smooth turns, visitors at
+// mid range walk in straight lines from tile to tile, and far ones do the same in fewer, longer ticks, with
+// their actors only moved when they are ticked. Visitors only change tier when they arrive at a tile, where
+// every tier is in the same state, and decisions only use the random stream of the visitor, so with the
+// crowd threshold of the map turned off, the tiles they pick don't depend on the tier. Crowd avoidance reads
+// how many visitors are on the tiles around, and visitors arrive at different times in each tier, as arcs
+// are shorter than lines and far visitors arrive at their next tick, so crowded decisions can differ.
+API_CLASS() class GAME_API VisitorSystem : public Script
+{
+API_AUTO_SERIALIZATION();
+DECLARE_SCRIPTING_TYPE(VisitorSystem);
+
+    // Largest radius of the arc walked when turning.
+    API_FIELD() float MaximumTurnRadius;
+    // The distance of one road lane to the side of the lane, in fraction to tile dimension.
+    API_FIELD() float LaneSideDistance;
+    // Simulation ticks per second. 0 or less simulates once every frame with the frame time instead.
+    API_FIELD() float TickRate;
+    // Distance from the camera where visitors stop walking smooth turns, and where they are only ticked
+    // every FAR_TICK_INTERVAL ticks.
+    API_FIELD() float MidDistance;
+    API_FIELD() float FarDistance;
+
+    // Ticks run at most this many times in one update to catch up after a long frame.
+    static constexpr int MAX_TICKS_PER_UPDATE = 4;
+    static constexpr int FAR_TICK_INTERVAL = 4;
+
+    // [Script]
+    void OnUpdate() override;
+
+    // Starts moving the actor from spawnTile outside the park to entryTile, and into the park from there.
+    // Returns the id of the visitor.
+    API_FUNCTION() int AddVisitor(AnimatedModel *actor, float walkingSpeed, Int2 spawnTile, Int2 entryTile);
+    API_FUNCTION() void RemoveVisitor(int id);
+    API_FUNCTION() int VisitorCount() const;
+    // Tile the visitor last arrived at, or (-1, -1) for an unknown id.
+    API_FUNCTION() Int2 GetVisitorTile(int id) const;
+    // Hash of the simulated state of every visitor: its id, position, tiles, directions, states and barf
+    // timer. A replay that matches its recording bit by bit ends with the same hash.
+    uint64 StateHash() const;
+
+private:
+    enum class VisitorState : uint8
+    {
+        ParkEntry,
+        Barfing,
+        Walking
+    };
+
+    enum class MoveState : uint8
+    {
+        // The cell or destination position is approximately forward. Move directly towards the goal.
+        GoForward,
+        // The cell destination is to a side, but we need to get close to the vertical or horizontal line of direction first.
+        ApproachTurn,
+        // Near the line of direction. Turning towards destination.
+        Turning,
+        // When the destination cell is the one behind, walk forward into the current grid cell to make move look less unnatural.
+        ApproachFullTurn,
+        // Initial turn when having to turn back to the grid cell behind. It is followed by normal ApproachTurn and Turning.
+        TurningFullTurn
+    };
+
+    // Level of detail of the simulation of a visitor.
+    enum class LodTier : uint8
+    {
+        Near,
+        Mid,
+        Far
+    };
+
+    // Side of the walking direction the center of a turn is on.
+    enum class TurnSide : uint8
+    {
+        CCW,
+        CW
+    };
+
+    friend class SimReplay;
+
+    // Advances every visitor by delta seconds. The level of detail depends on the distance to the camera
+    // position, and is always the highest without one.
+    void Tick(float delta, MapNavigation *nav, const Float3 *camera);
+    // Writes the transforms interpolated between the last two ticks by alpha, and changed parameters.
+    void UpdateActors(float alpha);
+    // Moves a visitor by delta seconds of walking.
+    void Walk(int ix, float delta, MapNavigation *nav);
+    // Walks along the arc of the current turn, using up delta until the turn is done.
+    void WalkTurn(int ix, float &delta);
+    // Picks the next tile when the visitor arrived at its destination. Returns false if it stays.
+    bool CalculateNext(int ix, MapNavigation *nav);
+    void CalculateForward(int ix);
+    void CalculateTurn(int ix);
+    void CalculateFullTurn(int ix);
+    // Walks straight to the destination, for tiers without smooth turns.
+    void CalculateLine(int ix);
+    void GenerateBarfTime(int ix);
+    // Position on the X and Z axes where a visitor arrives to tile walking in dir.
+    Float2 ArrivePosition(NavDir dir, Int2 tile) const;
+    void RemoveAt(int ix);
+
+    static Float2 WalkVector(NavDir dir);
+    // Perpendicular of direction pointing to side.
+    static Float2 NormalOnSide(Float2 direction, TurnSide side);
+    static NavDir WalkDirection(Int2 from, Int2 to, NavDir defaultDir);
+
+    float tile_dim;
+    // Time passed since the last tick, and the number of ticks so far.
+    float tick_time;
+    uint32 tick_count;
+
+    // Visitor ids are indices in visitor_indices, which holds the index of the visitor in the other arrays,
+    // or -1 for unused ids.
+    Array<int32> visitor_indices;
+    Array<int32> free_ids;
+    Array<int32> visitor_ids;
+    uint64 next_stream_id;
+
+    // Per-visitor state. Positions and walking vectors are on the X and Z axes.
+    Array<AnimatedModel*> actors;
+    Array<VisitorState> states;
+    Array<float> walking_speeds;
+    Array<Float2> positions;
+    // Position and walking vector at the end of the tick before the last one, for interpolation.
+    Array<Float2> previous_positions;
+    Array<Float2> previous_vecs;
+    Array<Int2> current_tiles;
+    Array<NavDir> current_dirs;
+    Array<Float2> current_vecs;
+    // Next tile to walk to, position to walk to, and direction to face when arriving there.
+    Array<Int2> dest_tiles;
+    Array<Float2> dest_positions;
+    Array<NavDir> dest_dirs;
+
+    Array<MoveState> move_states;
+    Array<TurnSide> turn_sides;
+    // How much to go until the direction's line is close enough to start turning towards it.
+    Array<float> turn_distances;
+    // Radius of turning until facing the move direction (or line of move direction on full turn around).
+    Array<float> turn_radii;
+    // How much of a 90 degree turn is left to turn, between 0 and 1.
+    Array<float> turn_arcs;
+    // Center of circle to walk around when turning, and the walking vector when the turn started.
+    Array<Float2> turn_centers;
+    Array<Float2> turn_start_vecs;
+    // How much left to walk to reach the destination.
+    Array<float> walk_distances;
+
+    Array<float> barf_timers;
+    // Random streams for the tile decisions and for everything else.
+    Array<RandomizerStream> streams;
+    Array<RandomizerStream> barf_streams;
+
+    // Current tier, and the tier to switch to at the next tile.
+    Array<LodTier> lod_tiers;
+    Array<LodTier> target_tiers;
+    // Time far visitors walked since they were last ticked, and whether they were ticked since their actor
+    // was moved.
+    Array<float> pending_times;
+    Array<bool> hopped;
+    // Whether the Walking animation parameter is set, and whether it needs to be written to the actor.
+    Array<bool> walking;
+    Array<bool> walking_dirty;
+    // Whether the actor was moved to the position of a visitor that stopped, so it needs no more writes.
+    Array<bool> settled;
+};
@@ -17,4 +17,5 @@ DECLARE_SCRIPTING_TYPE(ScriptGlobals);
 
     API_FIELD() float TileDimension;
     API_FIELD() ScriptingObjectReference<Script> MapNavigation;
+    API_FIELD() ScriptingObjectReference<Script> VisitorSystem;
 };
@@ -0,0 +1,118 @@
+#include "floor_chunks.h"
+#include "../script_globals.h"
+#include "Engine/Content/Assets/Model.h"
+#include "Engine/Core/Math/Math.h"
+#include "Engine/Debug/DebugLog.h"
+#include "Engine/Level/Actors/StaticModel.h"
+
+
+FloorChunks::FloorChunks(const SpawnParams& params)
+    : Script(params), map_size(0, 0), chunk_counts(0, 0)
+{
+    _tickLateUpdate = true;
+}
+
+void FloorChunks::OnLateUpdate()
+{
+    if (dirty_chunks.IsEmpty())
+        return;
+
+    for (int index : dirty_chunks)
+        BuildChunk(index);
+    dirty_chunks.Clear();
+}
+
+void FloorChunks::OnDestroy()
+{
+    // The chunk models are virtual assets only this script knows about.
+    for (Chunk &chunk : chunks)
+    {
+        if (chunk.model != nullptr)
+            chunk.model->DeleteObject();
+        chunk.model = nullptr;
+    }
+}
+
+void FloorChunks::Init(TileGenerator *generator, Int2 map_size, MaterialBase *material)
+{
+    if (generator == nullptr || map_size.X <= 0 || map_size.Y <= 0 || ChunkSize <= 0)
+    {
+        DebugLog::LogError(TEXT("FloorChunks needs a tile generator, a map size and a chunk size to build the floor."));
+        return;
+    }
+    if (!chunks.IsEmpty())
+    {
+        DebugLog::LogError(TEXT("FloorChunks was already initialized."));
+        return;
+    }
+
+    this->generator = generator;
+    this->material = material;
+    this->map_size = map_size;
+    chunk_counts = Int2((map_size.X + ChunkSize - 1) / ChunkSize, (map_size.Y + ChunkSize - 1) / ChunkSize);
+
+    tiles.Resize(map_size.X * map_size.Y);
+    for (GroupFloor &tile : tiles)
+        tile = GroupFloor(FloorGroup::Grass, FloorType::FullTile);
+
+    const float chunk_dimension = ScriptGlobals::tile_dimension * ChunkSize;
+    chunks.Resize(chunk_counts.X * chunk_counts.Y);
+    for (int ix = 0, siz = chunks.Count(); ix < siz; ++ix)
+    {
+        StaticModel *actor = New<StaticModel>(SpawnParams(Guid::New(), StaticModel::TypeInitializer));
+        actor->SetName(String::Format(TEXT("FloorChunk {0}"), ix));
+        actor->SetParent(GetActor(), false);
+        actor->SetPosition(Vector3((ix % chunk_counts.X) * chunk_dimension, 0.0f, (ix / chunk_counts.X) * chunk_dimension));
+
+        chunks[ix] = Chunk();
+        chunks[ix].actor = actor;
+        BuildChunk(ix);
+    }
+}
+
+void FloorChunks::SetTile(Int2 pos, FloorGroup group, FloorType floor)
+{
+    if (pos.X < 0 || pos.Y < 0 || pos.X >= map_size.X || pos.Y >= map_size.Y)
+        return;
+
+    GroupFloor &tile = tiles[pos.Y * map_size.X + pos.X];
+    if (tile.group == group && tile.floor == floor)
+        return;
+    tile = GroupFloor(group, floor);
+
+    const int index = (pos.Y / ChunkSize) * chunk_counts.X + pos.X / ChunkSize;
+    if (chunks[index].dirty)
+        return;
+    chunks[index].dirty = true;
+    dirty_chunks.Add(index);
+}
+
+void FloorChunks::BuildChunk(int index)
+{
+    Chunk &chunk = chunks[index];
+    chunk.dirty = false;
+    if (generator == nullptr || chunk.actor == nullptr)
+        return;
+
+    const int from_x = (index % chunk_counts.X) * ChunkSize;
+    const int from_y = (index / chunk_counts.X) * ChunkSize;
+    const int width = Math::Min(ChunkSize, map_size.X - from_x);
+    const int height = Math::Min(ChunkSize, map_size.Y - from_y);
+
+    Array<GroupFloor> data;
+    data.Resize(width * height);
+    for (int iy = 0; iy < height; ++iy)
+    {
+        for (int ix = 0; ix < width; ++ix)
+            data[iy * width + ix] = tiles[(from_y + iy) * map_size.X + from_x + ix];
+    }
+
+    Model *old_model = chunk.model;
+    chunk.model = generator->CreateModel(data, width, height);
+    chunk.actor->Model = chunk.model;
+    // Setting a new model resets the material slots of the actor.
+    chunk.actor->SetMaterial(0, material.Get());
+
+    if (old_model != nullptr)
+        old_model->DeleteObject();
+}
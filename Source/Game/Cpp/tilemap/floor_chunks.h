@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Engine/Scripting/Script.h"
+#include "Engine/Scripting/ScriptingObjectReference.h"
+#include "Engine/Content/AssetReference.h"
+#include "Engine/Content/Assets/MaterialBase.h"
+#include "Engine/Core/Math/Vector2.h"
+#include "tile_generator.h"
+
+class StaticModel;
+
+
+// Draws the floor of the park. The map is split into square chunks of tiles, and every chunk is a single
+// StaticModel with one mesh built by TileGenerator::CreateModel, so the actor and draw call counts grow with
+// the chunks instead of the tiles. Changing a tile only marks its chunk dirty. Dirty chunks are rebuilt once
+// in the late update of the frame, however many of their tiles changed.
+API_CLASS() class GAME_API FloorChunks : public Script
+{
+API_AUTO_SERIALIZATION();
+DECLARE_SCRIPTING_TYPE(FloorChunks);
+
+public:
+    // [Script]
+    void OnLateUpdate() override;
+    void OnDestroy() override;
+
+    // Number of tiles on each side of a chunk. Changing it after Init has no effect, so TileMap sets it from
+    // its FloorChunkSize when it adds the script.
+    API_FIELD() int ChunkSize = 16;
+
+    // Creates the chunk actors for a map of map_size tiles filled with grass, and builds their meshes. The
+    // chunks are added as children of the script's actor, with material on their only material slot.
+    API_FUNCTION() void Init(TileGenerator *generator, Int2 map_size, MaterialBase *material);
+
+    // Changes the floor of a tile. Its chunk is rebuilt in the next late update.
+    API_FUNCTION() void SetTile(Int2 pos, FloorGroup group, FloorType floor);
+
+    API_FUNCTION() int ChunkCount() const { return chunks.Count(); }
+
+private:
+    struct Chunk
+    {
+        StaticModel *actor = nullptr;
+        Model *model = nullptr;
+        bool dirty = false;
+    };
+
+    // Replaces the mesh of a chunk with one built from the current tiles.
+    void BuildChunk(int index);
+
+    ScriptingObjectReference<TileGenerator> generator;
+    AssetReference<MaterialBase> material;
+    Int2 map_size;
+    Int2 chunk_counts;
+    // Tiles of the whole map, row by row.
+    Array<GroupFloor> tiles;
+    // Chunks row by row, chunk_counts.X in each row.
+    Array<Chunk> chunks;
+    Array<int> dirty_chunks;
+};
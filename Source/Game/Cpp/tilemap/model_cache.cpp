@@ -0,0 +1,267 @@
+#include "model_cache.h"
+#include "Engine/Content/Content.h"
+#include "Engine/Content/Assets/Model.h"
+#include "Engine/Content/Storage/FlaxStorage.h"
+#include "Engine/Core/Types/DateTime.h"
+#include "Engine/Core/Types/String.h"
+#include "Engine/Engine/Globals.h"
+#include "Engine/Graphics/Models/Mesh.h"
+#include "Engine/Platform/File.h"
+#include "Engine/Platform/FileSystem.h"
+
+#include <cstring>
+
+
+namespace
+{
+    // File layout: the magic, version and key, the LOD count, the material slot count and the number of
+    // meshes, then the mesh count of each LOD. Each mesh follows with its LOD, index in the LOD, material
+    // slot, vertex and index counts, then the positions, normals, texture coordinates and indexes. Every
+    // value is 4 bytes or a multiple of it, so the buffers can be uploaded from where they are in the file.
+    // Values are in native byte order, which is little endian on every platform the game runs on.
+    constexpr uint32 CACHE_MAGIC = 0x434d4754; // "TGMC"
+    constexpr uint32 CACHE_VERSION = 1;
+    constexpr int MESH_COUNT_POS = 24;
+
+    String CacheFolder()
+    {
+        return Globals::ProductLocalFolder / TEXT("ModelCache");
+    }
+
+    // Files are named after the sources first, so the out of date versions of a file can be found by name.
+    String CacheFileName(uint64 sources, uint64 key)
+    {
+        return String::Format(TEXT("{0:016x}-{1:016x}.bin"), sources, key);
+    }
+
+    String CachePath(uint64 sources, uint64 key)
+    {
+        return CacheFolder() / CacheFileName(sources, key);
+    }
+
+    // 64 bit FNV-1a.
+    void Fnv1a(uint64 &hash, const void *bytes, int size)
+    {
+        for (int ix = 0; ix < size; ++ix)
+        {
+            hash ^= ((const byte*)bytes)[ix];
+            hash *= 1099511628211ull;
+        }
+    }
+
+    template<typename T>
+    void AppendRaw(Array<byte> &data, const T &value)
+    {
+        data.Add((const byte*)&value, (int32)sizeof(T));
+    }
+
+    template<typename T>
+    void AppendArray(Array<byte> &data, const Array<T> &values)
+    {
+        data.Add((const byte*)values.Get(), (int32)sizeof(T) * values.Count());
+    }
+
+    // Walks the cache file, failing instead of reading past its end.
+    struct CacheReader
+    {
+        const Array<byte> &data;
+        int position = 0;
+        bool failed = false;
+
+        explicit CacheReader(const Array<byte> &data) : data(data) { ; }
+
+        const byte* Skip(int64 size)
+        {
+            if (failed || size < 0 || position + size > data.Count())
+            {
+                failed = true;
+                return nullptr;
+            }
+            const byte *start = data.Get() + position;
+            position += (int)size;
+            return start;
+        }
+
+        uint32 UInt()
+        {
+            uint32 value = 0;
+            if (const byte *bytes = Skip(sizeof(uint32)))
+                std::memcpy(&value, bytes, sizeof(uint32));
+            return value;
+        }
+
+        uint64 UInt64()
+        {
+            uint64 value = 0;
+            if (const byte *bytes = Skip(sizeof(uint64)))
+                std::memcpy(&value, bytes, sizeof(uint64));
+            return value;
+        }
+    };
+
+    struct CachedMesh
+    {
+        int lod;
+        int mesh;
+        int material_slot;
+        uint32 vert_count;
+        uint32 index_count;
+        const Float3 *verts;
+        const Float3 *normals;
+        const Float2 *uvs;
+        const uint32 *indexes;
+    };
+}
+
+
+ModelCache::Key::Key(uint32 kind) : hash(14695981039346656037ull), sources(14695981039346656037ull)
+{
+    Add(CACHE_VERSION);
+    Add(kind);
+}
+
+bool ModelCache::Key::AddModel(const Model *model)
+{
+    // GetPath gives the path in the project, which only exists in the editor. Cooked assets are stored in
+    // packages.
+    if (model == nullptr || model->IsVirtual() || model->Storage == nullptr)
+        return false;
+    const DateTime edited = FileSystem::GetFileLastEditTime(model->Storage->GetPath());
+    if (edited == DateTime::MinValue())
+        return false;
+
+    Add(model->GetID());
+    AddVersion(&edited.Ticks, (int)sizeof(edited.Ticks));
+    const int32 lod_count = model->LODs.Count();
+    AddVersion(&lod_count, (int)sizeof(lod_count));
+    for (const ModelLOD &lod : model->LODs)
+    {
+        const int32 mesh_count = lod.Meshes.Count();
+        AddVersion(&mesh_count, (int)sizeof(mesh_count));
+    }
+    return true;
+}
+
+void ModelCache::Key::AddBytes(const void *bytes, int size)
+{
+    Fnv1a(hash, bytes, size);
+    Fnv1a(sources, bytes, size);
+}
+
+void ModelCache::Key::AddVersion(const void *bytes, int size)
+{
+    Fnv1a(hash, bytes, size);
+}
+
+
+ModelCache::ModelCache(const Key &key, const Array<int32> &lod_meshes, int material_slots) : key(key.Value()), sources(key.Sources()), mesh_count(0)
+{
+    AppendRaw(data, CACHE_MAGIC);
+    AppendRaw(data, CACHE_VERSION);
+    AppendRaw(data, this->key);
+    AppendRaw(data, (uint32)lod_meshes.Count());
+    AppendRaw(data, (uint32)material_slots);
+    AppendRaw(data, (uint32)0);
+    for (int32 count : lod_meshes)
+        AppendRaw(data, (uint32)count);
+}
+
+void ModelCache::AddMesh(int lod, int mesh, int material_slot, const Array<Float3> &verts, const Array<Float3> &normals, const Array<Float2> &uvs, const Array<uint32> &indexes)
+{
+    AppendRaw(data, (uint32)lod);
+    AppendRaw(data, (uint32)mesh);
+    AppendRaw(data, (uint32)material_slot);
+    AppendRaw(data, (uint32)verts.Count());
+    AppendRaw(data, (uint32)indexes.Count());
+    AppendArray(data, verts);
+    AppendArray(data, normals);
+    AppendArray(data, uvs);
+    AppendArray(data, indexes);
+
+    ++mesh_count;
+    const uint32 count = (uint32)mesh_count;
+    std::memcpy(data.Get() + MESH_COUNT_POS, &count, sizeof(uint32));
+}
+
+bool ModelCache::Save() const
+{
+    if (FileSystem::CreateDirectory(CacheFolder()))
+        return false;
+    if (File::WriteAllBytes(CachePath(sources, key), data))
+        return false;
+
+    // The files of the same model built from older versions of its sources would never be read again.
+    Array<String> files;
+    if (!FileSystem::DirectoryGetFiles(files, CacheFolder(), *String::Format(TEXT("{0:016x}-*.bin"), sources), DirectorySearchOption::TopDirectoryOnly))
+    {
+        const String current = CacheFileName(sources, key);
+        for (const String &file : files)
+        {
+            if (!file.EndsWith(current))
+                FileSystem::DeleteFile(file);
+        }
+    }
+    return true;
+}
+
+Model* ModelCache::Load(const Key &key)
+{
+    Array<byte> data;
+    if (File::ReadAllBytes(CachePath(key.Sources(), key.Value()), data))
+        return nullptr;
+
+    CacheReader reader(data);
+    if (reader.UInt() != CACHE_MAGIC || reader.UInt() != CACHE_VERSION || reader.UInt64() != key.Value())
+        return nullptr;
+    const uint32 lod_count = reader.UInt();
+    const uint32 material_slots = reader.UInt();
+    const uint32 mesh_count = reader.UInt();
+    if (reader.failed || lod_count == 0 || lod_count > MODEL_MAX_LODS)
+        return nullptr;
+
+    Array<int32> lod_meshes;
+    for (uint32 ix = 0; ix < lod_count; ++ix)
+    {
+        const uint32 count = reader.UInt();
+        if (count > 0xffff)
+            return nullptr;
+        lod_meshes.Add((int32)count);
+    }
+
+    // Every mesh is checked before the model is created, so a damaged file is only a cache miss.
+    Array<CachedMesh> meshes;
+    for (uint32 ix = 0; ix < mesh_count && !reader.failed; ++ix)
+    {
+        CachedMesh mesh;
+        mesh.lod = (int)reader.UInt();
+        mesh.mesh = (int)reader.UInt();
+        mesh.material_slot = (int)reader.UInt();
+        mesh.vert_count = reader.UInt();
+        mesh.index_count = reader.UInt();
+        mesh.verts = (const Float3*)reader.Skip((int64)sizeof(Float3) * mesh.vert_count);
+        mesh.normals = (const Float3*)reader.Skip((int64)sizeof(Float3) * mesh.vert_count);
+        mesh.uvs = (const Float2*)reader.Skip((int64)sizeof(Float2) * mesh.vert_count);
+        mesh.indexes = (const uint32*)reader.Skip((int64)sizeof(uint32) * mesh.index_count);
+        if (reader.failed || mesh.lod < 0 || mesh.lod >= (int)lod_count || mesh.mesh < 0 || mesh.mesh >= lod_meshes[mesh.lod] || mesh.index_count % 3 != 0)
+            return nullptr;
+        for (uint32 nix = 0; nix < mesh.index_count; ++nix)
+        {
+            if (mesh.indexes[nix] >= mesh.vert_count)
+                return nullptr;
+        }
+        meshes.Add(mesh);
+    }
+    if (reader.failed || reader.position != data.Count())
+        return nullptr;
+
+    Model *model = Content::CreateVirtualAsset<Model>();
+    model->SetupLODs(Span<int32>(lod_meshes.Get(), lod_meshes.Count()));
+    model->SetupMaterialSlots((int32)material_slots);
+    for (const CachedMesh &mesh : meshes)
+    {
+        Mesh &target = model->LODs[mesh.lod].Meshes[mesh.mesh];
+        target.UpdateMesh(mesh.vert_count, mesh.index_count / 3, mesh.verts, mesh.indexes, mesh.normals, (Float3*)nullptr, mesh.uvs, (Color32*)nullptr);
+        target.SetMaterialSlotIndex(mesh.material_slot);
+    }
+    return model;
+}
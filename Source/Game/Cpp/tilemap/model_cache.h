@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Engine/Core/Types/BaseTypes.h"
+#include "Engine/Core/Collections/Array.h"
+#include "Engine/Core/Math/Vector2.h"
+#include "Engine/Core/Math/Vector3.h"
+
+class Model;
+
+
+// On-disk cache of the models TileGenerator builds from copies of other models. Building them downloads the
+// source meshes from the GPU, so the finished vertex and index buffers are written to a file named after a
+// hash of everything the model was built from. Later runs upload the buffers straight from the file. Material
+// slots are not cached, they are always copied from the source models. A file is replaced when a source model
+// changes, so the cache keeps one file for each model generated with the same sources and parameters.
+class ModelCache
+{
+public:
+    // Hash of the inputs of a generated model: the source models and every parameter of the generation.
+    class Key
+    {
+    public:
+        // kind separates the ways of generating a model, so the same inputs don't collide.
+        explicit Key(uint32 kind);
+
+        // Adds the ID and version of a source model. The version is the edit time of the file the asset is
+        // stored in, which is the package file in cooked games. Returns false if the model has no file to take
+        // the version from. Models built from it can't be cached.
+        bool AddModel(const Model *model);
+
+        template<typename T>
+        void Add(const T &value)
+        {
+            AddBytes(&value, (int)sizeof(T));
+        }
+
+        uint64 Value() const { return hash; }
+        // Hash of the inputs without the versions of the source models. Cache files with the same sources
+        // and a different value are out of date.
+        uint64 Sources() const { return sources; }
+
+    private:
+        void AddBytes(const void *bytes, int size);
+        // Adds to the value only.
+        void AddVersion(const void *bytes, int size);
+
+        uint64 hash;
+        uint64 sources;
+    };
+
+    // Starts collecting the meshes of a model with lod_meshes meshes in each LOD.
+    ModelCache(const Key &key, const Array<int32> &lod_meshes, int material_slots);
+
+    // Adds the buffers uploaded to a mesh of the model. Meshes that are never added stay empty when loaded.
+    void AddMesh(int lod, int mesh, int material_slot, const Array<Float3> &verts, const Array<Float3> &normals, const Array<Float2> &uvs, const Array<uint32> &indexes);
+
+    // Writes the collected meshes to the cache file of the key, and deletes the files of older versions of the
+    // source models. Returns false if the file couldn't be written.
+    bool Save() const;
+
+    // Creates a model from the cache file of key, with its LODs, meshes and number of material slots set up.
+    // Returns null if there is no valid cache file for the key.
+    static Model* Load(const Key &key);
+
+private:
+    uint64 key;
+    uint64 sources;
+    Array<byte> data;
+    int mesh_count;
+};
@@ -1,90 +1,1007 @@
 ﻿#include <vector>
 
 #include "tile_generator.h"
+#include "model_cache.h"
 #include "../script_globals.h"
 
 #include <memory>
+#include <initializer_list>
 #include "Engine/Content/Content.h"
 #include "Engine/Core/Types/BaseTypes.h"
 #include "Engine/Graphics/Models/Mesh.h"
 #include "Engine/Debug/DebugLog.h"
 
-std::map<FloorGroup, std::map<TexType, Rectangle>> TileGenerator::floor_uv_data = {
-        { FloorGroup::Grass, { { TexType::FullTile, Rectangle(2, 2, 64, 64) } } },
-        { FloorGroup::WalkwayOnGrass, {
-            { TexType::FullTile, Rectangle(70, 2, 64, 64) },
-            { TexType::InCornerTopLeft, Rectangle(221, 75, 9, 9) },
-            { TexType::InCornerTopRight, Rectangle(212, 75, 9, 9) },
-            { TexType::InCornerBottomLeft, Rectangle(221, 2, 9, 9) },
-            { TexType::InCornerBottomRight, Rectangle(212, 2, 9, 9) },
-            { TexType::OutCornerTopLeft, Rectangle(138, 2, 35, 35) },
-            { TexType::OutCornerTopRight, Rectangle(173, 2, 35, 35) },
-            { TexType::OutCornerBottomLeft, Rectangle(138, 37, 35, 35) },
-            { TexType::OutCornerBottomRight, Rectangle(173, 37, 35, 35) },
-            { TexType::OutSharpCornerTopLeft, Rectangle(70, 70, 9, 9) },
-            { TexType::OutSharpCornerTopRight, Rectangle(83, 70, 9, 9) },
-            { TexType::OutSharpCornerBottomLeft, Rectangle(70, 83, 9, 9) },
-            { TexType::OutSharpCornerBottomRight, Rectangle(83, 83, 9, 9) },
-            { TexType::OutEdgeLeft, Rectangle(221, 11, 9, 64) },
-            { TexType::OutEdgeRight, Rectangle(212, 11, 9, 64) },
-            { TexType::OutEdgeTop, Rectangle(2, 79, 64, 9) },
-            { TexType::OutEdgeBottom, Rectangle(2, 70, 64, 9) }
-        } }
-};
+namespace
+{
+    constexpr int FLOOR_GROUP_COUNT = (int)FloorGroup::WalkwayOnGrass + 1;
+    constexpr int TEX_TYPE_COUNT = (int)TexType::OutEdgeBottom + 1;
+    constexpr int FLOOR_TYPE_COUNT = (int)FloorType::ValueMax;
+
+    // Rectangle of a texture in the floor texture atlas, in texels.
+    struct TexRect
+    {
+        int16 x = 0;
+        int16 y = 0;
+        int16 width = 0;
+        int16 height = 0;
+    };
 
+    struct FloorUVData
+    {
+        TexRect rects[FLOOR_GROUP_COUNT][TEX_TYPE_COUNT] = {};
 
-std::map<FloorGroup, Array<FloorType>> TileGenerator::floor_gen_data = {
-    { FloorGroup::Grass, { FloorType::FullTile } },
-    { FloorGroup::WalkwayOnGrass, {
-        FloorType::FullTile,
-        FloorType::HorzLane,
-        FloorType::VertLane,
-        FloorType::EdgeLeft,
-        FloorType::EdgeTop,
-        FloorType::EdgeRight,
-        FloorType::EdgeBottom,
-        FloorType::TurnTopRight,
-        FloorType::TurnTopLeft,
-        FloorType::TurnBottomRight,
-        FloorType::TurnBottomLeft,
-        FloorType::EdgeBottomLeft,
-        FloorType::EdgeBottomRight,
-        FloorType::EdgeTopLeft,
-        FloorType::EdgeTopRight,
-        FloorType::VertCrossRight,
-        FloorType::VertCrossLeft,
-        FloorType::HorzCrossTop,
-        FloorType::HorzCrossBottom,
-        FloorType::EdgeLeftCornerTopRight,
-        FloorType::EdgeLeftCornerBottomRight,
-        FloorType::EdgeRightCornerTopLeft,
-        FloorType::EdgeRightCornerBottomLeft,
-        FloorType::EdgeTopCornerBottomRight,
-        FloorType::EdgeTopCornerBottomLeft,
-        FloorType::EdgeBottomCornerTopRight,
-        FloorType::EdgeBottomCornerTopLeft,
-        FloorType::CornerExceptTopLeft,
-        FloorType::CornerExceptTopRight,
-        FloorType::CornerExceptBottomLeft,
-        FloorType::CornerExceptBottomRight,
-        FloorType::CornerAll,
-        FloorType::CornerBothTop,
-        FloorType::CornerBothRight,
-        FloorType::CornerBothBottom,
-        FloorType::CornerBothLeft,
-        FloorType::CornerTopLeftBottomRight,
-        FloorType::CornerTopRightBottomLeft,
-        FloorType::OnlyCornerTopRight,
-        FloorType::OnlyCornerTopLeft,
-        FloorType::OnlyCornerBottomRight,
-        FloorType::OnlyCornerBottomLeft,
-        FloorType::IsolatedTile,
-        FloorType::DeadendLeft,
-        FloorType::DeadendRight,
-        FloorType::DeadendTop,
-        FloorType::DeadendBottom
-    } }
-};
+        constexpr void Set(FloorGroup group, TexType tex, int x, int y, int width, int height)
+        {
+            rects[(int)group][(int)tex] = { (int16)x, (int16)y, (int16)width, (int16)height };
+        }
+    };
+
+    constexpr FloorUVData BuildFloorUVData()
+    {
+        FloorUVData data;
+        data.Set(FloorGroup::Grass, TexType::FullTile, 2, 2, 64, 64);
+
+        data.Set(FloorGroup::WalkwayOnGrass, TexType::FullTile, 70, 2, 64, 64);
+        data.Set(FloorGroup::WalkwayOnGrass, TexType::InCornerTopLeft, 221, 75, 9, 9);
+        data.Set(FloorGroup::WalkwayOnGrass, TexType::InCornerTopRight, 212, 75, 9, 9);
+        data.Set(FloorGroup::WalkwayOnGrass, TexType::InCornerBottomLeft, 221, 2, 9, 9);
+        data.Set(FloorGroup::WalkwayOnGrass, TexType::InCornerBottomRight, 212, 2, 9, 9);
+        data.Set(FloorGroup::WalkwayOnGrass, TexType::OutCornerTopLeft, 138, 2, 35, 35);
+        data.Set(FloorGroup::WalkwayOnGrass, TexType::OutCornerTopRight, 173, 2, 35, 35);
+        data.Set(FloorGroup::WalkwayOnGrass, TexType::OutCornerBottomLeft, 138, 37, 35, 35);
+        data.Set(FloorGroup::WalkwayOnGrass, TexType::OutCornerBottomRight, 173, 37, 35, 35);
+        data.Set(FloorGroup::WalkwayOnGrass, TexType::OutSharpCornerTopLeft, 70, 70, 9, 9);
+        data.Set(FloorGroup::WalkwayOnGrass, TexType::OutSharpCornerTopRight, 83, 70, 9, 9);
+        data.Set(FloorGroup::WalkwayOnGrass, TexType::OutSharpCornerBottomLeft, 70, 83, 9, 9);
+        data.Set(FloorGroup::WalkwayOnGrass, TexType::OutSharpCornerBottomRight, 83, 83, 9, 9);
+        data.Set(FloorGroup::WalkwayOnGrass, TexType::OutEdgeLeft, 221, 11, 9, 64);
+        data.Set(FloorGroup::WalkwayOnGrass, TexType::OutEdgeRight, 212, 11, 9, 64);
+        data.Set(FloorGroup::WalkwayOnGrass, TexType::OutEdgeTop, 2, 79, 64, 9);
+        data.Set(FloorGroup::WalkwayOnGrass, TexType::OutEdgeBottom, 2, 70, 64, 9);
+        return data;
+    }
+
+    constexpr FloorUVData floor_uv_data = BuildFloorUVData();
+
+    // Floor tile mesh in texels. Positions are in the tile with z growing towards its top edge, and texture
+    // coordinates are in the whole texture atlas. Scaling to the tile and texture size is left for runtime.
+    struct FloorMesh
+    {
+        static constexpr int MAX_VERTS = 36;
+        static constexpr int MAX_INDEXES = 66;
+
+        struct Vertex
+        {
+            int16 x = 0;
+            int16 z = 0;
+            int16 u = 0;
+            int16 v = 0;
+        };
+
+        int vert_count = 0;
+        int index_count = 0;
+        Vertex verts[MAX_VERTS] = {};
+        uint32 indexes[MAX_INDEXES] = {};
+    };
+
+    // A texture rectangle or a polygon cut from several, in texels from the top left corner of the tile.
+    struct FloorPiece
+    {
+        static constexpr int MAX_VERTS = 12;
+        static constexpr int MAX_INDEXES = 30;
+
+        int vert_count = 0;
+        int index_count = 0;
+        FloorMesh::Vertex verts[MAX_VERTS] = {};
+        uint8 indexes[MAX_INDEXES] = {};
+
+        // Side of the tile the piece is moved against when it's placed in the mesh.
+        TileSide side = TileSide::None;
+    };
+
+    // Corner of a polygon vertex in the first texture of the polygon, moved by the width (x) or height (z) of
+    // other textures of the polygon. A positive index adds the size of that texture, a negative subtracts it.
+    struct PolyVert
+    {
+        TileSide corner;
+        int8 x;
+        int8 z;
+
+        constexpr PolyVert(TileSide corner, int x = 0, int z = 0) : corner(corner), x((int8)x), z((int8)z) { ; }
+    };
+
+    constexpr int Add(int index) { return index; }
+    constexpr int Sub(int index) { return -index; }
+
+    // Collects the pieces of a floor type and places them in the finished mesh.
+    struct FloorRecipe
+    {
+        static constexpr int MAX_PIECES = 9;
+
+        FloorGroup group = FloorGroup::None;
+        int tile_width = 0;
+        int tile_height = 0;
+        // Set when a texture is missing from the group. Nothing is baked for the floor type.
+        bool missing = false;
+
+        int piece_count = 0;
+        FloorPiece pieces[MAX_PIECES] = {};
+        FloorMesh mesh;
+
+        constexpr FloorRecipe(FloorGroup group) : group(group)
+        {
+            const TexRect &full = floor_uv_data.rects[(int)group][(int)TexType::FullTile];
+            tile_width = full.width;
+            tile_height = full.height;
+        }
+
+        constexpr TexRect Tex(TexType tex)
+        {
+            const TexRect &rect = floor_uv_data.rects[(int)group][(int)tex];
+            if (rect.width == 0 || rect.height == 0)
+                missing = true;
+            return rect;
+        }
+
+        // Piece covering a whole texture, placed at the top left corner of the tile.
+        constexpr int Rect(TexType tex)
+        {
+            const TexRect rect = Tex(tex);
+            FloorPiece &piece = pieces[piece_count];
+            piece.vert_count = 4;
+            piece.verts[0] = { 0, 0, rect.x, rect.y };
+            piece.verts[1] = { rect.width, 0, (int16)(rect.x + rect.width), rect.y };
+            piece.verts[2] = { 0, rect.height, rect.x, (int16)(rect.y + rect.height) };
+            piece.verts[3] = { rect.width, rect.height, (int16)(rect.x + rect.width), (int16)(rect.y + rect.height) };
+            const uint8 rect_indexes[] = { 0, 1, 2, 1, 3, 2 };
+            piece.index_count = 6;
+            for (int ix = 0; ix < 6; ++ix)
+                piece.indexes[ix] = rect_indexes[ix];
+            return piece_count++;
+        }
+
+        // Polygon with its texture coordinates in the first texture of texes.
+        constexpr int Poly(std::initializer_list<TexType> texes, std::initializer_list<PolyVert> poly_verts, std::initializer_list<uint8> poly_indexes)
+        {
+            TexRect rects[5] = {};
+            int rect_count = 0;
+            for (TexType tex : texes)
+                rects[rect_count++] = Tex(tex);
+            const TexRect &base = rects[0];
+
+            FloorPiece &piece = pieces[piece_count];
+            for (const PolyVert &pv : poly_verts)
+            {
+                int x = pv.corner == TileSide::TopRight || pv.corner == TileSide::BottomRight ? base.width : 0;
+                int z = pv.corner == TileSide::BottomLeft || pv.corner == TileSide::BottomRight ? base.height : 0;
+                if (pv.x != 0)
+                    x += pv.x > 0 ? rects[pv.x].width : -rects[-pv.x].width;
+                if (pv.z != 0)
+                    z += pv.z > 0 ? rects[pv.z].height : -rects[-pv.z].height;
+                piece.verts[piece.vert_count++] = { (int16)x, (int16)z, (int16)(base.x + x), (int16)(base.y + z) };
+            }
+            for (uint8 index : poly_indexes)
+                piece.indexes[piece.index_count++] = index;
+            return piece_count++;
+        }
+
+        // Trims a rectangle piece on one side by the size of another piece, so the two don't overlap.
+        constexpr void CutLeft(int piece, int by)
+        {
+            const Bounds bounds = PieceBounds(pieces[by]);
+            MoveVerts(pieces[piece], 0, 2, bounds.max_x - bounds.min_x, 0);
+        }
+        constexpr void CutRight(int piece, int by)
+        {
+            const Bounds bounds = PieceBounds(pieces[by]);
+            MoveVerts(pieces[piece], 1, 3, bounds.min_x - bounds.max_x, 0);
+        }
+        constexpr void CutTop(int piece, int by)
+        {
+            const Bounds bounds = PieceBounds(pieces[by]);
+            MoveVerts(pieces[piece], 0, 1, 0, bounds.max_z - bounds.min_z);
+        }
+        constexpr void CutBottom(int piece, int by)
+        {
+            const Bounds bounds = PieceBounds(pieces[by]);
+            MoveVerts(pieces[piece], 2, 3, 0, bounds.min_z - bounds.max_z);
+        }
+
+        constexpr void Align(int piece, TileSide side)
+        {
+            pieces[piece].side = side;
+        }
+
+        // Places the pieces in the mesh in the given order, moved against the side of the tile they are aligned
+        // to. The same piece can be placed more than once.
+        constexpr void Mesh(std::initializer_list<int> order)
+        {
+            for (int ix : order)
+            {
+                const FloorPiece &piece = pieces[ix];
+                const Bounds bounds = PieceBounds(piece);
+                const TileSide side = piece.side;
+
+                int shift_x = 0;
+                int shift_z = 0;
+                if (side == TileSide::Left || side == TileSide::TopLeft || side == TileSide::BottomLeft)
+                    shift_x = -bounds.min_x;
+                if (side == TileSide::Right || side == TileSide::TopRight || side == TileSide::BottomRight)
+                    shift_x = tile_width - bounds.max_x;
+                if (side == TileSide::Top || side == TileSide::TopLeft || side == TileSide::TopRight)
+                    shift_z = -bounds.min_z;
+                if (side == TileSide::Bottom || side == TileSide::BottomLeft || side == TileSide::BottomRight)
+                    shift_z = tile_height - bounds.max_z;
+
+                for (int px = 0; px < piece.index_count; ++px)
+                    mesh.indexes[mesh.index_count++] = (uint32)(mesh.vert_count + piece.indexes[px]);
+                for (int vx = 0; vx < piece.vert_count; ++vx)
+                {
+                    FloorMesh::Vertex vert = piece.verts[vx];
+                    vert.x = (int16)(vert.x + shift_x);
+                    // The geometry was drawn for an engine with a reversed Z direction to Flax.
+                    vert.z = (int16)(tile_height - (vert.z + shift_z));
+                    mesh.verts[mesh.vert_count++] = vert;
+                }
+            }
+        }
+
+    private:
+        struct Bounds
+        {
+            int min_x = 0;
+            int min_z = 0;
+            int max_x = 0;
+            int max_z = 0;
+        };
+
+        constexpr Bounds PieceBounds(const FloorPiece &piece) const
+        {
+            Bounds bounds = { tile_width, tile_height, 0, 0 };
+            for (int ix = 0; ix < piece.vert_count; ++ix)
+            {
+                const FloorMesh::Vertex &vert = piece.verts[ix];
+                bounds.min_x = vert.x < bounds.min_x ? vert.x : bounds.min_x;
+                bounds.min_z = vert.z < bounds.min_z ? vert.z : bounds.min_z;
+                bounds.max_x = vert.x > bounds.max_x ? vert.x : bounds.max_x;
+                bounds.max_z = vert.z > bounds.max_z ? vert.z : bounds.max_z;
+            }
+            return bounds;
+        }
+
+        // Moves two vertices of a rectangle piece together with their texture coordinates.
+        static constexpr void MoveVerts(FloorPiece &piece, int first, int second, int x, int z)
+        {
+            for (int ix : { first, second })
+            {
+                piece.verts[ix].x = (int16)(piece.verts[ix].x + x);
+                piece.verts[ix].u = (int16)(piece.verts[ix].u + x);
+                piece.verts[ix].z = (int16)(piece.verts[ix].z + z);
+                piece.verts[ix].v = (int16)(piece.verts[ix].v + z);
+            }
+        }
+    };
+
+    using TS = TileSide;
+    using TT = TexType;
+
+    // The pieces of each floor type. Rectangles are trimmed against the corner pieces next to them, and then
+    // everything is moved against its side of the tile when placed in the mesh.
+    constexpr void BuildFloorRecipe(FloorRecipe &r, FloorType floor_type)
+    {
+        switch (floor_type)
+        {
+            case FloorType::FullTile:
+            {
+                const int base = r.Rect(TT::FullTile);
+                r.Mesh({ base });
+                break;
+            }
+            case FloorType::HorzLane:
+            {
+                const int top = r.Rect(TT::OutEdgeTop);
+                const int bottom = r.Rect(TT::OutEdgeBottom);
+                const int base = r.Rect(TT::FullTile);
+                r.CutTop(base, top);
+                r.CutBottom(base, bottom);
+                r.Align(bottom, TS::Bottom);
+                r.Mesh({ top, base, bottom });
+                break;
+            }
+            case FloorType::VertLane:
+            {
+                const int left = r.Rect(TT::OutEdgeLeft);
+                const int right = r.Rect(TT::OutEdgeRight);
+                const int base = r.Rect(TT::FullTile);
+                r.CutLeft(base, left);
+                r.CutRight(base, right);
+                r.Align(right, TS::Right);
+                r.Mesh({ left, base, right });
+                break;
+            }
+            case FloorType::EdgeLeft:
+            {
+                const int left = r.Rect(TT::OutEdgeLeft);
+                const int base = r.Rect(TT::FullTile);
+                r.CutLeft(base, left);
+                r.Mesh({ left, base });
+                break;
+            }
+            case FloorType::EdgeTop:
+            {
+                const int top = r.Rect(TT::OutEdgeTop);
+                const int base = r.Rect(TT::FullTile);
+                r.CutTop(base, top);
+                r.Mesh({ top, base });
+                break;
+            }
+            case FloorType::EdgeRight:
+            {
+                const int right = r.Rect(TT::OutEdgeRight);
+                const int base = r.Rect(TT::FullTile);
+                r.CutRight(base, right);
+                r.Align(right, TS::Right);
+                r.Mesh({ base, right });
+                break;
+            }
+            case FloorType::EdgeBottom:
+            {
+                const int bottom = r.Rect(TT::OutEdgeBottom);
+                const int base = r.Rect(TT::FullTile);
+                r.CutBottom(base, bottom);
+                r.Align(bottom, TS::Bottom);
+                r.Mesh({ base, bottom });
+                break;
+            }
+            case FloorType::TurnBottomLeft:
+            {
+                const int curve = r.Poly({ TT::OutCornerTopRight, TT::OutEdgeRight, TT::OutEdgeTop },
+                    { TS::TopLeft, TS::TopRight, TS::BottomLeft, { TS::TopLeft, 0, Add(2) }, { TS::BottomRight, Sub(1), 0 }, TS::BottomRight },
+                    { 0, 1, 3, 1, 4, 3, 1, 5, 4, 3, 4, 2 });
+                const int base = r.Poly({ TT::FullTile, TT::OutCornerTopRight, TT::OutEdgeRight, TT::OutEdgeTop, TT::InCornerBottomLeft },
+                    { { TS::TopLeft, 0, Add(3) }, { TS::TopRight, Sub(1), Add(3) }, { TS::TopRight, Sub(1), Add(1) }, { TS::TopRight, Sub(2), Add(1) },
+                      { TS::BottomRight, Sub(2), 0 }, { TS::BottomLeft, Add(4), Sub(4) }, { TS::BottomLeft, 0, Sub(4) }, { TS::BottomLeft, Add(4), 0 } },
+                    { 0, 1, 2, 2, 3, 4, 0, 2, 5, 2, 4, 5, 0, 5, 6, 5, 4, 7 });
+                const int right = r.Rect(TT::OutEdgeRight);
+                r.CutTop(right, curve);
+                const int top = r.Rect(TT::OutEdgeTop);
+                r.CutRight(top, curve);
+                const int corner1 = r.Rect(TT::InCornerBottomLeft);
+                r.Align(right, TS::BottomRight);
+                r.Align(corner1, TS::BottomLeft);
+                r.Align(curve, TS::TopRight);
+                r.Mesh({ top, curve, base, right, corner1 });
+                break;
+            }
+            case FloorType::TurnBottomRight:
+            {
+                const int curve = r.Poly({ TT::OutCornerTopLeft, TT::OutEdgeLeft, TT::OutEdgeTop },
+                    { TS::TopLeft, TS::TopRight, TS::BottomLeft, { TS::TopRight, 0, Add(2) }, { TS::BottomLeft, Add(1), 0 }, TS::BottomRight },
+                    { 0, 1, 3, 0, 3, 4, 0, 4, 2, 3, 5, 4 });
+                const int base = r.Poly({ TT::FullTile, TT::OutCornerTopLeft, TT::OutEdgeLeft, TT::OutEdgeTop, TT::InCornerBottomRight },
+                    { { TS::TopLeft, Add(1), Add(3) }, { TS::TopRight, 0, Add(3) }, { TS::TopLeft, Add(1), Add(1) }, { TS::TopLeft, Add(2), Add(1) },
+                      { TS::BottomLeft, Add(2), 0 }, { TS::BottomRight, Sub(4), Sub(4) }, { TS::BottomRight, 0, Sub(4) }, { TS::BottomRight, Sub(4), 0 } },
+                    { 0, 1, 2, 3, 2, 4, 1, 5, 2, 2, 5, 4, 1, 6, 5, 5, 7, 4 });
+                const int left = r.Rect(TT::OutEdgeLeft);
+                r.CutTop(left, curve);
+                const int top = r.Rect(TT::OutEdgeTop);
+                r.CutLeft(top, curve);
+                const int corner1 = r.Rect(TT::InCornerBottomRight);
+                r.Align(top, TS::TopRight);
+                r.Align(left, TS::BottomLeft);
+                r.Align(corner1, TS::BottomRight);
+                // The base is placed twice. The second copy is drawn exactly over the first.
+                r.Mesh({ curve, top, base, left, base, corner1 });
+                break;
+            }
+            case FloorType::TurnTopLeft:
+            {
+                const int curve = r.Poly({ TT::OutCornerBottomRight, TT::OutEdgeRight, TT::OutEdgeBottom },
+                    { TS::TopLeft, TS::TopRight, { TS::TopRight, Sub(1), 0 }, { TS::BottomLeft, 0, Sub(2) }, TS::BottomLeft, TS::BottomRight },
+                    { 0, 2, 3, 2, 1, 5, 2, 5, 3, 3, 5, 4 });
+                const int base = r.Poly({ TT::FullTile, TT::OutCornerBottomRight, TT::OutEdgeRight, TT::OutEdgeBottom, TT::InCornerTopLeft },
+                    { { TS::TopLeft, Add(4), 0 }, { TS::TopLeft, Add(4), Add(4) }, { TS::TopLeft, 0, Add(4) }, { TS::TopRight, Sub(2), 0 },
+                      { TS::BottomRight, Sub(1), Sub(1) }, { TS::BottomRight, Sub(2), Sub(1) }, { TS::BottomLeft, 0, Sub(3) }, { TS::BottomRight, Sub(1), Sub(3) } },
+                    { 0, 3, 1, 3, 4, 1, 3, 5, 4, 2, 1, 6, 1, 4, 6, 4, 7, 6 });
+                const int right = r.Rect(TT::OutEdgeRight);
+                r.CutBottom(right, curve);
+                const int bottom = r.Rect(TT::OutEdgeBottom);
+                r.CutRight(bottom, curve);
+                const int corner1 = r.Rect(TT::InCornerTopLeft);
+                r.Align(right, TS::TopRight);
+                r.Align(bottom, TS::BottomLeft);
+                r.Align(curve, TS::BottomRight);
+                r.Mesh({ corner1, base, right, bottom, curve });
+                break;
+            }
+            case FloorType::TurnTopRight:
+            {
+                const int curve = r.Poly({ TT::OutCornerBottomLeft, TT::OutEdgeLeft, TT::OutEdgeBottom },
+                    { TS::TopLeft, TS::TopRight, { TS::TopLeft, Add(1), 0 }, { TS::BottomRight, 0, Sub(2) }, TS::BottomLeft, TS::BottomRight },
+                    { 0, 2, 4, 2, 1, 3, 2, 3, 4, 3, 5, 4 });
+                const int base = r.Poly({ TT::FullTile, TT::OutCornerBottomLeft, TT::OutEdgeLeft, TT::OutEdgeBottom, TT::InCornerTopRight },
+                    { { TS::TopLeft, Add(2), 0 }, { TS::TopRight, Sub(4), 0 }, { TS::TopRight, Sub(4), Add(4) }, { TS::TopRight, 0, Add(4) },
+                      { TS::BottomLeft, Add(2), Sub(1) }, { TS::BottomLeft, Add(1), Sub(1) }, { TS::BottomLeft, Add(1), Sub(3) }, { TS::BottomRight, 0, Sub(3) } },
+                    { 0, 1, 2, 0, 2, 5, 0, 5, 4, 2, 3, 7, 2, 7, 5, 5, 7, 6 });
+                const int left = r.Rect(TT::OutEdgeLeft);
+                r.CutBottom(left, curve);
+                const int bottom = r.Rect(TT::OutEdgeBottom);
+                r.CutLeft(bottom, curve);
+                const int corner1 = r.Rect(TT::InCornerTopRight);
+                r.Align(corner1, TS::TopRight);
+                r.Align(curve, TS::BottomLeft);
+                r.Align(bottom, TS::BottomRight);
+                r.Mesh({ left, base, corner1, curve, bottom });
+                break;
+            }
+            case FloorType::EdgeTopRight:
+            {
+                const int curve = r.Poly({ TT::OutCornerTopRight, TT::OutEdgeRight, TT::OutEdgeTop },
+                    { TS::TopLeft, TS::TopRight, TS::BottomLeft, { TS::TopLeft, 0, Add(2) }, { TS::BottomRight, Sub(1), 0 }, TS::BottomRight },
+                    { 0, 1, 3, 1, 4, 3, 1, 5, 4, 3, 4, 2 });
+                const int base = r.Poly({ TT::FullTile, TT::OutCornerTopRight, TT::OutEdgeRight, TT::OutEdgeTop },
+                    { { TS::TopLeft, 0, Add(3) }, { TS::TopRight, Sub(1), Add(3) }, { TS::TopRight, Sub(1), Add(1) }, { TS::TopRight, Sub(2), Add(1) },
+                      TS::BottomLeft, { TS::BottomRight, Sub(2), 0 } },
+                    { 0, 1, 2, 2, 3, 5, 0, 2, 4, 2, 5, 4 });
+                const int right = r.Rect(TT::OutEdgeRight);
+                r.CutTop(right, curve);
+                const int top = r.Rect(TT::OutEdgeTop);
+                r.CutRight(top, curve);
+                r.Align(curve, TS::TopRight);
+                r.Align(right, TS::BottomRight);
+                r.Mesh({ top, curve, base, right });
+                break;
+            }
+            case FloorType::EdgeTopLeft:
+            {
+                const int curve = r.Poly({ TT::OutCornerTopLeft, TT::OutEdgeLeft, TT::OutEdgeTop },
+                    { TS::TopLeft, TS::TopRight, TS::BottomLeft, { TS::TopRight, 0, Add(2) }, { TS::BottomLeft, Add(1), 0 }, TS::BottomRight },
+                    { 0, 1, 3, 0, 3, 4, 0, 4, 2, 3, 5, 4 });
+                const int base = r.Poly({ TT::FullTile, TT::OutCornerTopLeft, TT::OutEdgeLeft, TT::OutEdgeTop },
+                    { { TS::TopLeft, Add(1), Add(3) }, { TS::TopRight, 0, Add(3) }, { TS::TopLeft, Add(1), Add(1) }, { TS::TopLeft, Add(2), Add(1) },
+                      { TS::BottomLeft, Add(2), 0 }, TS::BottomRight },
+                    { 0, 1, 2, 1, 5, 2, 3, 2, 4, 2, 5, 4 });
+                const int left = r.Rect(TT::OutEdgeLeft);
+                r.CutTop(left, curve);
+                const int top = r.Rect(TT::OutEdgeTop);
+                r.CutLeft(top, curve);
+                r.Align(top, TS::TopRight);
+                r.Mesh({ curve, top, left, base });
+                break;
+            }
+            case FloorType::EdgeBottomRight:
+            {
+                const int curve = r.Poly({ TT::OutCornerBottomRight, TT::OutEdgeRight, TT::OutEdgeBottom },
+                    { TS::TopLeft, TS::TopRight, { TS::TopRight, Sub(1), 0 }, { TS::BottomLeft, 0, Sub(2) }, TS::BottomLeft, TS::BottomRight },
+                    { 0, 2, 3, 2, 1, 5, 2, 5, 3, 3, 5, 4 });
+                const int base = r.Poly({ TT::FullTile, TT::OutCornerBottomRight, TT::OutEdgeRight, TT::OutEdgeBottom },
+                    { TS::TopLeft, { TS::TopRight, Sub(2), 0 }, { TS::BottomRight, Sub(1), Sub(1) }, { TS::BottomRight, Sub(2), Sub(1) },
+                      { TS::BottomLeft, 0, Sub(3) }, { TS::BottomRight, Sub(1), Sub(3) } },
+                    { 0, 1, 2, 1, 3, 2, 0, 2, 4, 2, 5, 4 });
+                const int right = r.Rect(TT::OutEdgeRight);
+                r.CutBottom(right, curve);
+                const int bottom = r.Rect(TT::OutEdgeBottom);
+                r.CutRight(bottom, curve);
+                r.Align(right, TS::TopRight);
+                r.Align(bottom, TS::BottomLeft);
+                r.Align(curve, TS::BottomRight);
+                r.Mesh({ base, right, bottom, curve });
+                break;
+            }
+            case FloorType::EdgeBottomLeft:
+            {
+                const int curve = r.Poly({ TT::OutCornerBottomLeft, TT::OutEdgeLeft, TT::OutEdgeBottom },
+                    { TS::TopLeft, TS::TopRight, { TS::TopLeft, Add(1), 0 }, { TS::BottomRight, 0, Sub(2) }, TS::BottomLeft, TS::BottomRight },
+                    { 0, 2, 4, 2, 1, 3, 2, 3, 4, 3, 5, 4 });
+                const int base = r.Poly({ TT::FullTile, TT::OutCornerBottomLeft, TT::OutEdgeLeft, TT::OutEdgeBottom },
+                    { { TS::TopLeft, Add(2), 0 }, TS::TopRight, { TS::BottomLeft, Add(2), Sub(1) }, { TS::BottomLeft, Add(1), Sub(1) },
+                      { TS::BottomLeft, Add(1), Sub(3) }, { TS::BottomRight, 0, Sub(3) } },
+                    { 0, 1, 3, 0, 3, 2, 1, 5, 3, 3, 5, 4 });
+                const int left = r.Rect(TT::OutEdgeLeft);
+                r.CutBottom(left, curve);
+                const int bottom = r.Rect(TT::OutEdgeBottom);
+                r.CutLeft(bottom, curve);
+                r.Align(bottom, TS::BottomRight);
+                r.Align(curve, TS::BottomLeft);
+                r.Mesh({ left, base, curve, bottom });
+                break;
+            }
+            case FloorType::VertCrossRight:
+            {
+                const int base = r.Poly({ TT::FullTile, TT::OutEdgeLeft, TT::InCornerTopRight, TT::InCornerBottomRight },
+                    { { TS::TopLeft, Add(1), 0 }, { TS::TopRight, Sub(2), 0 }, { TS::TopRight, Sub(2), Add(2) }, { TS::TopRight, 0, Add(2) },
+                      { TS::BottomRight, 0, Sub(3) }, { TS::BottomRight, Sub(3), Sub(3) }, { TS::BottomLeft, Add(1), 0 }, { TS::BottomRight, Sub(3), 0 } },
+                    { 0, 1, 2, 0, 2, 5, 0, 5, 6, 5, 7, 6, 2, 3, 5, 3, 4, 5 });
+                const int left = r.Rect(TT::OutEdgeLeft);
+                const int corner1 = r.Rect(TT::InCornerTopRight);
+                const int corner2 = r.Rect(TT::InCornerBottomRight);
+                r.Align(corner1, TS::TopRight);
+                r.Align(corner2, TS::BottomRight);
+                r.Mesh({ left, base, corner1, corner2 });
+                break;
+            }
+            case FloorType::VertCrossLeft:
+            {
+                const int base = r.Poly({ TT::FullTile, TT::OutEdgeRight, TT::InCornerTopLeft, TT::InCornerBottomLeft },
+                    { { TS::TopLeft, Add(2), 0 }, { TS::TopRight, Sub(1), 0 }, { TS::TopLeft, 0, Add(2) }, { TS::TopLeft, Add(2), Add(2) },
+                      { TS::BottomLeft, 0, Sub(3) }, { TS::BottomLeft, Add(3), Sub(3) }, { TS::BottomLeft, Add(3), 0 }, { TS::BottomRight, Sub(1), 0 } },
+                    { 2, 3, 5, 2, 5, 4, 0, 1, 3, 1, 5, 3, 1, 7, 5, 5, 7, 6 });
+                const int right = r.Rect(TT::OutEdgeRight);
+                const int corner1 = r.Rect(TT::InCornerTopLeft);
+                const int corner2 = r.Rect(TT::InCornerBottomLeft);
+                r.Align(right, TS::TopRight);
+                r.Align(corner2, TS::BottomLeft);
+                r.Mesh({ corner1, base, right, corner2 });
+                break;
+            }
+            case FloorType::HorzCrossTop:
+            {
+                const int base = r.Poly({ TT::FullTile, TT::OutEdgeBottom, TT::InCornerTopLeft, TT::InCornerTopRight },
+                    { { TS::TopLeft, Add(2), 0 }, { TS::TopRight, Sub(3), 0 }, { TS::TopLeft, 0, Add(2) }, { TS::TopLeft, Add(2), Add(2) },
+                      { TS::TopRight, Sub(3), Add(3) }, { TS::TopRight, 0, Add(3) }, { TS::BottomLeft, 0, Sub(1) }, { TS::BottomRight, 0, Sub(1) } },
+                    { 0, 1, 3, 1, 4, 3, 3, 6, 2, 4, 5, 7, 3, 4, 6, 4, 7, 6 });
+                const int bottom = r.Rect(TT::OutEdgeBottom);
+                const int corner1 = r.Rect(TT::InCornerTopLeft);
+                const int corner2 = r.Rect(TT::InCornerTopRight);
+                r.Align(corner2, TS::TopRight);
+                r.Align(bottom, TS::BottomLeft);
+                r.Mesh({ corner1, base, corner2, bottom });
+                break;
+            }
+            case FloorType::HorzCrossBottom:
+            {
+                const int base = r.Poly({ TT::FullTile, TT::OutEdgeTop, TT::InCornerBottomLeft, TT::InCornerBottomRight },
+                    { { TS::TopLeft, 0, Add(1) }, { TS::TopRight, 0, Add(1) }, { TS::BottomLeft, 0, Sub(2) }, { TS::BottomLeft, Add(2), Sub(2) },
+                      { TS::BottomRight, Sub(3), Sub(3) }, { TS::BottomRight, 0, Sub(3) }, { TS::BottomLeft, Add(2), 0 }, { TS::BottomRight, Sub(3), 0 } },
+                    { 0, 3, 2, 0, 1, 3, 1, 4, 3, 1, 5, 4, 3, 4, 7, 3, 7, 6 });
+                const int top = r.Rect(TT::OutEdgeTop);
+                const int corner1 = r.Rect(TT::InCornerBottomLeft);
+                const int corner2 = r.Rect(TT::InCornerBottomRight);
+                r.Align(corner1, TS::BottomLeft);
+                r.Align(corner2, TS::BottomRight);
+                r.Mesh({ top, base, corner1, corner2 });
+                break;
+            }
+            case FloorType::EdgeLeftCornerTopRight:
+            {
+                const int base = r.Poly({ TT::FullTile, TT::OutEdgeLeft, TT::InCornerTopRight },
+                    { { TS::TopLeft, Add(1), 0 }, { TS::TopRight, Sub(2), 0 }, { TS::TopRight, Sub(2), Add(2) }, { TS::TopRight, 0, Add(2) },
+                      { TS::BottomLeft, Add(1), 0 }, TS::BottomRight },
+                    { 0, 1, 2, 0, 2, 4, 2, 5, 4, 2, 3, 5 });
+                const int left = r.Rect(TT::OutEdgeLeft);
+                const int corner1 = r.Rect(TT::InCornerTopRight);
+                r.Align(corner1, TS::TopRight);
+                r.Mesh({ left, base, corner1 });
+                break;
+            }
+            case FloorType::EdgeLeftCornerBottomRight:
+            {
+                const int base = r.Poly({ TT::FullTile, TT::OutEdgeLeft, TT::InCornerBottomRight },
+                    { { TS::TopLeft, Add(1), 0 }, TS::TopRight, { TS::BottomLeft, Add(1), 0 }, { TS::BottomRight, Sub(2), Sub(2) },
+                      { TS::BottomRight, 0, Sub(2) }, { TS::BottomRight, Sub(2), 0 } },
+                    { 0, 1, 3, 1, 4, 3, 0, 3, 2, 3, 5, 2 });
+                const int left = r.Rect(TT::OutEdgeLeft);
+                const int corner1 = r.Rect(TT::InCornerBottomRight);
+                r.Align(corner1, TS::BottomRight);
+                r.Mesh({ left, base, corner1 });
+                break;
+            }
+            case FloorType::EdgeRightCornerTopLeft:
+            {
+                const int base = r.Poly({ TT::FullTile, TT::OutEdgeRight, TT::InCornerTopLeft },
+                    { { TS::TopLeft, Add(2), 0 }, { TS::TopRight, Sub(1), 0 }, { TS::TopLeft, 0, Add(2) }, { TS::TopLeft, Add(2), Add(2) },
+                      TS::BottomLeft, { TS::BottomRight, Sub(1), 0 } },
+                    { 0, 1, 3, 1, 5, 3, 3, 5, 4, 2, 3, 4 });
+                const int right = r.Rect(TT::OutEdgeRight);
+                const int corner1 = r.Rect(TT::InCornerTopLeft);
+                r.Align(right, TS::TopRight);
+                r.Mesh({ corner1, base, right });
+                break;
+            }
+            case FloorType::EdgeRightCornerBottomLeft:
+            {
+                const int base = r.Poly({ TT::FullTile, TT::OutEdgeRight, TT::InCornerBottomLeft },
+                    { TS::TopLeft, { TS::TopRight, Sub(1), 0 }, { TS::BottomLeft, 0, Sub(2) }, { TS::BottomLeft, Add(2), Sub(2) },
+                      { TS::BottomLeft, Add(2), 0 }, { TS::BottomRight, Sub(1), 0 } },
+                    { 0, 3, 2, 0, 1, 3, 1, 5, 3, 3, 5, 4 });
+                const int right = r.Rect(TT::OutEdgeRight);
+                const int corner1 = r.Rect(TT::InCornerBottomLeft);
+                r.Align(right, TS::TopRight);
+                r.Align(corner1, TS::BottomLeft);
+                r.Mesh({ base, right, corner1 });
+                break;
+            }
+            case FloorType::EdgeTopCornerBottomRight:
+            {
+                const int base = r.Poly({ TT::FullTile, TT::OutEdgeTop, TT::InCornerBottomRight },
+                    { { TS::TopLeft, 0, Add(1) }, { TS::TopRight, 0, Add(1) }, { TS::BottomRight, Sub(2), Sub(2) }, { TS::BottomRight, 0, Sub(2) },
+                      TS::BottomLeft, { TS::BottomRight, Sub(2), 0 } },
+                    { 0, 1, 2, 1, 3, 2, 0, 2, 4, 2, 5, 4 });
+                const int top = r.Rect(TT::OutEdgeTop);
+                const int corner1 = r.Rect(TT::InCornerBottomRight);
+                r.Align(corner1, TS::BottomRight);
+                r.Mesh({ top, base, corner1 });
+                break;
+            }
+            case FloorType::EdgeTopCornerBottomLeft:
+            {
+                const int base = r.Poly({ TT::FullTile, TT::OutEdgeTop, TT::InCornerBottomLeft },
+                    { { TS::TopLeft, 0, Add(1) }, { TS::TopRight, 0, Add(1) }, { TS::BottomLeft, 0, Sub(2) }, { TS::BottomLeft, Add(2), Sub(2) },
+                      { TS::BottomLeft, Add(2), 0 }, TS::BottomRight },
+                    { 0, 3, 2, 0, 1, 3, 1, 5, 3, 3, 5, 4 });
+                const int top = r.Rect(TT::OutEdgeTop);
+                const int corner1 = r.Rect(TT::InCornerBottomLeft);
+                r.Align(corner1, TS::BottomLeft);
+                r.Mesh({ top, base, corner1 });
+                break;
+            }
+            case FloorType::EdgeBottomCornerTopRight:
+            {
+                const int base = r.Poly({ TT::FullTile, TT::OutEdgeBottom, TT::InCornerTopRight },
+                    { TS::TopLeft, { TS::TopRight, Sub(2), 0 }, { TS::TopRight, Sub(2), Add(2) }, { TS::TopRight, 0, Add(2) },
+                      { TS::BottomLeft, 0, Sub(1) }, { TS::BottomRight, 0, Sub(1) } },
+                    { 0, 1, 2, 0, 2, 4, 2, 3, 5, 2, 5, 4 });
+                const int bottom = r.Rect(TT::OutEdgeBottom);
+                const int corner1 = r.Rect(TT::InCornerTopRight);
+                r.Align(bottom, TS::BottomLeft);
+                r.Align(corner1, TS::TopRight);
+                r.Mesh({ base, corner1, bottom });
+                break;
+            }
+            case FloorType::EdgeBottomCornerTopLeft:
+            {
+                const int base = r.Poly({ TT::FullTile, TT::OutEdgeBottom, TT::InCornerTopLeft },
+                    { { TS::TopLeft, Add(2), 0 }, TS::TopRight, { TS::TopLeft, 0, Add(2) }, { TS::TopLeft, Add(2), Add(2) },
+                      { TS::BottomLeft, 0, Sub(1) }, { TS::BottomRight, 0, Sub(1) } },
+                    { 0, 1, 3, 2, 3, 4, 1, 5, 3, 3, 5, 4 });
+                const int bottom = r.Rect(TT::OutEdgeBottom);
+                const int corner1 = r.Rect(TT::InCornerTopLeft);
+                r.Align(bottom, TS::BottomLeft);
+                r.Mesh({ corner1, base, bottom });
+                break;
+            }
+            case FloorType::CornerExceptTopLeft:
+            {
+                const int base = r.Poly({ TT::FullTile, TT::InCornerTopRight, TT::InCornerBottomLeft, TT::InCornerBottomRight },
+                    { TS::TopLeft, { TS::TopRight, Sub(1), 0 }, { TS::TopRight, Sub(1), Add(1) }, { TS::TopRight, 0, Add(1) },
+                      { TS::BottomLeft, 0, Sub(2) }, { TS::BottomLeft, Add(2), Sub(2) }, { TS::BottomLeft, Add(2), 0 }, { TS::BottomRight, Sub(3), 0 },
+                      { TS::BottomRight, Sub(3), Sub(3) }, { TS::BottomRight, 0, Sub(3) } },
+                    { 0, 1, 2, 0, 2, 8, 0, 8, 5, 0, 5, 4, 2, 3, 9, 2, 9, 8, 5, 8, 7, 5, 7, 6 });
+                const int corner1 = r.Rect(TT::InCornerTopRight);
+                const int corner2 = r.Rect(TT::InCornerBottomLeft);
+                const int corner3 = r.Rect(TT::InCornerBottomRight);
+                r.Align(corner1, TS::TopRight);
+                r.Align(corner2, TS::BottomLeft);
+                r.Align(corner3, TS::BottomRight);
+                r.Mesh({ base, corner1, corner2, corner3 });
+                break;
+            }
+            case FloorType::CornerExceptTopRight:
+            {
+                const int base = r.Poly({ TT::FullTile, TT::InCornerTopLeft, TT::InCornerBottomLeft, TT::InCornerBottomRight },
+                    { { TS::TopLeft, Add(1), 0 }, TS::TopRight, { TS::TopLeft, 0, Add(1) }, { TS::TopLeft, Add(1), Add(1) },
+                      { TS::BottomLeft, 0, Sub(2) }, { TS::BottomLeft, Add(2), Sub(2) }, { TS::BottomLeft, Add(2), 0 }, { TS::BottomRight, Sub(3), 0 },
+                      { TS::BottomRight, Sub(3), Sub(3) }, { TS::BottomRight, 0, Sub(3) } },
+                    { 0, 1, 3, 2, 3, 4, 3, 5, 4, 1, 5, 3, 1, 8, 5, 1, 9, 8, 5, 8, 6, 8, 7, 6 });
+                const int corner1 = r.Rect(TT::InCornerTopLeft);
+                const int corner2 = r.Rect(TT::InCornerBottomLeft);
+                const int corner3 = r.Rect(TT::InCornerBottomRight);
+                r.Align(corner2, TS::BottomLeft);
+                r.Align(corner3, TS::BottomRight);
+                r.Mesh({ corner1, base, corner2, corner3 });
+                break;
+            }
+            case FloorType::CornerExceptBottomLeft:
+            {
+                const int base = r.Poly({ TT::FullTile, TT::InCornerTopLeft, TT::InCornerTopRight, TT::InCornerBottomRight },
+                    { { TS::TopLeft, Add(1), 0 }, { TS::TopRight, Sub(2), 0 }, { TS::TopLeft, 0, Add(1) }, { TS::TopLeft, Add(1), Add(1) },
+                      { TS::TopRight, Sub(2), Add(1) }, { TS::TopRight, 0, Add(2) }, TS::BottomLeft, { TS::BottomRight, Sub(3), 0 },
+                      { TS::BottomRight, Sub(3), Sub(3) }, { TS::BottomRight, 0, Sub(3) } },
+                    { 0, 1, 3, 1, 4, 3, 2, 3, 6, 3, 4, 6, 4, 8, 6, 8, 7, 6, 4, 5, 8, 5, 9, 8 });
+                const int corner1 = r.Rect(TT::InCornerTopLeft);
+                const int corner2 = r.Rect(TT::InCornerTopRight);
+                const int corner3 = r.Rect(TT::InCornerBottomRight);
+                r.Align(corner2, TS::TopRight);
+                r.Align(corner3, TS::BottomRight);
+                r.Mesh({ corner1, base, corner2, corner3 });
+                break;
+            }
+            case FloorType::CornerExceptBottomRight:
+            {
+                const int base = r.Poly({ TT::FullTile, TT::InCornerTopLeft, TT::InCornerTopRight, TT::InCornerBottomLeft },
+                    { { TS::TopLeft, Add(1), 0 }, { TS::TopRight, Sub(2), 0 }, { TS::TopLeft, 0, Add(1) }, { TS::TopLeft, Add(1), Add(1) },
+                      { TS::TopRight, Sub(2), Add(2) }, { TS::TopRight, 0, Add(2) }, { TS::BottomLeft, 0, Sub(3) }, { TS::BottomLeft, Add(3), Sub(3) },
+                      { TS::BottomLeft, Add(3), 0 }, TS::BottomRight },
+                    { 0, 1, 4, 0, 4, 3, 2, 3, 7, 2, 7, 6, 3, 4, 9, 4, 5, 9, 3, 9, 7, 7, 9, 8 });
+                const int corner1 = r.Rect(TT::InCornerTopLeft);
+                const int corner2 = r.Rect(TT::InCornerTopRight);
+                const int corner3 = r.Rect(TT::InCornerBottomLeft);
+                r.Align(corner2, TS::TopRight);
+                r.Align(corner3, TS::BottomLeft);
+                r.Mesh({ corner1, base, corner2, corner3 });
+                break;
+            }
+            case FloorType::CornerAll:
+            {
+                const int base = r.Poly({ TT::FullTile, TT::InCornerTopLeft, TT::InCornerTopRight, TT::InCornerBottomLeft, TT::InCornerBottomRight },
+                    { { TS::TopLeft, Add(1), 0 }, { TS::TopRight, Sub(2), 0 }, { TS::TopLeft, 0, Add(1) }, { TS::TopLeft, Add(1), Add(1) },
+                      { TS::TopRight, Sub(2), Add(2) }, { TS::TopRight, 0, Add(2) }, { TS::BottomLeft, 0, Sub(3) }, { TS::BottomLeft, Add(3), Sub(3) },
+                      { TS::BottomLeft, Add(3), 0 }, { TS::BottomRight, Sub(4), 0 }, { TS::BottomRight, Sub(4), Sub(4) }, { TS::BottomRight, 0, Sub(4) } },
+                    { 0, 1, 3, 1, 4, 3, 2, 3, 6, 3, 7, 6, 4, 5, 10, 5, 11, 10, 3, 4, 7, 4, 10, 7, 7, 10, 8, 10, 9, 8 });
+                const int corner1 = r.Rect(TT::InCornerTopLeft);
+                const int corner2 = r.Rect(TT::InCornerTopRight);
+                const int corner3 = r.Rect(TT::InCornerBottomLeft);
+                const int corner4 = r.Rect(TT::InCornerBottomRight);
+                r.Align(corner2, TS::TopRight);
+                r.Align(corner3, TS::BottomLeft);
+                r.Align(corner4, TS::BottomRight);
+                r.Mesh({ corner1, base, corner2, corner3, corner4 });
+                break;
+            }
+            case FloorType::CornerBothTop:
+            {
+                const int base = r.Poly({ TT::FullTile, TT::InCornerTopLeft, TT::InCornerTopRight },
+                    { { TS::TopLeft, Add(1), 0 }, { TS::TopRight, Sub(2), 0 }, { TS::TopLeft, 0, Add(1) }, { TS::TopLeft, Add(1), Add(1) },
+                      { TS::TopRight, Sub(2), Add(2) }, { TS::TopRight, 0, Add(2) }, TS::BottomLeft, TS::BottomRight },
+                    { 0, 1, 4, 0, 4, 3, 2, 3, 6, 3, 7, 6, 3, 4, 7, 4, 5, 7 });
+                const int corner1 = r.Rect(TT::InCornerTopLeft);
+                const int corner2 = r.Rect(TT::InCornerTopRight);
+                r.Align(corner2, TS::TopRight);
+                r.Mesh({ corner1, base, corner2 });
+                break;
+            }
+            case FloorType::CornerBothRight:
+            {
+                const int base = r.Poly({ TT::FullTile, TT::InCornerTopRight, TT::InCornerBottomRight },
+                    { TS::TopLeft, { TS::TopRight, Sub(1), 0 }, { TS::TopRight, Sub(1), Add(1) }, { TS::TopRight, 0, Add(1) },
+                      TS::BottomLeft, { TS::BottomRight, Sub(2), 0 }, { TS::BottomRight, Sub(2), Sub(2) }, { TS::BottomRight, 0, Sub(2) } },
+                    { 0, 1, 2, 0, 2, 4, 2, 6, 4, 6, 5, 4, 2, 3, 6, 3, 7, 6 });
+                const int corner1 = r.Rect(TT::InCornerTopRight);
+                const int corner2 = r.Rect(TT::InCornerBottomRight);
+                r.Align(corner1, TS::TopRight);
+                r.Align(corner2, TS::BottomRight);
+                r.Mesh({ base, corner1, corner2 });
+                break;
+            }
+            case FloorType::CornerBothBottom:
+            {
+                const int base = r.Poly({ TT::FullTile, TT::InCornerBottomLeft, TT::InCornerBottomRight },
+                    { TS::TopLeft, TS::TopRight, { TS::BottomLeft, 0, Sub(1) }, { TS::BottomLeft, Add(1), Sub(1) },
+                      { TS::BottomLeft, Add(1), 0 }, { TS::BottomRight, Sub(2), 0 }, { TS::BottomRight, Sub(2), Sub(2) }, { TS::BottomRight, 0, Sub(2) } },
+                    { 0, 3, 2, 0, 6, 3, 0, 1, 6, 1, 7, 6, 3, 6, 5, 3, 5, 4 });
+                const int corner1 = r.Rect(TT::InCornerBottomLeft);
+                const int corner2 = r.Rect(TT::InCornerBottomRight);
+                r.Align(corner1, TS::BottomLeft);
+                r.Align(corner2, TS::BottomRight);
+                r.Mesh({ base, corner1, corner2 });
+                break;
+            }
+            case FloorType::CornerBothLeft:
+            {
+                const int base = r.Poly({ TT::FullTile, TT::InCornerTopLeft, TT::InCornerBottomLeft },
+                    { { TS::TopLeft, Add(1), 0 }, TS::TopRight, { TS::TopLeft, 0, Add(1) }, { TS::TopLeft, Add(1), Add(1) },
+                      { TS::BottomLeft, 0, Sub(2) }, { TS::BottomLeft, Add(2), Sub(2) }, { TS::BottomLeft, Add(2), 0 }, TS::BottomRight },
+                    { 0, 1, 3, 2, 3, 4, 3, 5, 4, 1, 5, 3, 1, 7, 5, 5, 7, 6 });
+                const int corner1 = r.Rect(TT::InCornerTopLeft);
+                const int corner2 = r.Rect(TT::InCornerBottomLeft);
+                r.Align(corner2, TS::BottomLeft);
+                r.Mesh({ corner1, base, corner2 });
+                break;
+            }
+            case FloorType::CornerTopLeftBottomRight:
+            {
+                const int base = r.Poly({ TT::FullTile, TT::InCornerTopLeft, TT::InCornerBottomRight },
+                    { { TS::TopLeft, Add(1), 0 }, TS::TopRight, { TS::TopLeft, 0, Add(1) }, { TS::TopLeft, Add(1), Add(1) },
+                      TS::BottomLeft, { TS::BottomRight, Sub(2), 0 }, { TS::BottomRight, Sub(2), Sub(2) }, { TS::BottomRight, 0, Sub(2) } },
+                    { 0, 1, 3, 2, 3, 4, 1, 6, 3, 1, 7, 6, 3, 6, 4, 6, 5, 4 });
+                const int corner1 = r.Rect(TT::InCornerTopLeft);
+                const int corner2 = r.Rect(TT::InCornerBottomRight);
+                r.Align(corner2, TS::BottomRight);
+                r.Mesh({ corner1, base, corner2 });
+                break;
+            }
+            case FloorType::CornerTopRightBottomLeft:
+            {
+                const int base = r.Poly({ TT::FullTile, TT::InCornerTopRight, TT::InCornerBottomLeft },
+                    { TS::TopLeft, { TS::TopRight, Sub(1), 0 }, { TS::TopRight, Sub(1), Add(1) }, { TS::TopRight, 0, Add(1) },
+                      { TS::BottomLeft, 0, Sub(2) }, { TS::BottomLeft, Add(2), Sub(2) }, { TS::BottomLeft, Add(2), 0 }, TS::BottomRight },
+                    { 0, 1, 2, 0, 2, 5, 0, 5, 4, 2, 3, 7, 2, 7, 5, 5, 7, 6 });
+                const int corner1 = r.Rect(TT::InCornerTopRight);
+                const int corner2 = r.Rect(TT::InCornerBottomLeft);
+                r.Align(corner1, TS::TopRight);
+                r.Align(corner2, TS::BottomLeft);
+                r.Mesh({ base, corner1, corner2 });
+                break;
+            }
+            case FloorType::OnlyCornerTopRight:
+            {
+                const int base = r.Poly({ TT::FullTile, TT::InCornerTopRight },
+                    { TS::TopLeft, { TS::TopRight, Sub(1), 0 }, { TS::TopRight, Sub(1), Add(1) }, { TS::TopRight, 0, Add(1) }, TS::BottomLeft, TS::BottomRight },
+                    { 0, 1, 2, 0, 2, 4, 2, 3, 5, 2, 5, 4 });
+                const int corner1 = r.Rect(TT::InCornerTopRight);
+                r.Align(corner1, TS::TopRight);
+                r.Mesh({ base, corner1 });
+                break;
+            }
+            case FloorType::OnlyCornerTopLeft:
+            {
+                const int base = r.Poly({ TT::FullTile, TT::InCornerTopLeft },
+                    { { TS::TopLeft, Add(1), 0 }, TS::TopRight, { TS::TopLeft, 0, Add(1) }, { TS::TopLeft, Add(1), Add(1) }, TS::BottomLeft, TS::BottomRight },
+                    { 0, 1, 3, 2, 3, 4, 1, 5, 3, 3, 5, 4 });
+                const int corner1 = r.Rect(TT::InCornerTopLeft);
+                r.Mesh({ corner1, base });
+                break;
+            }
+            case FloorType::OnlyCornerBottomRight:
+            {
+                const int base = r.Poly({ TT::FullTile, TT::InCornerBottomRight },
+                    { TS::TopLeft, TS::TopRight, TS::BottomLeft, { TS::BottomRight, Sub(1), 0 }, { TS::BottomRight, Sub(1), Sub(1) }, { TS::BottomRight, 0, Sub(1) } },
+                    { 1, 5, 4, 0, 1, 4, 0, 4, 2, 4, 3, 2 });
+                const int corner1 = r.Rect(TT::InCornerBottomRight);
+                r.Align(corner1, TS::BottomRight);
+                r.Mesh({ base, corner1 });
+                break;
+            }
+            case FloorType::OnlyCornerBottomLeft:
+            {
+                const int base = r.Poly({ TT::FullTile, TT::InCornerBottomLeft },
+                    { TS::TopLeft, TS::TopRight, { TS::BottomLeft, 0, Sub(1) }, { TS::BottomLeft, Add(1), Sub(1) }, { TS::BottomLeft, Add(1), 0 }, TS::BottomRight },
+                    { 0, 3, 2, 0, 1, 3, 1, 5, 3, 3, 5, 4 });
+                const int corner1 = r.Rect(TT::InCornerBottomLeft);
+                r.Align(corner1, TS::BottomLeft);
+                r.Mesh({ base, corner1 });
+                break;
+            }
+            case FloorType::IsolatedTile:
+            {
+                const int base = r.Poly({ TT::FullTile, TT::OutSharpCornerTopLeft, TT::OutSharpCornerTopRight, TT::OutSharpCornerBottomLeft, TT::OutSharpCornerBottomRight },
+                    { { TS::TopLeft, Add(1), Add(1) }, { TS::TopRight, Sub(2), Add(2) }, { TS::BottomLeft, Add(3), Sub(3) }, { TS::BottomRight, Sub(4), Sub(4) } },
+                    { 0, 1, 3, 0, 3, 2 });
+                const int corner1 = r.Rect(TT::OutSharpCornerTopLeft);
+                const int corner2 = r.Rect(TT::OutSharpCornerTopRight);
+                const int corner3 = r.Rect(TT::OutSharpCornerBottomLeft);
+                const int corner4 = r.Rect(TT::OutSharpCornerBottomRight);
+                const int top = r.Rect(TT::OutEdgeTop);
+                r.CutLeft(top, corner1);
+                r.CutRight(top, corner2);
+                const int left = r.Rect(TT::OutEdgeLeft);
+                r.CutTop(left, corner1);
+                r.CutBottom(left, corner3);
+                const int bottom = r.Rect(TT::OutEdgeBottom);
+                r.CutLeft(bottom, corner3);
+                r.CutRight(bottom, corner4);
+                const int right = r.Rect(TT::OutEdgeRight);
+                r.CutTop(right, corner2);
+                r.CutBottom(right, corner4);
+                r.Align(top, TS::Top);
+                r.Align(corner2, TS::TopRight);
+                r.Align(left, TS::Left);
+                r.Align(right, TS::Right);
+                r.Align(corner3, TS::BottomLeft);
+                r.Align(bottom, TS::Bottom);
+                r.Align(corner4, TS::BottomRight);
+                r.Mesh({ corner1, top, corner2, left, base, right, corner3, bottom, corner4 });
+                break;
+            }
+            case FloorType::DeadendLeft:
+            {
+                const int base = r.Poly({ TT::FullTile, TT::OutEdgeTop, TT::OutEdgeBottom, TT::OutSharpCornerTopLeft, TT::OutSharpCornerBottomLeft },
+                    { { TS::TopLeft, Add(3), Add(3) }, { TS::TopRight, 0, Add(1) }, { TS::BottomLeft, Add(4), Sub(4) }, { TS::BottomRight, 0, Sub(2) } },
+                    { 0, 1, 3, 0, 3, 2 });
+                const int corner1 = r.Rect(TT::OutSharpCornerTopLeft);
+                const int corner2 = r.Rect(TT::OutSharpCornerBottomLeft);
+                const int top = r.Rect(TT::OutEdgeTop);
+                r.CutLeft(top, corner1);
+                const int left = r.Rect(TT::OutEdgeLeft);
+                r.CutTop(left, corner1);
+                r.CutBottom(left, corner2);
+                const int bottom = r.Rect(TT::OutEdgeBottom);
+                r.CutLeft(bottom, corner2);
+                r.Align(top, TS::Top);
+                r.Align(left, TS::Left);
+                r.Align(corner2, TS::BottomLeft);
+                r.Align(bottom, TS::Bottom);
+                r.Mesh({ corner1, top, left, base, corner2, bottom });
+                break;
+            }
+            case FloorType::DeadendTop:
+            {
+                const int base = r.Poly({ TT::FullTile, TT::OutEdgeLeft, TT::OutEdgeRight, TT::OutSharpCornerTopLeft, TT::OutSharpCornerTopRight },
+                    { { TS::TopLeft, Add(3), Add(3) }, { TS::TopRight, Sub(4), Add(4) }, { TS::BottomLeft, Add(1), 0 }, { TS::BottomRight, Sub(2), 0 } },
+                    { 0, 1, 3, 0, 3, 2 });
+                const int corner1 = r.Rect(TT::OutSharpCornerTopLeft);
+                const int corner2 = r.Rect(TT::OutSharpCornerTopRight);
+                const int top = r.Rect(TT::OutEdgeTop);
+                r.CutLeft(top, corner1);
+                r.CutRight(top, corner2);
+                const int left = r.Rect(TT::OutEdgeLeft);
+                r.CutTop(left, corner1);
+                const int right = r.Rect(TT::OutEdgeRight);
+                r.CutTop(right, corner2);
+                r.Align(top, TS::Top);
+                r.Align(corner2, TS::TopRight);
+                r.Align(left, TS::Left);
+                r.Align(right, TS::Right);
+                r.Mesh({ corner1, top, corner2, left, base, right });
+                break;
+            }
+            case FloorType::DeadendRight:
+            {
+                const int base = r.Poly({ TT::FullTile, TT::OutEdgeTop, TT::OutEdgeBottom, TT::OutSharpCornerTopRight, TT::OutSharpCornerBottomRight },
+                    { { TS::TopLeft, 0, Add(1) }, { TS::TopRight, Sub(3), Add(3) }, { TS::BottomLeft, 0, Sub(2) }, { TS::BottomRight, Sub(4), Sub(4) } },
+                    { 0, 1, 3, 0, 3, 2 });
+                const int corner1 = r.Rect(TT::OutSharpCornerTopRight);
+                const int corner2 = r.Rect(TT::OutSharpCornerBottomRight);
+                const int top = r.Rect(TT::OutEdgeTop);
+                r.CutRight(top, corner1);
+                const int right = r.Rect(TT::OutEdgeRight);
+                r.CutTop(right, corner1);
+                // Both sharp corners have the same size, so either can trim the bottom.
+                r.CutBottom(right, corner1);
+                const int bottom = r.Rect(TT::OutEdgeBottom);
+                r.CutRight(bottom, corner2);
+                r.Align(top, TS::TopLeft);
+                r.Align(corner1, TS::TopRight);
+                r.Align(right, TS::Right);
+                r.Align(bottom, TS::BottomLeft);
+                r.Align(corner2, TS::BottomRight);
+                r.Mesh({ top, corner1, base, right, bottom, corner2 });
+                break;
+            }
+            case FloorType::DeadendBottom:
+            {
+                const int base = r.Poly({ TT::FullTile, TT::OutEdgeLeft, TT::OutEdgeRight, TT::OutSharpCornerBottomLeft, TT::OutSharpCornerBottomRight },
+                    { { TS::TopLeft, Add(1), 0 }, { TS::TopRight, Sub(2), 0 }, { TS::BottomLeft, Add(3), Sub(3) }, { TS::BottomRight, Sub(4), Sub(4) } },
+                    { 0, 1, 3, 0, 3, 2 });
+                const int corner1 = r.Rect(TT::OutSharpCornerBottomLeft);
+                const int corner2 = r.Rect(TT::OutSharpCornerBottomRight);
+                const int bottom = r.Rect(TT::OutEdgeBottom);
+                r.CutLeft(bottom, corner1);
+                r.CutRight(bottom, corner2);
+                const int left = r.Rect(TT::OutEdgeLeft);
+                r.CutBottom(left, corner1);
+                const int right = r.Rect(TT::OutEdgeRight);
+                r.CutBottom(right, corner2);
+                r.Align(left, TS::TopLeft);
+                r.Align(right, TS::TopRight);
+                r.Align(corner1, TS::BottomLeft);
+                r.Align(bottom, TS::Bottom);
+                r.Align(corner2, TS::BottomRight);
+                r.Mesh({ left, base, right, corner1, bottom, corner2 });
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    struct FloorMeshTable
+    {
+        FloorMesh meshes[FLOOR_GROUP_COUNT][FLOOR_TYPE_COUNT] = {};
+    };
+
+    // Every floor type is baked for every group that has all the textures it needs.
+    constexpr FloorMeshTable BuildFloorMeshTable()
+    {
+        FloorMeshTable table;
+        for (int group = 0; group < FLOOR_GROUP_COUNT; ++group)
+        {
+            for (int floor_type = 0; floor_type < FLOOR_TYPE_COUNT; ++floor_type)
+            {
+                FloorRecipe recipe((FloorGroup)group);
+                BuildFloorRecipe(recipe, (FloorType)floor_type);
+                if (!recipe.missing)
+                    table.meshes[group][floor_type] = recipe.mesh;
+            }
+        }
+        return table;
+    }
+
+    // Built at compile time. A recipe that reads past its arrays fails the build here.
+    constexpr FloorMeshTable floor_meshes = BuildFloorMeshTable();
+    static_assert(floor_meshes.meshes[(int)FloorGroup::WalkwayOnGrass][(int)FloorType::HorzLane].vert_count > 0, "Walkway lanes have a mesh.");
+    static_assert(floor_meshes.meshes[(int)FloorGroup::Grass][(int)FloorType::FullTile].vert_count > 0, "Grass has a full tile mesh.");
+}
 
 
 TileGenerator::TileGenerator(const SpawnParams& params)
@@ -105,27 +1022,34 @@ void TileGenerator::OnDestroy()
 
 void TileGenerator::BuildInstances()
 {
-    for (const auto &data : floor_gen_data)
-    {
-        FloorGroup group = data.first;
+    const TexRect &full_tile = floor_uv_data.rects[(int)FloorGroup::WalkwayOnGrass][(int)TexType::FullTile];
+    if (tile_size.X != full_tile.width || tile_size.Y != full_tile.height)
+        DebugLog::LogError(TEXT("The tile size doesn't match the baked floor geometry. Floor tiles will have gaps or overlaps."));
 
+    Array<Float3> verts;
+    Array<Float2> uvs;
+    Array<uint32> indexes;
+    Array<Float3> normals;
+    for (int group = 0; group < FLOOR_GROUP_COUNT; ++group)
+    {
         std::map<FloorType, KeepAlive<Model>> models;
-        for (FloorType floorType : data.second)
+        for (int floor_type = 0; floor_type < FLOOR_TYPE_COUNT; ++floor_type)
         {
-            Array<Float3> verts;
-            Array<Float2> uvs;
-            Array<uint32> indexes;
-            Array<Float3> normals;
-            GetInstanceData(group, floorType, verts, indexes, uvs, normals);
+            const FloorMesh &mesh = floor_meshes.meshes[group][floor_type];
+            if (mesh.vert_count == 0)
+                continue;
+
+            GetInstanceData((FloorGroup)group, (FloorType)floor_type, verts, indexes, uvs, normals);
 
             Model *new_model = Content::CreateVirtualAsset<Model>();
             int32 tmp = 1;
             new_model->SetupLODs(Span<int32>(&tmp, 1));
-            new_model->LODs[0].Meshes[0].UpdateMesh((uint32)verts.Count(), (uint32)(indexes.Count() / 3), (Float3*)verts.Get(), indexes.Get(), normals.Get(), (Float3*)nullptr, uvs.Get(), (Color32*)nullptr);
+            new_model->LODs[0].Meshes[0].UpdateMesh((uint32)mesh.vert_count, (uint32)(mesh.index_count / 3), verts.Get(), mesh.indexes, normals.Get(), (Float3*)nullptr, uvs.Get(), (Color32*)nullptr);
 
-            models[floorType] = std::move(KeepAlive<Model>(new_model));
+            models[(FloorType)floor_type] = std::move(KeepAlive<Model>(new_model));
         }
-        floor_models[group] = std::move(models);
+        if (!models.empty())
+            floor_models[(FloorGroup)group] = std::move(models);
     }
 }
 
@@ -476,6 +1400,23 @@ void DownloadVertexBuffers(const Mesh &mesh, VertexBuffers &buffers)
     }
 }
 
+namespace
+{
+    // Kinds of generated models in the model cache.
+    constexpr uint32 ROW_MODEL = 1;
+    constexpr uint32 COMPOUND_MODEL = 2;
+
+    void CopyMaterialSlots(const Model *from, Model *to, int first_slot)
+    {
+        for (int six = 0, ssiz = from->GetMaterialSlotsCount(); six < ssiz; ++six)
+        {
+            to->MaterialSlots[six + first_slot].Material = from->MaterialSlots[six].Material;
+            to->MaterialSlots[six + first_slot].Name = from->MaterialSlots[six].Name;
+            to->MaterialSlots[six + first_slot].ShadowsMode = from->MaterialSlots[six].ShadowsMode;
+        }
+    }
+}
+
 Model* TileGenerator::CreateRowOfModel(const Model *model, int columns, int rows, float offsetX, float offsetZ)
 {
     if (model == nullptr || columns <= 0 || rows <= 0)
@@ -496,9 +1437,23 @@ Model* TileGenerator::CreateRowOfModel(const Model *model, int columns, int rows
         lod_meshes[lix] = model->LODs[lix].Meshes.Count();
     }
 
+    // The copies are cached by the source model and everything that places them.
+    ModelCache::Key key(ROW_MODEL);
+    const bool cacheable = key.AddModel(model);
+    key.Add(columns);
+    key.Add(rows);
+    key.Add(offsetX);
+    key.Add(offsetZ);
+    if (Model *cached = cacheable ? ModelCache::Load(key) : nullptr)
+    {
+        CopyMaterialSlots(model, cached, 0);
+        return cached;
+    }
+
     Model *new_model = Content::CreateVirtualAsset<Model>();
     new_model->SetupLODs(Span<int32>(lod_meshes.Get(), lod_meshes.Count()));
     new_model->SetupMaterialSlots(model->GetMaterialSlotsCount());
+    ModelCache cache(key, lod_meshes, model->GetMaterialSlotsCount());
 
     for (int lix = 0, lsiz = model->LODs.Count(); lix < lsiz; ++lix)
     {
@@ -553,15 +1508,14 @@ Model* TileGenerator::CreateRowOfModel(const Model *model, int columns, int rows
 
             new_model->LODs[lix].Meshes[mix].UpdateMesh((uint32)verts.Count(), (uint32)(indexes.Count() / 3), (Float3*)verts.Get(), indexes.Get(), normals.Get(), (Float3*)nullptr, uvs.Get(), (Color32*)nullptr/*colors.Get()*/);
             new_model->LODs[lix].Meshes[mix].SetMaterialSlotIndex(buffers.material_slot);
-        }
-        for (int six = 0, ssiz = model->GetMaterialSlotsCount(); six < ssiz; ++six)
-        {
-            new_model->MaterialSlots[six].Material = model->MaterialSlots[six].Material;
-            new_model->MaterialSlots[six].Name = model->MaterialSlots[six].Name;
-            new_model->MaterialSlots[six].ShadowsMode = model->MaterialSlots[six].ShadowsMode;
+            if (cacheable)
+                cache.AddMesh(lix, mix, buffers.material_slot, verts, normals, uvs, indexes);
         }
     }
+    CopyMaterialSlots(model, new_model, 0);
 
+    if (cacheable && !cache.Save())
+        DebugLog::LogWarning(TEXT("Couldn't write the generated model to the model cache."));
     return new_model;
 }
 
@@ -615,9 +1569,32 @@ Model* TileGenerator::CreateCompoundModel(const Array<Model*> &models, const Arr
         }
     }
 
+    // Cached by every source model, and which of them is placed where.
+    ModelCache::Key key(COMPOUND_MODEL);
+    bool cacheable = true;
+    for (Model *m : models)
+        cacheable = key.AddModel(m) && cacheable;
+    key.Add(models.Count());
+    for (int ix = 0, siz = model_indexes.Count(); ix < siz; ++ix)
+    {
+        key.Add(model_indexes[ix]);
+        key.Add(model_positions[ix]);
+    }
+    if (Model *cached = cacheable ? ModelCache::Load(key) : nullptr)
+    {
+        int slot = 0;
+        for (Model *m : models)
+        {
+            CopyMaterialSlots(m, cached, slot);
+            slot += m->GetMaterialSlotsCount();
+        }
+        return cached;
+    }
+
     Model *new_model = Content::CreateVirtualAsset<Model>();
     new_model->SetupLODs(Span<int>(lod_meshes.Get(), lod_meshes.Count()));
     new_model->SetupMaterialSlots(mat_count);
+    ModelCache cache(key, lod_meshes, mat_count);
 
     Array<int> uses;
     uses.AddZeroed(model_indexes.Count());
@@ -693,1644 +1670,40 @@ Model* TileGenerator::CreateCompoundModel(const Array<Model*> &models, const Arr
 
                 new_model->LODs[lix].Meshes[meshix + skipped_mesh_cnt].UpdateMesh((uint32)verts.Count(), (uint32)(indexes.Count() / 3), (Float3*)verts.Get(), indexes.Get(), normals.Get(), (Float3*)nullptr, uvs.Get(), (Color32*)nullptr/*colors.Get()*/);
                 new_model->LODs[lix].Meshes[meshix + skipped_mesh_cnt].SetMaterialSlotIndex(buffers.material_slot + skippedSlotCount);
-
+                if (cacheable)
+                    cache.AddMesh(lix, meshix + skipped_mesh_cnt, buffers.material_slot + skippedSlotCount, verts, normals, uvs, indexes);
             }
 
-            for (int six = 0, ssiz = m->GetMaterialSlotsCount(); six < ssiz; ++six)
-            {
-                new_model->MaterialSlots[six + skippedSlotCount].Material = m->MaterialSlots[six].Material;
-                new_model->MaterialSlots[six + skippedSlotCount].Name = m->MaterialSlots[six].Name;
-                new_model->MaterialSlots[six + skippedSlotCount].ShadowsMode = m->MaterialSlots[six].ShadowsMode;
-            }
+            CopyMaterialSlots(m, new_model, skippedSlotCount);
             skippedSlotCount += models[mix]->GetMaterialSlotsCount();
             skipped_mesh_cnt += models[mix]->LODs[lix].Meshes.Count();
         }
     }
 
+    if (cacheable && !cache.Save())
+        DebugLog::LogWarning(TEXT("Couldn't write the generated model to the model cache."));
     return new_model;
 
 }
 
 
-void TileGenerator::GetInstanceData(FloorGroup group, FloorType floor_type, Array<Float3> &verts, Array<uint32> &indexes, Array<Float2> &uvs, Array<Float3> &normals)
+void TileGenerator::GetInstanceData(FloorGroup group, FloorType floor_type, Array<Float3> &verts, Array<uint32> &indexes, Array<Float2> &uvs, Array<Float3> &normals) const
 {
-    TileRectDataCollection data;
-    TileRectData data_base;
-    TileRectData data_top;
-    TileRectData data_bottom;
-    TileRectData data_left;
-    TileRectData data_right;
-    TileRectData curve_data;
-    TileRectData data_corner1;
-    TileRectData data_corner2;
-    TileRectData data_corner3;
-    TileRectData data_corner4;
-
-    switch (floor_type)
-    {
-        case FloorType::FullTile:
-        {
-            verts = {
-                Float3(0.0f, 0.0f, 0.0f),
-                Float3(ScriptGlobals::tile_dimension, 0.0f, 0.0f),
-                Float3(0.0f, 0.0f, ScriptGlobals::tile_dimension),
-                Float3(ScriptGlobals::tile_dimension, 0.0f, ScriptGlobals::tile_dimension)
-            };
-
-            BuildUVArrayFromData(group, TexType::FullTile, uvs);
-            indexes = { 0, 1, 2, 1, 3, 2 };
-            break;
-        }
-        case FloorType::HorzLane:
-        {
-            BuildRectData(group, TexType::OutEdgeTop, data_top);
-            BuildRectData(group, TexType::OutEdgeBottom, data_bottom);
-            BuildRectData(group, TexType::FullTile, data_base);
-            data.top = &data_top;
-            data.bottom = &data_bottom;
-            AdjustRectData(data_base, data);
-            data_bottom.side = TileSide::Bottom;
-            BuildMeshData(verts, uvs, indexes, { data_top, data_base, data_bottom });
-            break;
-        }
-        case FloorType::VertLane:
-        {
-            BuildRectData(group, TexType::OutEdgeLeft, data_left);
-            BuildRectData(group, TexType::OutEdgeRight, data_right);
-            data_right.side = TileSide::Right;
-            BuildRectData(group, TexType::FullTile, data_base);
-            data.left = &data_left;
-            data.right = &data_right;
-            AdjustRectData(data_base, data);
-            BuildMeshData(verts, uvs, indexes, { data_left, data_base, data_right });
-            break;
-        }
-        case FloorType::EdgeLeft:
-        {
-            BuildRectData(group, TexType::OutEdgeLeft, data_left);
-            BuildRectData(group, TexType::FullTile, data_base);
-            data.left = &data_left;
-            AdjustRectData(data_base, data);
-            BuildMeshData(verts, uvs, indexes, { data_left, data_base });
-            break;
-        }
-        case FloorType::EdgeTop:
-        {
-            BuildRectData(group, TexType::OutEdgeTop, data_top);
-            BuildRectData(group, TexType::FullTile, data_base);
-            data.top = &data_top;
-            AdjustRectData(data_base, data);
-            BuildMeshData(verts, uvs, indexes, { data_top, data_base });
-            break;
-        }
-        case FloorType::EdgeRight:
-        {
-            BuildRectData(group, TexType::OutEdgeRight, data_right);
-            BuildRectData(group, TexType::FullTile, data_base);
-            data.right = &data_right;
-            AdjustRectData(data_base, data);
-            data_right.side = TileSide::Right;
-            BuildMeshData(verts, uvs, indexes, { data_base, data_right });
-            break;
-        }
-        case FloorType::EdgeBottom:
-        {
-            BuildRectData(group, TexType::OutEdgeBottom, data_bottom);
-            BuildRectData(group, TexType::FullTile, data_base);
-            data.bottom = &data_bottom;
-            AdjustRectData(data_base, data);
-            data_bottom.side = TileSide::Bottom;
-            BuildMeshData(verts, uvs, indexes, { data_base, data_bottom });
-            break;
-        }
-        case FloorType::TurnBottomLeft:
-        {
-            BuildPolyData(group,
-                { TexType::OutCornerTopRight, TexType::OutEdgeRight, TexType::OutEdgeTop },
-                { { TileSide::TopLeft}, { TileSide::TopRight}, { TileSide::BottomLeft},
-                { TileSide::TopLeft, {}, { {TileOp::Add, 2 } } },
-                { TileSide::BottomRight, { { TileOp::Sub, 1 } }, {} },
-                { TileSide::BottomRight } }, curve_data);
-
-            curve_data.indexes = { 0, 1, 3, 1, 4, 3, 1, 5, 4, 3, 4, 2 };
-
-            BuildPolyData(group,
-                { TexType::FullTile, TexType::OutCornerTopRight, TexType::OutEdgeRight, TexType::OutEdgeTop, TexType::InCornerBottomLeft },
-                {
-                { TileSide::TopLeft, {}, { { TileOp::Add, 3 } } },
-                { TileSide::TopRight, {{TileOp::Sub, 1}},  {{TileOp::Add, 3}} },
-                { TileSide::TopRight, {{TileOp::Sub, 1}},  {{TileOp::Add, 1}} },
-                { TileSide::TopRight, {{TileOp::Sub, 2}},  {{TileOp::Add, 1}} },
-                { TileSide::BottomRight, {{TileOp::Sub, 2}}, {} },
-                { TileSide::BottomLeft, {{TileOp::Add, 4}}, {{TileOp::Sub, 4}} },
-                { TileSide::BottomLeft, {}, {{TileOp::Sub, 4}} },
-                { TileSide::BottomLeft, {{TileOp::Add, 4}}, {} } },
-                data_base);
-
-            data_base.indexes = { 0, 1, 2, 2, 3, 4, 0, 2, 5, 2, 4, 5, 0, 5, 6, 5, 4, 7 };
-
-            BuildRectData(group, TexType::OutEdgeRight, data_right);
-            data.top = &curve_data;
-            AdjustRectData(data_right, data);
-            data.top = nullptr;
-            BuildRectData(group, TexType::OutEdgeTop, data_top);
-            data.right = &curve_data;
-            AdjustRectData(data_top, data);
-            BuildRectData(group, TexType::InCornerBottomLeft, data_corner1);
-
-            data_right.side = TileSide::BottomRight;
-            data_corner1.side = TileSide::BottomLeft;
-            curve_data.side = TileSide::TopRight;
-            BuildMeshData(verts, uvs, indexes, { data_top, curve_data, data_base,
-                data_right, data_corner1 });
-            break;
-        }
-        case FloorType::TurnBottomRight:
-        {
-            BuildPolyData(group,
-                { TexType::OutCornerTopLeft, TexType::OutEdgeLeft, TexType::OutEdgeTop },
-                { { TileSide::TopLeft}, { TileSide::TopRight}, { TileSide::BottomLeft},
-                { TileSide::TopRight, {},  {{TileOp::Add, 2}} },
-                { TileSide::BottomLeft, {{TileOp::Add, 1}}, {} },
-                { TileSide::BottomRight } },
-                curve_data);
-
-            curve_data.indexes = { 0, 1, 3, 0, 3, 4, 0, 4, 2, 3, 5, 4 };
-
-            BuildPolyData(group,
-                { TexType::FullTile, TexType::OutCornerTopLeft, TexType::OutEdgeLeft, TexType::OutEdgeTop, TexType::InCornerBottomRight },
-                {
-                { TileSide::TopLeft,  {{TileOp::Add, 1}},  {{TileOp::Add, 3}} },
-                { TileSide::TopRight, {}, {{TileOp::Add, 3}} },
-                { TileSide::TopLeft, {{TileOp::Add, 1}},  {{TileOp::Add, 1}} },
-                { TileSide::TopLeft, {{TileOp::Add, 2}},  {{TileOp::Add, 1}} },
-                { TileSide::BottomLeft, {{TileOp::Add, 2}}, {} },
-                { TileSide::BottomRight, {{TileOp::Sub, 4}},  {{TileOp::Sub, 4}} },
-                { TileSide::BottomRight, {},  {{TileOp::Sub, 4}} },
-                { TileSide::BottomRight, {{TileOp::Sub, 4}}, {} } },
-                data_base);
-            data_base.indexes = { 0, 1, 2, 3, 2, 4, 1, 5, 2, 2, 5, 4, 1, 6, 5, 5, 7, 4 };
-
-            BuildRectData(group, TexType::OutEdgeLeft, data_left);
-            data.top = &curve_data;
-            AdjustRectData(data_left, data);
-            data.top = nullptr;
-            BuildRectData(group, TexType::OutEdgeTop, data_top);
-            data.left = &curve_data;
-            AdjustRectData(data_top, data);
-            BuildRectData(group, TexType::InCornerBottomRight, data_corner1);
-
-            data_top.side = TileSide::TopRight;
-            data_left.side = TileSide::BottomLeft;
-            data_corner1.side = TileSide::BottomRight;
-            BuildMeshData(verts, uvs, indexes, { curve_data, data_top, data_base,
-                    data_left, data_base, data_corner1 });
-            break;
-        }
-        case FloorType::TurnTopLeft:
-        {
-            BuildPolyData(group,
-                { TexType::OutCornerBottomRight, TexType::OutEdgeRight, TexType::OutEdgeBottom },
-                {
-                    { TileSide::TopLeft}, { TileSide::TopRight},
-                { TileSide::TopRight, {{TileOp::Sub, 1}}, {}},
-                    { TileSide::BottomLeft, {},  {{TileOp::Sub, 2}}},
-                { TileSide::BottomLeft},
-                { TileSide::BottomRight} }, curve_data);
-
-            curve_data.indexes = { 0, 2, 3, 2, 1, 5, 2, 5, 3, 3, 5, 4 };
-
-            BuildPolyData(group,
-                { TexType::FullTile, TexType::OutCornerBottomRight, TexType::OutEdgeRight, TexType::OutEdgeBottom, TexType::InCornerTopLeft },
-                {
-                { TileSide::TopLeft, {{TileOp::Add, 4}}, {}},
-                 { TileSide::TopLeft, {{TileOp::Add, 4}},  {{TileOp::Add, 4}}},
-                    { TileSide::TopLeft, {},  {{TileOp::Add, 4}}},
-                    { TileSide::TopRight,  {{TileOp::Sub, 2}}, {}},
-                    { TileSide::BottomRight, {{TileOp::Sub, 1}},  {{TileOp::Sub, 1}} },
-                { TileSide::BottomRight, {{TileOp::Sub, 2}},  {{TileOp::Sub, 1}} },
-
-            { TileSide::BottomLeft, {},  {{TileOp::Sub, 3}} },
-            { TileSide::BottomRight, {{TileOp::Sub, 1}}, {{TileOp::Sub, 3}} }
-                },
-                data_base);
-
-            data_base.indexes = { 0, 3, 1, 3, 4, 1, 3, 5, 4, 2, 1, 6, 1, 4, 6, 4, 7, 6 };
-
-            BuildRectData(group, TexType::OutEdgeRight, data_right);
-            data.bottom = &curve_data;
-            AdjustRectData(data_right, data);
-            data.bottom = nullptr;
-            BuildRectData(group, TexType::OutEdgeBottom, data_bottom);
-            data.right = &curve_data;
-            AdjustRectData(data_bottom, data);
-            data.right = nullptr;
-            BuildRectData(group, TexType::InCornerTopLeft, data_corner1);
-            data_right.side = TileSide::TopRight;
-            data_bottom.side = TileSide::BottomLeft;
-            curve_data.side = TileSide::BottomRight;
-            BuildMeshData(verts, uvs, indexes, { data_corner1, data_base,
-                    data_right, data_bottom,
-                    curve_data });
-            break;
-        }
-        case FloorType::TurnTopRight:
-        {
-            BuildPolyData(group,
-                { TexType::OutCornerBottomLeft, TexType::OutEdgeLeft, TexType::OutEdgeBottom },
-                {
-                    { TileSide::TopLeft}, { TileSide::TopRight},
-                { TileSide::TopLeft, {{TileOp::Add, 1}}, {} },
-                    { TileSide::BottomRight, {},  {{TileOp::Sub, 2}} },
-                    { TileSide::BottomLeft },
-                    { TileSide::BottomRight }
-                }, curve_data);
-
-            curve_data.indexes = { 0, 2, 4, 2, 1, 3, 2, 3, 4, 3, 5, 4 };
-
-            BuildPolyData(group,
-                { TexType::FullTile, TexType::OutCornerBottomLeft, TexType::OutEdgeLeft, TexType::OutEdgeBottom, TexType::InCornerTopRight },
-                {
-                    { TileSide::TopLeft, {{TileOp::Add, 2}}, {} },
-                    { TileSide::TopRight, {{TileOp::Sub, 4}}, {} },
-                    { TileSide::TopRight, {{TileOp::Sub, 4}},  {{TileOp::Add, 4}} },
-                    { TileSide::TopRight, {},  {{TileOp::Add, 4}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 2}},  {{TileOp::Sub, 1}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 1}},  {{TileOp::Sub, 1}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 1}},  {{TileOp::Sub, 3}} },
-                    { TileSide::BottomRight, {},  {{TileOp::Sub, 3}} } 
-                },
-                    data_base);
-            data_base.indexes = { 0, 1, 2, 0, 2, 5, 0, 5, 4, 2, 3, 7, 2, 7, 5, 5, 7, 6 };
-
-            BuildRectData(group, TexType::OutEdgeLeft, data_left);
-            data.bottom = &curve_data;
-            AdjustRectData(data_left, data);
-            data.bottom = nullptr;
-            BuildRectData(group, TexType::OutEdgeBottom, data_bottom);
-            data.left = &curve_data;
-            AdjustRectData(data_bottom, data);
-            data.left = nullptr;
-            BuildRectData(group, TexType::InCornerTopRight, data_corner1);
-
-            data_corner1.side = TileSide::TopRight;
-            curve_data.side = TileSide::BottomLeft;
-            data_bottom.side = TileSide::BottomRight;
-            BuildMeshData(verts, uvs, indexes, { data_left, data_base,
-                data_corner1, curve_data,
-                data_bottom });
-            break;
-        }
-        case FloorType::EdgeTopRight:
-        {
-            BuildPolyData(group,
-                { TexType::OutCornerTopRight, TexType::OutEdgeRight, TexType::OutEdgeTop },
-                {
-                    { TileSide::TopLeft}, { TileSide::TopRight}, { TileSide::BottomLeft},
-                    { TileSide::TopLeft, {},  {{TileOp::Add, 2}} },
-                    { TileSide::BottomRight, {{TileOp::Sub, 1}}, {} },
-                { TileSide::BottomRight}
-                }, curve_data);
-
-            curve_data.indexes = { 0, 1, 3, 1, 4, 3, 1, 5, 4, 3, 4, 2 };
-
-            BuildPolyData(group,
-                { TexType::FullTile, TexType::OutCornerTopRight, TexType::OutEdgeRight, TexType::OutEdgeTop },
-                {
-                    { TileSide::TopLeft, {},  {{TileOp::Add, 3}} },
-                    { TileSide::TopRight, {{TileOp::Sub, 1}},  {{TileOp::Add, 3}} },
-                    { TileSide::TopRight, {{TileOp::Sub, 1}},  {{TileOp::Add, 1}} },
-                    { TileSide::TopRight, {{TileOp::Sub, 2}},  {{TileOp::Add, 1}} },
-                    TileSide::BottomLeft,
-                    { TileSide::BottomRight, {{TileOp::Sub, 2}}, {} }
-                }, data_base);
-            data_base.indexes = { 0, 1, 2, 2, 3, 5, 0, 2, 4, 2, 5, 4 };
-
-            BuildRectData(group, TexType::OutEdgeRight, data_right);
-            data.top = &curve_data;
-            AdjustRectData(data_right, data);
-            data.top = nullptr;
-            BuildRectData(group, TexType::OutEdgeTop, data_top);
-            data.right = &curve_data;
-            AdjustRectData(data_top, data);
-            data.right = nullptr;
-            curve_data.side = TileSide::TopRight;
-            data_right.side = TileSide::BottomRight;
-            BuildMeshData(verts, uvs, indexes, { data_top, curve_data,
-                data_base, data_right
-        });
-            break;
-        }
-        case FloorType::EdgeTopLeft:
-        {
-            BuildPolyData(group,
-                {TexType::OutCornerTopLeft, TexType::OutEdgeLeft, TexType::OutEdgeTop
-        },
-                {
-                    {TileSide::TopLeft}, {TileSide::TopRight}, {TileSide::BottomLeft},
-                    { TileSide::TopRight, {},  {{TileOp::Add, 2}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 1}}, {} },
-                    TileSide::BottomRight}, curve_data);
-
-            curve_data.indexes = { 0, 1, 3, 0, 3, 4, 0, 4, 2, 3, 5, 4 };
-
-            BuildPolyData(group,
-                { TexType::FullTile, TexType::OutCornerTopLeft, TexType::OutEdgeLeft, TexType::OutEdgeTop },
-                {
-                    { TileSide::TopLeft, {{TileOp::Add, 1}},  {{TileOp::Add, 3}} },
-                    { TileSide::TopRight, {},  {{TileOp::Add, 3}} },
-                    { TileSide::TopLeft, {{TileOp::Add, 1}},  {{TileOp::Add, 1}} },
-                    { TileSide::TopLeft, {{TileOp::Add, 2}},  {{TileOp::Add, 1}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 2}}, {} },
-                    TileSide::BottomRight }, data_base);
-            data_base.indexes = { 0, 1, 2, 1, 5, 2, 3, 2, 4, 2, 5, 4 };
-
-            BuildRectData(group, TexType::OutEdgeLeft, data_left);
-            data.top = &curve_data;
-            AdjustRectData(data_left, data);
-            data.top = nullptr;
-            BuildRectData(group, TexType::OutEdgeTop, data_top);
-            data.left = &curve_data;
-            AdjustRectData(data_top, data);
-            data.left = nullptr;
-            data_top.side = TileSide::TopRight;
-            BuildMeshData(verts, uvs, indexes, { curve_data, data_top,
-                    data_left, data_base });
-            break;
-        }
-
-        case FloorType::EdgeBottomRight:
-        {
-            BuildPolyData(group,
-                { TexType::OutCornerBottomRight, TexType::OutEdgeRight, TexType::OutEdgeBottom },
-                {
-                    {TileSide::TopLeft }, {TileSide::TopRight },
-                    { TileSide::TopRight, {{TileOp::Sub, 1}}, {} },
-                    { TileSide::BottomLeft, {},  {{TileOp::Sub, 2}} },
-                {TileSide::BottomLeft},
-                    {TileSide::BottomRight} }, curve_data);
-
-            curve_data.indexes = { 0, 2, 3, 2, 1, 5, 2, 5, 3, 3, 5, 4 };
-
-            BuildPolyData(group,
-                { TexType::FullTile, TexType::OutCornerBottomRight, TexType::OutEdgeRight, TexType::OutEdgeBottom },
-                {
-                {TileSide::TopLeft },
-                    { TileSide::TopRight, {{TileOp::Sub, 2}}, {} },
-                    { TileSide::BottomRight, {{TileOp::Sub, 1}},  {{TileOp::Sub, 1}} },
-                    { TileSide::BottomRight, {{TileOp::Sub, 2}},  {{TileOp::Sub, 1}} },
-                    { TileSide::BottomLeft, {},  {{TileOp::Sub, 3}} },
-                    { TileSide::BottomRight, {{TileOp::Sub, 1}},  {{TileOp::Sub, 3}} }
-                    }, data_base);
-            data_base.indexes = { 0, 1, 2, 1, 3, 2, 0, 2, 4, 2, 5, 4 };
-
-            BuildRectData(group, TexType::OutEdgeRight, data_right);
-            data.bottom = &curve_data;
-            AdjustRectData(data_right, data);
-            data.bottom = nullptr;
-            BuildRectData(group, TexType::OutEdgeBottom, data_bottom);
-            data.right = &curve_data;
-            AdjustRectData(data_bottom, data);
-            data.right = nullptr;
-
-            data_right.side = TileSide::TopRight;
-            data_bottom.side = TileSide::BottomLeft;
-            curve_data.side = TileSide::BottomRight;
-            BuildMeshData(verts, uvs, indexes, { data_base, data_right,
-                    data_bottom, curve_data });
-            break;
-        }
-        case FloorType::EdgeBottomLeft:
-        {
-            BuildPolyData(group,
-                { TexType::OutCornerBottomLeft, TexType::OutEdgeLeft, TexType::OutEdgeBottom },
-                {
-                    {TileSide::TopLeft}, {TileSide::TopRight},
-                    { TileSide::TopLeft, {{TileOp::Add, 1}}, {} },
-                    { TileSide::BottomRight, {},  {{TileOp::Sub, 2}} },
-                {TileSide::BottomLeft},
-                {TileSide::BottomRight} }, curve_data);
-
-            curve_data.indexes = { 0, 2, 4, 2, 1, 3, 2, 3, 4, 3, 5, 4 };
-
-            BuildPolyData(group,
-                { TexType::FullTile, TexType::OutCornerBottomLeft, TexType::OutEdgeLeft, TexType::OutEdgeBottom },
-                {
-                    { TileSide::TopLeft, {{TileOp::Add, 2}}, {} },
-                    { TileSide::TopRight },
-                    { TileSide::BottomLeft, {{TileOp::Add, 2}},  {{TileOp::Sub, 1}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 1}},  {{TileOp::Sub, 1}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 1}},  {{TileOp::Sub, 3}} },
-                    { TileSide::BottomRight, {},  {{TileOp::Sub, 3}} } 
-                }, data_base);
-            data_base.indexes = { 0, 1, 3, 0, 3, 2, 1, 5, 3, 3, 5, 4 };
-
-            BuildRectData(group, TexType::OutEdgeLeft, data_left);
-            data.bottom = &curve_data;
-            AdjustRectData(data_left, data);
-            data.bottom = nullptr;
-            BuildRectData(group, TexType::OutEdgeBottom, data_bottom);
-            data.left = &curve_data;
-            AdjustRectData(data_bottom, data);
-            data.left = nullptr;
-
-            data_bottom.side = TileSide::BottomRight;
-            curve_data.side = TileSide::BottomLeft;
-            BuildMeshData(verts, uvs, indexes, { data_left, data_base,
-                    curve_data, data_bottom });
-            break;
-        }
-        case FloorType::VertCrossRight:
-        {
-            BuildPolyData(group,
-                    { TexType::FullTile, TexType::OutEdgeLeft, TexType::InCornerTopRight, TexType::InCornerBottomRight },
-                {
-                    { TileSide::TopLeft, {{TileOp::Add, 1}}, {} },
-                    { TileSide::TopRight, {{TileOp::Sub, 2}}, {} },
-                    { TileSide::TopRight, {{TileOp::Sub, 2}},  {{TileOp::Add, 2}} },
-                    { TileSide::TopRight, {},  {{TileOp::Add, 2}} },
-                    { TileSide::BottomRight, {},  {{TileOp::Sub, 3}} },
-                    { TileSide::BottomRight, {{TileOp::Sub, 3}},  {{TileOp::Sub, 3}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 1}}, {} },
-                    { TileSide::BottomRight, {{TileOp::Sub, 3}}, {} } },
-                    data_base);
-            data_base.indexes = { 0, 1, 2, 0, 2, 5, 0, 5, 6, 5, 7, 6, 2, 3, 5, 3, 4, 5 };
-
-            BuildRectData(group, TexType::OutEdgeLeft, data_left);
-            BuildRectData(group, TexType::InCornerTopRight, data_corner1);
-            BuildRectData(group, TexType::InCornerBottomRight, data_corner2);
-
-            data_corner1.side = TileSide::TopRight;
-            data_corner2.side = TileSide::BottomRight;
-            BuildMeshData(verts, uvs, indexes, { data_left, data_base,
-                    data_corner1, data_corner2 });
-            break;
-        }
-        case FloorType::VertCrossLeft:
-        {
-            BuildPolyData(group,
-                    { TexType::FullTile, TexType::OutEdgeRight, TexType::InCornerTopLeft, TexType::InCornerBottomLeft },
-                {
-                    { TileSide::TopLeft, {{TileOp::Add, 2}}, {} },
-                    { TileSide::TopRight, {{TileOp::Sub, 1}}, {} },
-                    { TileSide::TopLeft, {},  {{TileOp::Add, 2}} },
-                    { TileSide::TopLeft, {{TileOp::Add, 2}},  {{TileOp::Add, 2}} },
-                    { TileSide::BottomLeft, {},  {{TileOp::Sub, 3}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 3}},  {{TileOp::Sub, 3}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 3}}, {} },
-                    { TileSide::BottomRight, {{TileOp::Sub, 1}}, {} } },
-                    data_base);
-            data_base.indexes = { 2, 3, 5, 2, 5, 4, 0, 1, 3, 1, 5, 3, 1, 7, 5, 5, 7, 6 };
-
-            BuildRectData(group, TexType::OutEdgeRight, data_right);
-            BuildRectData(group, TexType::InCornerTopLeft, data_corner1);
-            BuildRectData(group, TexType::InCornerBottomLeft, data_corner2 );
-
-            data_right.side = TileSide::TopRight;
-            data_corner2.side = TileSide::BottomLeft;
-            BuildMeshData(verts, uvs, indexes, { data_corner1, data_base,
-                    data_right, data_corner2 });
-            break;
-        }
-        case FloorType::HorzCrossTop:
-        {
-            BuildPolyData(group,
-                    { TexType::FullTile, TexType::OutEdgeBottom, TexType::InCornerTopLeft, TexType::InCornerTopRight },
-                {
-                    { TileSide::TopLeft, {{TileOp::Add, 2}}, {} },
-                    { TileSide::TopRight, {{TileOp::Sub, 3}}, {} },
-                    { TileSide::TopLeft, {},  {{TileOp::Add, 2}} },
-                    { TileSide::TopLeft, {{TileOp::Add, 2}},  {{TileOp::Add, 2}} },
-                    { TileSide::TopRight, {{TileOp::Sub, 3}},  {{TileOp::Add, 3}} },
-                    { TileSide::TopRight, {},  {{TileOp::Add, 3}} },
-                    { TileSide::BottomLeft, {},  {{TileOp::Sub, 1}} },
-                    { TileSide::BottomRight, {},  {{TileOp::Sub, 1}} } },
-                    data_base);
-            data_base.indexes = { 0, 1, 3, 1, 4, 3, 3, 6, 2, 4, 5, 7, 3, 4, 6, 4, 7, 6 };
-
-            BuildRectData(group, TexType::OutEdgeBottom, data_bottom);
-            BuildRectData(group, TexType::InCornerTopLeft, data_corner1);
-            BuildRectData(group, TexType::InCornerTopRight, data_corner2);
-
-            data_corner2.side = TileSide::TopRight;
-            data_bottom.side = TileSide::BottomLeft;
-            BuildMeshData(verts, uvs, indexes, { data_corner1, data_base, data_corner2, data_bottom });
-            break;
-        }
-        case FloorType::HorzCrossBottom:
-        {
-            BuildPolyData(group,
-                    { TexType::FullTile, TexType::OutEdgeTop, TexType::InCornerBottomLeft, TexType::InCornerBottomRight },
-                {
-                    { TileSide::TopLeft, {},  {{TileOp::Add, 1}} },
-                    { TileSide::TopRight, {},  {{TileOp::Add, 1}} },
-                    { TileSide::BottomLeft, {},  {{TileOp::Sub, 2}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 2}},  {{TileOp::Sub, 2}} },
-                    { TileSide::BottomRight, {{TileOp::Sub, 3}},  {{TileOp::Sub, 3}} },
-                    { TileSide::BottomRight, {},  {{TileOp::Sub, 3}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 2}}, {} },
-                    { TileSide::BottomRight, {{TileOp::Sub, 3}}, {} } },
-                    data_base);
-            data_base.indexes = { 0, 3, 2, 0, 1, 3, 1, 4, 3, 1, 5, 4, 3, 4, 7, 3, 7, 6 };
-
-            BuildRectData(group, TexType::OutEdgeTop, data_top);
-            BuildRectData(group, TexType::InCornerBottomLeft, data_corner1);
-            BuildRectData(group, TexType::InCornerBottomRight, data_corner2);
-
-            data_corner1.side = TileSide::BottomLeft; 
-            data_corner2.side = TileSide::BottomRight;
-            BuildMeshData(verts, uvs, indexes, { data_top, data_base, data_corner1, data_corner2 });
-            break;
-        }
-        case FloorType::EdgeLeftCornerTopRight:
-        {
-            BuildPolyData(group,
-                    { TexType::FullTile, TexType::OutEdgeLeft, TexType::InCornerTopRight },
-                {
-                    { TileSide::TopLeft, {{TileOp::Add, 1}}, {} },
-                    { TileSide::TopRight, {{TileOp::Sub, 2}}, {} },
-                    { TileSide::TopRight, {{TileOp::Sub, 2}},  {{TileOp::Add, 2}} },
-                    { TileSide::TopRight, {},  {{TileOp::Add, 2}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 1}}, {} },
-                {TileSide::BottomRight} },
-                    data_base);
-            data_base.indexes = { 0, 1, 2, 0, 2, 4, 2, 5, 4, 2, 3, 5 };
-
-            BuildRectData(group, TexType::OutEdgeLeft, data_left);
-            BuildRectData(group, TexType::InCornerTopRight, data_corner1);
-
-            data_corner1.side = TileSide::TopRight;
-            BuildMeshData(verts, uvs, indexes, { data_left, data_base,
-                    data_corner1 });
-            break;
-        }
-        case FloorType::EdgeLeftCornerBottomRight:
-        {
-            BuildPolyData(group,
-                    { TexType::FullTile, TexType::OutEdgeLeft, TexType::InCornerBottomRight },
-                {
-                    { TileSide::TopLeft, {{TileOp::Add, 1}}, {} },
-                { TileSide::TopRight },
-                    { TileSide::BottomLeft, {{TileOp::Add, 1}}, {} },
-                    { TileSide::BottomRight, {{TileOp::Sub, 2}},  {{TileOp::Sub, 2}} },
-                    { TileSide::BottomRight, {},  {{TileOp::Sub, 2}} },
-                    { TileSide::BottomRight, {{TileOp::Sub, 2}}, {} } },
-                    data_base);
-            data_base.indexes = { 0, 1, 3, 1, 4, 3, 0, 3, 2, 3, 5, 2 };
-
-            BuildRectData(group, TexType::OutEdgeLeft, data_left);
-            BuildRectData(group, TexType::InCornerBottomRight, data_corner1);
-
-            data_corner1.side = TileSide::BottomRight;
-            BuildMeshData(verts, uvs, indexes, { data_left, data_base,
-                    data_corner1 });
-            break;
-        }
-        case FloorType::EdgeRightCornerTopLeft:
-        {
-            BuildPolyData(group,
-                    { TexType::FullTile, TexType::OutEdgeRight, TexType::InCornerTopLeft },
-                {
-                    { TileSide::TopLeft, {{TileOp::Add, 2}}, {} },
-                    { TileSide::TopRight, {{TileOp::Sub, 1}}, {} },
-                    { TileSide::TopLeft, {},  {{TileOp::Add, 2}} },
-                    { TileSide::TopLeft, {{TileOp::Add, 2}},  {{TileOp::Add, 2}} },
-                    TileSide::BottomLeft,
-                    { TileSide::BottomRight, {{TileOp::Sub, 1}}, {} } },
-                    data_base);
-            data_base.indexes = { 0, 1, 3, 1, 5, 3, 3, 5, 4, 2, 3, 4 };
-
-            BuildRectData(group, TexType::OutEdgeRight, data_right);
-            BuildRectData(group, TexType::InCornerTopLeft, data_corner1);
-
-            data_right.side = TileSide::TopRight;
-            BuildMeshData(verts, uvs, indexes, { data_corner1, data_base,
-                    data_right });
-            break;
-        }
-        case FloorType::EdgeRightCornerBottomLeft:
-        {
-            BuildPolyData(group,
-                    { TexType::FullTile, TexType::OutEdgeRight, TexType::InCornerBottomLeft },
-                {
-                    TileSide::TopLeft,
-                    { TileSide::TopRight, {{TileOp::Sub, 1}}, {} },
-                    { TileSide::BottomLeft, {},  {{TileOp::Sub, 2}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 2}},  {{TileOp::Sub, 2}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 2}}, {} },
-                    { TileSide::BottomRight, {{TileOp::Sub, 1}}, {} } },
-                    data_base);
-            data_base.indexes = { 0, 3, 2, 0, 1, 3, 1, 5, 3, 3, 5, 4 };
-
-            BuildRectData(group, TexType::OutEdgeRight, data_right);
-            BuildRectData(group, TexType::InCornerBottomLeft, data_corner1);
-
-            data_corner1.side = TileSide::BottomLeft;
-            data_right.side = TileSide::TopRight;
-            BuildMeshData(verts, uvs, indexes, { data_base, data_right,
-                    data_corner1 });
-            break;
-        }
-        case FloorType::EdgeTopCornerBottomRight:
-        {
-            BuildPolyData(group,
-                    { TexType::FullTile, TexType::OutEdgeTop, TexType::InCornerBottomRight },
-                {
-                    { TileSide::TopLeft, {},  {{TileOp::Add, 1}} },
-                    { TileSide::TopRight, {},  {{TileOp::Add, 1}} },
-                    { TileSide::BottomRight, {{TileOp::Sub, 2}},  {{TileOp::Sub, 2}} },
-                    { TileSide::BottomRight, {},  {{TileOp::Sub, 2}} },
-                    TileSide::BottomLeft,
-                    { TileSide::BottomRight, {{TileOp::Sub, 2}}, {} } },
-                    data_base);
-            data_base.indexes = { 0, 1, 2, 1, 3, 2, 0, 2, 4, 2, 5, 4 };
-
-            BuildRectData(group, TexType::OutEdgeTop, data_top);
-            BuildRectData(group, TexType::InCornerBottomRight, data_corner1);
-
-            data_corner1.side = TileSide::BottomRight;
-            BuildMeshData(verts, uvs, indexes, { data_top, data_base,
-                    data_corner1 });
-            break;
-        }
-        case FloorType::EdgeTopCornerBottomLeft:
-        {
-            BuildPolyData(group,
-                    { TexType::FullTile, TexType::OutEdgeTop, TexType::InCornerBottomLeft },
-                {
-                    { TileSide::TopLeft, {},  {{TileOp::Add, 1}} },
-                    { TileSide::TopRight, {},  {{TileOp::Add, 1}} },
-                    { TileSide::BottomLeft, {},  {{TileOp::Sub, 2}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 2}},  {{TileOp::Sub, 2}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 2}}, {} },
-                {TileSide::BottomRight} },
-                    data_base);
-            data_base.indexes = { 0, 3, 2, 0, 1, 3, 1, 5, 3, 3, 5, 4 };
-
-            BuildRectData(group, TexType::OutEdgeTop, data_top);
-            BuildRectData(group, TexType::InCornerBottomLeft, data_corner1);
-
-            data_corner1.side = TileSide::BottomLeft;
-            BuildMeshData(verts, uvs, indexes, { data_top, data_base,
-                    data_corner1 });
-            break;
-        }
-        case FloorType::EdgeBottomCornerTopRight:
-        {
-            BuildPolyData(group,
-                    { TexType::FullTile, TexType::OutEdgeBottom, TexType::InCornerTopRight },
-                {
-                    {TileSide::TopLeft},
-                    { TileSide::TopRight, {{TileOp::Sub, 2}}, {} },
-                    { TileSide::TopRight, {{TileOp::Sub, 2}},  {{TileOp::Add, 2}} },
-                    { TileSide::TopRight, {},  {{TileOp::Add, 2}} },
-                    { TileSide::BottomLeft, {},  {{TileOp::Sub, 1}} },
-                    { TileSide::BottomRight, {},  {{TileOp::Sub, 1}} } },
-                    data_base);
-            data_base.indexes = { 0, 1, 2, 0, 2, 4, 2, 3, 5, 2, 5, 4 };
-
-            BuildRectData(group, TexType::OutEdgeBottom, data_bottom);
-            BuildRectData(group, TexType::InCornerTopRight, data_corner1);
-
-            data_corner1.side = TileSide::TopRight;
-            data_bottom.side = TileSide::BottomLeft;
-            BuildMeshData(verts, uvs, indexes, { data_base, data_corner1,
-                    data_bottom });
-            break;
-        }
-        case FloorType::EdgeBottomCornerTopLeft:
-        {
-            BuildPolyData(group,
-                    { TexType::FullTile, TexType::OutEdgeBottom, TexType::InCornerTopLeft },
-                {
-                    { TileSide::TopLeft, {{TileOp::Add, 2}}, {} },
-                    TileSide::TopRight,
-                    { TileSide::TopLeft, {},  {{TileOp::Add, 2}} },
-                    { TileSide::TopLeft, {{TileOp::Add, 2}},  {{TileOp::Add, 2}} },
-                    { TileSide::BottomLeft, {},  {{TileOp::Sub, 1}} },
-                    { TileSide::BottomRight, {},  {{TileOp::Sub, 1}} } },
-                    data_base);
-            data_base.indexes = { 0, 1, 3, 2, 3, 4, 1, 5, 3, 3, 5, 4 };
-
-            BuildRectData(group, TexType::OutEdgeBottom, data_bottom);
-            BuildRectData(group, TexType::InCornerTopLeft, data_corner1);
-
-            data_bottom.side = TileSide::BottomLeft;
-            BuildMeshData(verts, uvs, indexes, { data_corner1, data_base,
-                    data_bottom });
-            break;
-        }
-        case FloorType::CornerExceptTopLeft:
-        {
-            BuildPolyData(group,
-                    { TexType::FullTile, TexType::InCornerTopRight, TexType::InCornerBottomLeft, TexType::InCornerBottomRight },
-                {
-                { TileSide::TopLeft },
-                    { TileSide::TopRight, {{TileOp::Sub, 1}}, {} },
-                    { TileSide::TopRight, {{TileOp::Sub, 1}},  {{TileOp::Add, 1}} },
-                    { TileSide::TopRight, {},  {{TileOp::Add, 1}} },
-                    { TileSide::BottomLeft, {},  {{TileOp::Sub, 2}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 2}},  {{TileOp::Sub, 2}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 2}}, {} },
-                    { TileSide::BottomRight, {{TileOp::Sub, 3}}, {} },
-                    { TileSide::BottomRight, {{TileOp::Sub, 3}},  {{TileOp::Sub, 3}} },
-                    { TileSide::BottomRight, {},  {{TileOp::Sub, 3}} } },
-                    data_base);
-            data_base.indexes = { 0, 1, 2, 0, 2, 8, 0, 8, 5, 0, 5, 4, 2, 3, 9, 2, 9, 8, 5, 8, 7, 5, 7, 6 };
-
-            BuildRectData(group, TexType::InCornerTopRight, data_corner1);
-            BuildRectData(group, TexType::InCornerBottomLeft, data_corner2);
-            BuildRectData(group, TexType::InCornerBottomRight, data_corner3);
-
-            data_corner1.side = TileSide::TopRight;
-            data_corner2.side = TileSide::BottomLeft;
-            data_corner3.side = TileSide::BottomRight;
-            BuildMeshData(verts, uvs, indexes, { data_base, data_corner1,
-                    data_corner2, data_corner3 });
-
-            break;
-        }
-        case FloorType::CornerExceptTopRight:
-        {
-            BuildPolyData(group,
-                    { TexType::FullTile, TexType::InCornerTopLeft, TexType::InCornerBottomLeft, TexType::InCornerBottomRight },
-                {
-                    { TileSide::TopLeft, {{TileOp::Add, 1}}, {} },
-                    { TileSide::TopRight },
-                    { TileSide::TopLeft, {},  {{TileOp::Add, 1}} },
-                    { TileSide::TopLeft, {{TileOp::Add, 1}},  {{TileOp::Add, 1}} },
-                    { TileSide::BottomLeft, {},  {{TileOp::Sub, 2}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 2}},  {{TileOp::Sub, 2}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 2}}, {} },
-                    { TileSide::BottomRight, {{TileOp::Sub, 3}}, {} },
-                    { TileSide::BottomRight, {{TileOp::Sub, 3}},  {{TileOp::Sub, 3}} },
-                    { TileSide::BottomRight, {},  {{TileOp::Sub, 3}} } },
-                    data_base);
-            data_base.indexes = { 0, 1, 3, 2, 3, 4, 3, 5, 4, 1, 5, 3, 1, 8, 5, 1, 9, 8, 5, 8, 6, 8, 7, 6 };
-
-            BuildRectData(group, TexType::InCornerTopLeft, data_corner1);
-            BuildRectData(group, TexType::InCornerBottomLeft, data_corner2);
-            BuildRectData(group, TexType::InCornerBottomRight, data_corner3);
-
-            data_corner2.side = TileSide::BottomLeft;
-            data_corner3.side = TileSide::BottomRight;
-            BuildMeshData(verts, uvs, indexes, { data_corner1, data_base,
-                    data_corner2, data_corner3 });
-
-            break;
-        }
-        case FloorType::CornerExceptBottomLeft:
-        {
-            BuildPolyData(group,
-                    { TexType::FullTile, TexType::InCornerTopLeft, TexType::InCornerTopRight, TexType::InCornerBottomRight },
-                {
-                    { TileSide::TopLeft, {{TileOp::Add, 1}}, {} },
-                    { TileSide::TopRight, {{TileOp::Sub, 2}}, {} },
-                    { TileSide::TopLeft, {},  {{TileOp::Add, 1}} },
-                    { TileSide::TopLeft, {{TileOp::Add, 1}},  {{TileOp::Add, 1}} },
-                    { TileSide::TopRight, {{TileOp::Sub, 2}},  {{TileOp::Add, 1}} },
-                    { TileSide::TopRight, {},  {{TileOp::Add, 2}} },
-                    TileSide::BottomLeft,
-                    { TileSide::BottomRight, {{TileOp::Sub, 3}}, {} },
-                    { TileSide::BottomRight, {{TileOp::Sub, 3}},  {{TileOp::Sub, 3}} },
-                    { TileSide::BottomRight, {},  {{TileOp::Sub, 3}} } },
-                    data_base);
-            data_base.indexes = { 0, 1, 3, 1, 4, 3, 2, 3, 6, 3, 4, 6, 4, 8, 6, 8, 7, 6, 4, 5, 8, 5, 9, 8 };
-
-            BuildRectData(group, TexType::InCornerTopLeft, data_corner1);
-            BuildRectData(group, TexType::InCornerTopRight, data_corner2);
-            BuildRectData(group, TexType::InCornerBottomRight, data_corner3);
-
-            data_corner2.side = TileSide::TopRight;
-            data_corner3.side = TileSide::BottomRight;
-            BuildMeshData(verts, uvs, indexes, { data_corner1, data_base,
-                    data_corner2, data_corner3 });
-
-            break;
-        }
-        case FloorType::CornerExceptBottomRight:
-        {
-            BuildPolyData(group,
-                    { TexType::FullTile, TexType::InCornerTopLeft, TexType::InCornerTopRight, TexType::InCornerBottomLeft },
-                {
-                    { TileSide::TopLeft, {{TileOp::Add, 1}}, {} },
-                    { TileSide::TopRight, {{TileOp::Sub, 2}}, {} },
-                    { TileSide::TopLeft, {},  {{TileOp::Add, 1}} },
-                    { TileSide::TopLeft, {{TileOp::Add, 1}},  {{TileOp::Add, 1}} },
-                    { TileSide::TopRight, {{TileOp::Sub, 2}},  {{TileOp::Add, 2}} },
-                    { TileSide::TopRight, {},  {{TileOp::Add, 2}} },
-                    { TileSide::BottomLeft, {},  {{TileOp::Sub, 3}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 3}},  {{TileOp::Sub, 3}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 3}}, {} },
-                {TileSide::BottomRight} },
-                    data_base);
-            data_base.indexes = { 0, 1, 4, 0, 4, 3, 2, 3, 7, 2, 7, 6, 3, 4, 9, 4, 5, 9, 3, 9, 7, 7, 9, 8 };
-
-            BuildRectData(group, TexType::InCornerTopLeft, data_corner1);
-            BuildRectData(group, TexType::InCornerTopRight, data_corner2);
-            BuildRectData(group, TexType::InCornerBottomLeft, data_corner3);
-
-            data_corner2.side = TileSide::TopRight;
-            data_corner3.side = TileSide::BottomLeft;
-            BuildMeshData(verts, uvs, indexes, { data_corner1, data_base,
-                    data_corner2, data_corner3 });
-
-            break;
-        }
-        case FloorType::CornerAll:
-        {
-            BuildPolyData(group,
-                    { TexType::FullTile, TexType::InCornerTopLeft, TexType::InCornerTopRight,
-                    TexType::InCornerBottomLeft, TexType::InCornerBottomRight },
-                {
-                    { TileSide::TopLeft, {{TileOp::Add, 1}}, {} },
-                    { TileSide::TopRight, {{TileOp::Sub, 2}}, {} },
-                    { TileSide::TopLeft, {},  {{TileOp::Add, 1}} },
-                    { TileSide::TopLeft, {{TileOp::Add, 1}},  {{TileOp::Add, 1}} },
-                    { TileSide::TopRight, {{TileOp::Sub, 2}},  {{TileOp::Add, 2}} },
-                    { TileSide::TopRight, {},  {{TileOp::Add, 2}} },
-                    { TileSide::BottomLeft, {},  {{TileOp::Sub, 3}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 3}},  {{TileOp::Sub, 3}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 3}}, {} },
-                    { TileSide::BottomRight, {{TileOp::Sub, 4}}, {} },
-                    { TileSide::BottomRight, {{TileOp::Sub, 4}},  {{TileOp::Sub, 4}} },
-                    { TileSide::BottomRight, {},  {{TileOp::Sub, 4}} }  },
-                data_base);
-            data_base.indexes = { 0, 1, 3, 1, 4, 3, 2, 3, 6, 3, 7, 6, 4, 5, 10, 5, 11, 10, 3, 4, 7, 4, 10, 7, 7, 10, 8, 10, 9, 8 };
-
-            BuildRectData(group, TexType::InCornerTopLeft, data_corner1);
-            BuildRectData(group, TexType::InCornerTopRight, data_corner2);
-            BuildRectData(group, TexType::InCornerBottomLeft, data_corner3);
-            BuildRectData(group, TexType::InCornerBottomRight, data_corner4);
-
-            data_corner2.side = TileSide::TopRight;
-            data_corner3.side = TileSide::BottomLeft;
-            data_corner4.side = TileSide::BottomRight;
-            BuildMeshData(verts, uvs, indexes, { data_corner1, data_base,
-                    data_corner2, data_corner3, data_corner4, });
-
-            break;
-        }
-        case FloorType::CornerBothTop:
-        {
-            BuildPolyData(group,
-                    { TexType::FullTile, TexType::InCornerTopLeft, TexType::InCornerTopRight },
-                {
-                    { TileSide::TopLeft, {{TileOp::Add, 1}}, {} },
-                    { TileSide::TopRight, {{TileOp::Sub, 2}}, {} },
-                    { TileSide::TopLeft, {},  {{TileOp::Add, 1}} },
-                    { TileSide::TopLeft, {{TileOp::Add, 1}},  {{TileOp::Add, 1}} },
-                    { TileSide::TopRight, {{TileOp::Sub, 2}},  {{TileOp::Add, 2}} },
-                    { TileSide::TopRight, {},  {{TileOp::Add, 2}} },
-                {TileSide::BottomLeft},
-                {TileSide::BottomRight} },
-                    data_base);
-            data_base.indexes = { 0, 1, 4, 0, 4, 3, 2, 3, 6, 3, 7, 6, 3, 4, 7, 4, 5, 7 };
-
-            BuildRectData(group, TexType::InCornerTopLeft, data_corner1);
-            BuildRectData(group, TexType::InCornerTopRight, data_corner2);
-
-            data_corner2.side = TileSide::TopRight;
-            BuildMeshData(verts, uvs, indexes, { data_corner1, data_base,
-                    data_corner2 });
-
-            break;
-        }
-        case FloorType::CornerBothRight:
-        {
-            BuildPolyData(group,
-                    { TexType::FullTile, TexType::InCornerTopRight, TexType::InCornerBottomRight },
-                {
-                    TileSide::TopLeft,
-                    { TileSide::TopRight, {{TileOp::Sub, 1}}, {} },
-                    { TileSide::TopRight, {{TileOp::Sub, 1}},  {{TileOp::Add, 1}} },
-                    { TileSide::TopRight, {},  {{TileOp::Add, 1}} },
-                    TileSide::BottomLeft,
-                    { TileSide::BottomRight, {{TileOp::Sub, 2}}, {} },
-                    { TileSide::BottomRight, {{TileOp::Sub, 2}},  {{TileOp::Sub, 2}} },
-                    { TileSide::BottomRight, {},  {{TileOp::Sub, 2}} } }, 
-                    data_base);
-            data_base.indexes = { 0, 1, 2, 0, 2, 4, 2, 6, 4, 6, 5, 4, 2, 3, 6, 3, 7, 6 };
-
-            BuildRectData(group, TexType::InCornerTopRight, data_corner1);
-            BuildRectData(group, TexType::InCornerBottomRight, data_corner2);
-
-            data_corner1.side = TileSide::TopRight;
-            data_corner2.side = TileSide::BottomRight;
-            BuildMeshData(verts, uvs, indexes, { data_base, data_corner1, data_corner2 });
-            break;
-        }
-        case FloorType::CornerBothBottom:
-        {
-            BuildPolyData(group,
-                    { TexType::FullTile, TexType::InCornerBottomLeft, TexType::InCornerBottomRight },
-                {
-                    TileSide::TopLeft,
-                    TileSide::TopRight,
-                    { TileSide::BottomLeft, {},  {{TileOp::Sub, 1}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 1}},  {{TileOp::Sub, 1}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 1}}, {} },
-                    { TileSide::BottomRight, {{TileOp::Sub, 2}}, {} },
-                    { TileSide::BottomRight, {{TileOp::Sub, 2}},  {{TileOp::Sub, 2}} },
-                    { TileSide::BottomRight, {},  {{TileOp::Sub, 2}} } },
-                    data_base);
-            data_base.indexes = { 0, 3, 2, 0, 6, 3, 0, 1, 6, 1, 7, 6, 3, 6, 5, 3, 5, 4 };
-
-            BuildRectData(group, TexType::InCornerBottomLeft, data_corner1);
-            BuildRectData(group, TexType::InCornerBottomRight, data_corner2);
-
-            data_corner1.side = TileSide::BottomLeft;
-            data_corner2.side = TileSide::BottomRight;
-            BuildMeshData(verts, uvs, indexes, { data_base, data_corner1, data_corner2 });
-            break;
-        }
-        case FloorType::CornerBothLeft:
-        {
-            BuildPolyData(group,
-                    { TexType::FullTile, TexType::InCornerTopLeft, TexType::InCornerBottomLeft },
-                {
-                    { TileSide::TopLeft, {{TileOp::Add, 1}}, {} },
-                {TileSide::TopRight},
-                    { TileSide::TopLeft, {},  {{TileOp::Add, 1}} },
-                    { TileSide::TopLeft, {{TileOp::Add, 1}},  {{TileOp::Add, 1}} },
-                    { TileSide::BottomLeft, {},  {{TileOp::Sub, 2}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 2}},  {{TileOp::Sub, 2}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 2}}, {} },
-                {TileSide::BottomRight} },
-                    data_base);
-            data_base.indexes = { 0, 1, 3, 2, 3, 4, 3, 5, 4, 1, 5, 3, 1, 7, 5, 5, 7, 6 };
-
-            BuildRectData(group, TexType::InCornerTopLeft, data_corner1);
-            BuildRectData(group, TexType::InCornerBottomLeft, data_corner2);
-
-            data_corner2.side = TileSide::BottomLeft;
-            BuildMeshData(verts, uvs, indexes, { data_corner1, data_base, data_corner2 });
-            break;
-        }
-        case FloorType::CornerTopLeftBottomRight:
-        {
-            BuildPolyData(group,
-                    { TexType::FullTile, TexType::InCornerTopLeft, TexType::InCornerBottomRight },
-                {
-                    { TileSide::TopLeft, {{TileOp::Add, 1}}, {} },
-                    TileSide::TopRight,
-                    { TileSide::TopLeft, {},  {{TileOp::Add, 1}} },
-                    { TileSide::TopLeft, {{TileOp::Add, 1}},  {{TileOp::Add, 1}} },
-                    TileSide::BottomLeft,
-                    { TileSide::BottomRight, {{TileOp::Sub, 2}}, {} },
-                    { TileSide::BottomRight, {{TileOp::Sub, 2}},  {{TileOp::Sub, 2}} },
-                    { TileSide::BottomRight, {},  {{TileOp::Sub, 2}} } },
-                    data_base);
-            data_base.indexes = { 0, 1, 3, 2, 3, 4, 1, 6, 3, 1, 7, 6, 3, 6, 4, 6, 5, 4 };
-
-            BuildRectData(group, TexType::InCornerTopLeft, data_corner1);
-            BuildRectData(group, TexType::InCornerBottomRight, data_corner2);
-
-            data_corner2.side = TileSide::BottomRight;
-            BuildMeshData(verts, uvs, indexes, { data_corner1, data_base, data_corner2 });
-            break;
-        }
-        case FloorType::CornerTopRightBottomLeft:
-        {
-            BuildPolyData(group,
-                    { TexType::FullTile, TexType::InCornerTopRight, TexType::InCornerBottomLeft },
-                {
-                    {TileSide::TopLeft},
-                    { TileSide::TopRight, {{TileOp::Sub, 1}}, {} },
-                    { TileSide::TopRight, {{TileOp::Sub, 1}},  {{TileOp::Add, 1}} },
-                    { TileSide::TopRight, {},  {{TileOp::Add, 1}} },
-                    { TileSide::BottomLeft, {},  {{TileOp::Sub, 2}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 2}},  {{TileOp::Sub, 2}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 2}}, {} },
-                {TileSide::BottomRight} },
-                    data_base);
-            data_base.indexes = { 0, 1, 2, 0, 2, 5, 0, 5, 4, 2, 3, 7, 2, 7, 5, 5, 7, 6 };
-
-            BuildRectData(group, TexType::InCornerTopRight, data_corner1);
-            BuildRectData(group, TexType::InCornerBottomLeft, data_corner2);
-
-            data_corner1.side = TileSide::TopRight;
-            data_corner2.side = TileSide::BottomLeft;
-            BuildMeshData(verts, uvs, indexes, { data_base, data_corner1, data_corner2 });
-            break;
-        }
-        case FloorType::OnlyCornerTopRight:
-        {
-            BuildPolyData(group,
-                    { TexType::FullTile, TexType::InCornerTopRight },
-                {
-                    {TileSide::TopLeft},
-                    { TileSide::TopRight, {{TileOp::Sub, 1}}, {} },
-                    { TileSide::TopRight, {{TileOp::Sub, 1}},  {{TileOp::Add, 1}} },
-                    { TileSide::TopRight, {},  {{TileOp::Add, 1}} },
-                {TileSide::BottomLeft},
-                {TileSide::BottomRight} },
-                    data_base);
-            data_base.indexes = { 0, 1, 2, 0, 2, 4, 2, 3, 5, 2, 5, 4 };
-
-            BuildRectData(group, TexType::InCornerTopRight, data_corner1);
-
-            data_corner1.side = TileSide::TopRight;
-            BuildMeshData(verts, uvs, indexes, { data_base, data_corner1 });
-            break;
-        }
-        case FloorType::OnlyCornerTopLeft:
-        {
-            BuildPolyData(group,
-                    { TexType::FullTile, TexType::InCornerTopLeft },
-                {
-                    { TileSide::TopLeft, {{TileOp::Add, 1}}, {} },
-                {TileSide::TopRight},
-                    { TileSide::TopLeft, {},  {{TileOp::Add, 1}} },
-                    { TileSide::TopLeft, {{TileOp::Add, 1}},  {{TileOp::Add, 1}} },
-                {TileSide::BottomLeft},
-                {TileSide::BottomRight} },
-                    data_base);
-            data_base.indexes = { 0, 1, 3, 2, 3, 4, 1, 5, 3, 3, 5, 4 };
-
-            BuildRectData(group, TexType::InCornerTopLeft, data_corner1);
-
-            BuildMeshData(verts, uvs, indexes, { data_corner1, data_base } );
-            break;
-        }
-        case FloorType::OnlyCornerBottomRight:
-        {
-            BuildPolyData(group,
-                    { TexType::FullTile, TexType::InCornerBottomRight },
-                {
-                    {TileSide::TopLeft},
-                {TileSide::TopRight},
-                {TileSide::BottomLeft},
-                    { TileSide::BottomRight, {{TileOp::Sub, 1}}, {} },
-                    { TileSide::BottomRight, {{TileOp::Sub, 1}},  {{TileOp::Sub, 1}} },
-                    { TileSide::BottomRight, {},  {{TileOp::Sub, 1}} } },
-                    data_base);
-            data_base.indexes = { 1, 5, 4, 0, 1, 4, 0, 4, 2, 4, 3, 2 };
-
-            BuildRectData(group, TexType::InCornerBottomRight, data_corner1);
-
-            data_corner1.side = TileSide::BottomRight;
-            BuildMeshData(verts, uvs, indexes, { data_base, data_corner1 });
-            break;
-        }
-        case FloorType::OnlyCornerBottomLeft:
-        {
-            BuildPolyData(group,
-                    { TexType::FullTile, TexType::InCornerBottomLeft },
-                {
-                    {TileSide::TopLeft},
-                {TileSide::TopRight},
-                    { TileSide::BottomLeft, {},  {{TileOp::Sub, 1}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 1}},  {{TileOp::Sub, 1}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 1}}, {} },
-                    TileSide::BottomRight },
-                    data_base);
-            data_base.indexes = { 0, 3, 2, 0, 1, 3, 1, 5, 3, 3, 5, 4 };
-
-            BuildRectData(group, TexType::InCornerBottomLeft, data_corner1);
-
-            data_corner1.side = TileSide::BottomLeft;
-            BuildMeshData(verts, uvs, indexes, { data_base, data_corner1 });
-            break;
-        }
-        case FloorType::IsolatedTile:
-        {
-            BuildPolyData(group,
-                    { TexType::FullTile, TexType::OutSharpCornerTopLeft,
-                    TexType::OutSharpCornerTopRight, TexType::OutSharpCornerBottomLeft,
-                    TexType::OutSharpCornerBottomRight },
-                {
-                    { TileSide::TopLeft, {{TileOp::Add, 1}},  {{TileOp::Add, 1}} },
-                    { TileSide::TopRight, {{TileOp::Sub, 2}},  {{TileOp::Add, 2}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 3}},  {{TileOp::Sub, 3}} },
-                    { TileSide::BottomRight, {{TileOp::Sub, 4}},  {{TileOp::Sub, 4}} } },
-                    data_base);
-            data_base.indexes = { 0, 1, 3, 0, 3, 2 };
-
-            BuildRectData(group, TexType::OutSharpCornerTopLeft, data_corner1);
-            BuildRectData(group, TexType::OutSharpCornerTopRight, data_corner2);
-            BuildRectData(group, TexType::OutSharpCornerBottomLeft, data_corner3);
-            BuildRectData(group, TexType::OutSharpCornerBottomRight, data_corner4);
-
-            BuildRectData(group, TexType::OutEdgeTop, data_top);
-            data.left = &data_corner1;
-            data.right = &data_corner2;
-            AdjustRectData(data_top, data);
-            data.left = nullptr;
-            data.right = nullptr;
-            BuildRectData(group, TexType::OutEdgeLeft, data_left);
-            data.top = &data_corner1;
-            data.bottom = &data_corner3;
-            AdjustRectData(data_left, data);
-            data.top = nullptr;
-            data.bottom = nullptr;
-            BuildRectData(group, TexType::OutEdgeBottom, data_bottom);
-            data.left = &data_corner3;
-            data.right = &data_corner4;
-            AdjustRectData(data_bottom, data);
-            data.left = nullptr;
-            data.right = nullptr;
-            BuildRectData(group, TexType::OutEdgeRight, data_right);
-            data.top = &data_corner2;
-            data.bottom = &data_corner4;
-            AdjustRectData(data_right, data);
-            data.top = nullptr;
-            data.bottom = nullptr;
-
-            data_top.side = TileSide::Top;
-            data_corner2.side = TileSide::TopRight;
-            data_left.side = TileSide::Left;
-            data_right.side = TileSide::Right;
-            data_corner3.side = TileSide::BottomLeft;
-            data_bottom.side = TileSide::Bottom;
-            data_corner4.side = TileSide::BottomRight;
-            BuildMeshData(verts, uvs, indexes, { data_corner1,
-                    data_top,
-                    data_corner2,
-                    data_left,
-                    data_base,
-                    data_right,
-                    data_corner3,
-                    data_bottom,
-                    data_corner4 });
-            break;
-        }
-        case FloorType::DeadendLeft:
-        {
-            BuildPolyData(group,
-                    { TexType::FullTile, TexType::OutEdgeTop, TexType::OutEdgeBottom,
-                    TexType::OutSharpCornerTopLeft, TexType::OutSharpCornerBottomLeft },
-                {
-                    { TileSide::TopLeft, {{TileOp::Add, 3}},  {{TileOp::Add, 3}} },
-                    { TileSide::TopRight, {},  {{TileOp::Add, 1}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 4}},  {{TileOp::Sub, 4}} },
-                    { TileSide::BottomRight, {},  {{TileOp::Sub, 2}} } },
-                    data_base);
-            data_base.indexes = { 0, 1, 3, 0, 3, 2 };
-
-            BuildRectData(group, TexType::OutSharpCornerTopLeft, data_corner1);
-            BuildRectData(group, TexType::OutSharpCornerBottomLeft, data_corner2);
-            BuildRectData(group, TexType::OutEdgeTop, data_top);
-            data.left = &data_corner1;
-            AdjustRectData(data_top, data);
-            data.left = nullptr;
-            BuildRectData(group, TexType::OutEdgeLeft, data_left);
-            data.top = &data_corner1;
-            data.bottom = &data_corner2;
-            AdjustRectData(data_left, data);
-            data.top = nullptr;
-            data.bottom = nullptr;
-            BuildRectData(group, TexType::OutEdgeBottom, data_bottom);
-            data.left = &data_corner2;
-            AdjustRectData(data_bottom, data);
-            data.left = nullptr;
-
-            data_top.side = TileSide::Top;
-            data_left.side = TileSide::Left;
-            data_corner2.side = TileSide::BottomLeft;
-            data_bottom.side = TileSide::Bottom;
-            BuildMeshData(verts, uvs, indexes, { data_corner1,
-                    data_top,
-                    data_left,
-                    data_base,
-                    data_corner2, 
-                    data_bottom });
-            break;
-        }
-        case FloorType::DeadendTop:
-        {
-            BuildPolyData(group,
-                    { TexType::FullTile, TexType::OutEdgeLeft, TexType::OutEdgeRight,
-                    TexType::OutSharpCornerTopLeft, TexType::OutSharpCornerTopRight },
-                {
-                    { TileSide::TopLeft, {{TileOp::Add, 3}},  {{TileOp::Add, 3}} },
-                    { TileSide::TopRight, {{TileOp::Sub, 4}},  {{TileOp::Add, 4}} },
-                    { TileSide::BottomLeft, {{TileOp::Add, 1}}, {} },
-                    { TileSide::BottomRight, {{TileOp::Sub, 2}}, {} } },
-                    data_base);
-            data_base.indexes = { 0, 1, 3, 0, 3, 2 };
-
-            BuildRectData(group, TexType::OutSharpCornerTopLeft, data_corner1);
-            BuildRectData(group, TexType::OutSharpCornerTopRight, data_corner2);
-            BuildRectData(group, TexType::OutEdgeTop, data_top);
-            data.left = &data_corner1;
-            data.right = &data_corner2;
-            AdjustRectData(data_top, data);
-            data.left = nullptr;
-            data.right = nullptr;
-            BuildRectData(group, TexType::OutEdgeLeft, data_left);
-            data.top = &data_corner1;
-            AdjustRectData(data_left, data);
-            data.top = nullptr;
-            BuildRectData(group, TexType::OutEdgeRight, data_right);
-            data.top = &data_corner2;
-            AdjustRectData(data_right, data);
-            data.top = nullptr;
-
-            data_top.side = TileSide::Top;
-            data_corner2.side = TileSide::TopRight;
-            data_left.side = TileSide::Left;
-            data_right.side = TileSide::Right;
-            BuildMeshData(verts, uvs, indexes, { data_corner1,
-                    data_top,
-                    data_corner2,
-                    data_left,
-                    data_base,
-                    data_right });
-            break;
-        }
-        case FloorType::DeadendRight:
-        {
-            BuildPolyData(group,
-                    { TexType::FullTile, TexType::OutEdgeTop, TexType::OutEdgeBottom,
-                    TexType::OutSharpCornerTopRight, TexType::OutSharpCornerBottomRight },
-                {
-                    { TileSide::TopLeft, {},  {{TileOp::Add, 1}} },
-                    { TileSide::TopRight, {{TileOp::Sub, 3}},  {{TileOp::Add, 3}} },
-                    { TileSide::BottomLeft, {},  {{TileOp::Sub, 2}} },
-                    { TileSide::BottomRight, {{TileOp::Sub, 4}},  {{TileOp::Sub, 4}} } },
-                    data_base);
-            data_base.indexes = { 0, 1, 3, 0, 3, 2 };
-
-            BuildRectData(group, TexType::OutSharpCornerTopRight, data_corner1);
-            BuildRectData(group, TexType::OutSharpCornerBottomRight, data_corner2);
-            BuildRectData(group, TexType::OutEdgeTop, data_top);
-            data.right = &data_corner1;
-            AdjustRectData(data_top, data);
-            data.right = nullptr;
-            BuildRectData(group, TexType::OutEdgeRight, data_right);
-            data.top = &data_corner1;
-            data.bottom = &data_corner1;
-            AdjustRectData(data_right, data);
-            data.top = nullptr;
-            data.bottom = nullptr;
-            BuildRectData(group, TexType::OutEdgeBottom, data_bottom);
-            data.right = &data_corner2;
-            AdjustRectData(data_bottom, data);
-            data.right = nullptr;
-
-            data_top.side = TileSide::TopLeft;
-            data_corner1.side = TileSide::TopRight;
-            data_right.side = TileSide::Right;
-            data_bottom.side = TileSide::BottomLeft;
-            data_corner2.side = TileSide::BottomRight;
-            BuildMeshData(verts, uvs, indexes, {
-                    data_top,
-                    data_corner1,
-                    data_base,
-                    data_right,
-                    data_bottom,
-                    data_corner2 });
-            break;
-        }
-        case FloorType::DeadendBottom:
-        {
-            BuildPolyData(group,
-                { TexType::FullTile, TexType::OutEdgeLeft, TexType::OutEdgeRight,
-                TexType::OutSharpCornerBottomLeft, TexType::OutSharpCornerBottomRight },
-                {
-                { TileSide::TopLeft, { {TileOp::Add, 1} }, {} },
-                { TileSide::TopRight, {{TileOp::Sub, 2}}, {} },
-                { TileSide::BottomLeft, {{TileOp::Add, 3}},  {{TileOp::Sub, 3}} },
-                { TileSide::BottomRight, {{TileOp::Sub, 4}},  {{TileOp::Sub, 4}} }
-                },
-                data_base);
-            data_base.indexes = { 0, 1, 3, 0, 3, 2 };
-
-            BuildRectData(group, TexType::OutSharpCornerBottomLeft, data_corner1);
-            BuildRectData(group, TexType::OutSharpCornerBottomRight, data_corner2);
-            BuildRectData(group, TexType::OutEdgeBottom, data_bottom);
-            data.left = &data_corner1;
-            data.right = &data_corner2;
-            AdjustRectData(data_bottom, data);
-            data.left = nullptr;
-            data.right = nullptr;
-            BuildRectData(group, TexType::OutEdgeLeft, data_left);
-            data.bottom = &data_corner1;
-            AdjustRectData(data_left, data);
-            data.bottom = nullptr;
-            BuildRectData(group, TexType::OutEdgeRight, data_right);
-            data.bottom = &data_corner2;
-            AdjustRectData(data_right, data);
-            data.bottom = nullptr;
-
-            data_left.side = TileSide::TopLeft;
-                data_right.side = TileSide::TopRight;
-                data_corner1.side = TileSide::BottomLeft;
-                data_bottom.side = TileSide::Bottom;
-                data_corner2.side = TileSide::BottomRight;
-            BuildMeshData(verts, uvs, indexes, {
-                data_left,
-                data_base,
-                data_right,
-                data_corner1,
-                data_bottom,
-                data_corner2
-            });
-            break;
-        }
-        default:
-        {
-            verts = {};
-            uvs = {};
-            indexes = {};
-            normals = {};
-            return;
-        }
-    }
-
-    normals.Resize(verts.Count(), false);
-    for (int ix = 0, siz = verts.Count(); ix < siz; ++ix)
+    const FloorMesh &mesh = floor_meshes.meshes[(int)group][(int)floor_type];
+    const Float2 scale = Float2(ScriptGlobals::tile_dimension / (float)tile_size.X, ScriptGlobals::tile_dimension / (float)tile_size.Y);
+    const Float2 tex_scale = Float2(1.0f / (float)texture_size.X, 1.0f / (float)texture_size.Y);
+
+    verts.Resize(mesh.vert_count, false);
+    uvs.Resize(mesh.vert_count, false);
+    normals.Resize(mesh.vert_count, false);
+    for (int ix = 0; ix < mesh.vert_count; ++ix)
     {
+        const FloorMesh::Vertex &v = mesh.verts[ix];
+        verts[ix] = Float3(v.x * scale.X, 0.0f, v.z * scale.Y);
+        uvs[ix] = Float2(v.u * tex_scale.X, v.v * tex_scale.Y);
         normals[ix] = Float3::Up;
-
-        // The data was generated for a different engine originally, which has a reverse Z direction to Flax.
-        Float3 &v = verts[ix];
-        v.Z *= -1;
-        v.Z += ScriptGlobals::tile_dimension;
-    }
-}
-
-void TileGenerator::BuildUVArrayFromData(FloorGroup group, TexType ttype, Array<Float2> &result) const
-{
-    Rectangle rect = floor_uv_data[group][ttype];
-    Float2 texSize = Float2((float)texture_size.X, (float)texture_size.Y);
-    result = { rect.Location / texSize,
-            rect.GetUpperRight() / texSize,
-            rect.GetBottomLeft() / texSize,
-            rect.GetBottomRight() / texSize };
-}
-
-void TileGenerator::BuildRectData(FloorGroup group, TexType ttype, TileRectData &result)
-{
-    //var data = new TileRectData();
-    result.indexes = { 0, 1, 2, 1, 3, 2 };
-    Rectangle r = floor_uv_data[group][ttype];
-    result.verts = {
-        Float3(0.0f, 0.0f, 0.0f),
-        Float3(r.Size.X / tile_size.X * ScriptGlobals::tile_dimension, 0.0f, 0.0f),
-        Float3(0.0f, 0.0f, r.Size.Y / tile_size.Y * ScriptGlobals::tile_dimension),
-        Float3(r.Size.X / tile_size.X * ScriptGlobals::tile_dimension, 0.0f, r.Size.Y / tile_size.Y * ScriptGlobals::tile_dimension)
-        };
-    BuildUVArrayFromData(group, ttype, result.uvs);
-}
-
-    // Creates a mesh build data object from the given array of [TileRectData, TileSide (or null)]
-    // pairs. Makes sure the verts, uvs and indexes are properly ordered. The TileSide member
-    // of the pair determines if the given vertices should be moved to be aligned some way or not.
-void TileGenerator::BuildMeshData(Array<Float3> &verts, Array<Float2> &uvs, Array<uint32> &indexes, const Array<TileRectData> &dataparams) const
-{
-    int vert_count = 0;
-    for (const TileRectData &data : dataparams)
-        vert_count += data.verts.Count();
-
-    //Array<Float3> verts;
-    verts.AddUninitialized(vert_count);
-    //Array<Float2> uvs;
-    uvs.AddUninitialized(vert_count);
-
-    Array<TileRectData> vert_array;
-    vert_array.AddDefault(dataparams.Count());
-    int ix = 0;
-    int vert_pos = 0;
-
-    for (const TileRectData &data : dataparams)
-    {
-        if (data.side == TileSide::None)
-            memcpy(verts.Get() + vert_pos, data.verts.Get(), sizeof(Float3) * data.verts.Count());
-        else
-            AlignRectPoints(data.verts, data.side, verts, vert_pos);
-
-        //data.uvs.CopyTo(uvs, vert_pos);
-        memcpy(uvs.Get() + vert_pos, data.uvs.Get(), sizeof(Float2) * data.uvs.Count());
-        vert_pos += data.verts.Count();
-        vert_array[ix++] = data;
-    }
-
-    BuildIndexArray(vert_array, indexes);
-}
-
-// Constructs a tile data of vertexes and uvs, but not indexes.
-// group: where all the texture and rectangle data will come from
-// types: a list of texture types to use when creating vertices. The first one must be
-//        the main type for the uv mapping.
-// specs: a list with one element for each vertex position. The vertex positions are calculated
-//        by taking the commands in these elements. The elements are arrays.
-// Each element in specs starts with a corner for the vertex initial position in the base (first)
-// type from `types`. If the element array doesn't contain anything else, this position is used
-// as is. Otherwise the array needs two more arrays. One for the x and one for the y coordinates.
-// These arrays will be a pair of operations and index in `types. The two operations currently are
-// OP_ADD and OP_SUBTRACT. For the x array, OP_ADD will add the full width of the passed tex type,
-// and OP_SUBTRACT subtracts it. For the y array it's the height of the tex type rectangle that's
-// used.
-void TileGenerator::BuildPolyData(FloorGroup group, const Array<TexType> &texes, const Array<VertModifierWithAlign> &modifiers, TileRectData &out) const
-{
-    Array<Rectangle> rects(texes.Count());
-    
-    for (TexType t : texes)
-        rects.Add(floor_uv_data[group][t]);
-
-    TileRectData data;
-    Float2 basePos = rects[0].Location;
-    Float2 baseSize = rects[0].Size;
-
-    for (VertModifierWithAlign m : modifiers)
-    {
-        Float3 v;
-        Float2 uv;
-        switch (m.side)
-        {
-            case TileSide::TopLeft:
-                v = Float3::Zero;
-                uv = basePos / Float2((float)texture_size.X, (float)texture_size.Y);
-                break;
-            case TileSide::TopRight:
-                v = Float3(baseSize.X / (float)tile_size.X, 0.0f, 0.0f) * ScriptGlobals::tile_dimension;
-                uv = Float2(basePos.X + baseSize.X, basePos.Y) / Float2((float)texture_size.X, (float)texture_size.Y);
-                break;
-            case TileSide::BottomLeft:
-                v = Float3(0.0f, 0.0f, baseSize.Y / (float)tile_size.Y) * ScriptGlobals::tile_dimension;
-                uv = Float2(basePos.X, basePos.Y + baseSize.Y) / Float2((float)texture_size.X, (float)texture_size.Y);
-                break;
-            default:
-                v = Float3(baseSize.X / (float)tile_size.X, 0.0f, baseSize.Y / (float)tile_size.Y) * ScriptGlobals::tile_dimension;
-                uv = Float2(basePos.X + baseSize.X, basePos.Y + baseSize.Y) / Float2((float)texture_size.X, (float)texture_size.Y);
-                break;
-        }
-
-        if (m.xmods.Count() != 0)
-        {
-            for (const TileOpPair &t : m.xmods)
-            {
-                if (t.op == TileOp::Add)
-                {
-                    const Rectangle &r = rects[t.index];
-                    v.X += r.Size.X * ScriptGlobals::tile_dimension / (float)tile_size.X;
-                    uv.X += r.Size.X / (float)texture_size.X;
-                }
-                else if (t.op == TileOp::Sub)
-                {
-                    const Rectangle &r = rects[t.index];
-                    v.X -= r.Size.X * ScriptGlobals::tile_dimension / (float)tile_size.X;
-                    uv.X -= r.Size.X / (float)texture_size.X;
-                }
-            }
-        }
-        if ( m.ymods.Count() != 0)
-        {
-
-            for (const TileOpPair &t : m.ymods)
-            {
-                if (t.op == TileOp::Add)
-                {
-                    const Rectangle &r = rects[t.index];
-                    v.Z += r.Size.Y * ScriptGlobals::tile_dimension / (float)tile_size.Y;
-                    uv.Y += r.Size.Y / (float)texture_size.Y;
-                }
-                else if (t.op == TileOp::Sub)
-                {
-                    const Rectangle &r = rects[t.index];
-                    v.Z -= r.Size.Y * ScriptGlobals::tile_dimension / (float)tile_size.Y;
-                    uv.Y -= r.Size.Y / (float)texture_size.Y;
-                }
-            }
-        }
-        out.verts.Add(v);
-        out.uvs.Add(uv);
-    }
-}
-
-
-void TileGenerator::AlignRectPoints(const Array<Float3> &verts, TileSide side, Array<Float3> &out_verts, int array_index) const
-{
-    memcpy(out_verts.Get() + array_index, verts.Get(), sizeof(Float3) * verts.Count());
-
-    Rectangle bounds = CalculateRectBounds(verts);
-
-    if (bounds.Location.X != 0.0f && (side == TileSide::Left || side == TileSide::TopLeft || side == TileSide::BottomLeft))
-    {
-        for (int ix = array_index, siz = out_verts.Count(); ix < siz; ++ix)
-            out_verts[ix].X -= bounds.Location.X;
     }
 
-    if (std::abs(bounds.Location.X + bounds.GetWidth() - ScriptGlobals::tile_dimension) > 0.1e-6 && (side == TileSide::Right || side == TileSide::TopRight || side == TileSide::BottomRight))
-    {
-        float dif = ScriptGlobals::tile_dimension - (bounds.Location.X + bounds.GetWidth());
-        for (int ix = array_index, siz = out_verts.Count(); ix < siz; ++ix)
-            out_verts[ix].X += dif;
-    }
-
-    if (bounds.Location.Y != 0.0f && (side == TileSide::Top || side == TileSide::TopLeft || side == TileSide::TopRight))
-    {
-        for (int ix = array_index, siz = out_verts.Count(); ix < siz; ++ix)
-            out_verts[ix].Z -= bounds.Location.Y;
-    }
-
-    if (std::abs(bounds.Location.Y + bounds.GetHeight() - ScriptGlobals::tile_dimension) > 0.1e-6 && (side == TileSide::Bottom || side == TileSide::BottomLeft || side == TileSide::BottomRight))
-    {
-        float dif = ScriptGlobals::tile_dimension - (bounds.Location.Y + bounds.GetHeight());
-        for (int ix = array_index, siz = out_verts.Count(); ix < siz; ++ix)
-            out_verts[ix].Z += dif;
-    }
-}
-
-// Given a collection of vertex data, returns an array that concatenated the contents, but
-// increasing the values to not overlap. For example if first vertex indexes are [0, 1, 2],
-// the second indexes would be starting at 0 too. Increasing them by 3 avoids overlap.
-void TileGenerator::BuildIndexArray(const Array<TileRectData> &from, Array<uint32> &indexes) const
-{
-    int vert_count = 0;
-    for (const TileRectData &data : from)
-        vert_count += data.indexes.Count();
-
-    indexes.Clear();
-    indexes.AddUninitialized(vert_count);
-    int offset = 0;
-    int vert_pos = 0;
-
-    for (const TileRectData &data : from)
-    {
-        for (int i : data.indexes)
-            indexes[vert_pos++] = i + offset;
-        offset += data.verts.Count();
-    }
-}
-
-// Calculates the bounding rectangle of a mesh of two triangles.
-Rectangle TileGenerator::CalculateRectBounds(const Array<Float3> &verts) const
-{
-    float minX = ScriptGlobals::tile_dimension;
-    float maxX = 0.0f;
-    float minY = ScriptGlobals::tile_dimension;
-    float maxY = 0.0f;
-    for (const Float3 &v : verts)
-    {
-        minX = std::min(v.X, minX);
-        maxX = std::max(v.X, maxX);
-        minY = std::min(v.Z, minY);
-        maxY = std::max(v.Z, maxY);
-    }
-    return Rectangle(minX, minY, maxX - minX, maxY - minY);
-}
-
-
-static void UpdateV3InList(Array<Float3> &list, int index, float xdif, float zdif)
-{
-    Float3 &v = list[index];
-    v.X += xdif;
-    v.Z += zdif;
-    //list[index] = v;
-}
-
-static void UpdateV2InList(Array<Float2> &list, int index, float xdif, float ydif)
-{
-    Float2 &v = list[index];
-    v.X += xdif;
-    v.Y += ydif;
-    //list[index] = v;
-}
-
-// Modifies the verts and uvs arrays in data, subtracting the rectangle area of the passed
-// data on left, top, right and bottom sides. There is no error checking for subtracting too much.
-void TileGenerator::AdjustRectData(TileRectData &data, const TileRectDataCollection &sides) const
-{
-    if (sides.left)
-    {
-        float siz = CalculateRectBounds(sides.left->verts).Size.X;
-        float usiz = siz / ScriptGlobals::tile_dimension * tile_size.X / texture_size.X;
-        UpdateV3InList(data.verts, 0, siz, 0.0f);
-        UpdateV3InList(data.verts, 2, siz, 0.0f);
-        UpdateV2InList(data.uvs, 0, usiz, 0.0f);
-        UpdateV2InList(data.uvs, 2, usiz, 0.0f);
-    }
-
-    if (sides.right)
-    {
-        float siz = CalculateRectBounds(sides.right->verts).Size.X;
-        float usiz = siz / ScriptGlobals::tile_dimension * tile_size.X / texture_size.X;
-        UpdateV3InList(data.verts, 1, -siz, 0.0f);
-        UpdateV3InList(data.verts, 3, -siz, 0.0f);
-        UpdateV2InList(data.uvs, 1, -usiz, 0.0f);
-        UpdateV2InList(data.uvs, 3, -usiz, 0.0f);
-    }
-
-    if (sides.top)
-    {
-        float siz = CalculateRectBounds(sides.top->verts).Size.Y;
-        float usiz = siz / ScriptGlobals::tile_dimension * tile_size.Y / texture_size.Y;
-        UpdateV3InList(data.verts, 0, 0.0f, siz);
-        UpdateV3InList(data.verts, 1, 0.0f, siz);
-        UpdateV2InList(data.uvs, 0, 0.0f, usiz);
-        UpdateV2InList(data.uvs, 1, 0.0f, usiz);
-    }
-
-    if (sides.bottom)
-    {
-        float siz = CalculateRectBounds(sides.bottom->verts).Size.Y;
-        float usiz = siz / ScriptGlobals::tile_dimension * tile_size.Y / texture_size.Y;
-        UpdateV3InList(data.verts, 2, 0.0f, -siz);
-        UpdateV3InList(data.verts, 3, 0.0f, -siz);
-        UpdateV2InList(data.uvs, 2, 0.0f, -usiz);
-        UpdateV2InList(data.uvs, 3, 0.0f, -usiz);
-    }
+    indexes.Resize(mesh.index_count, false);
+    std::memcpy(indexes.Get(), mesh.indexes, sizeof(uint32) * mesh.index_count);
 }
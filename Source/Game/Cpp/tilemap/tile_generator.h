@@ -177,61 +177,8 @@ public:
     TileGenerator(const TileGenerator &other) = delete;
 
 private:
-    enum class TileOp
-    {
-        Add,
-        Sub
-    };
-
-    struct TileOpPair
-    {
-        TileOp op;
-        int index;
-    };
-
-    struct TileRectData
-    {
-        Array<Float3> verts;
-        Array<Float2> uvs;
-        Array<int> indexes;
-
-        TileSide side = TileSide::None;
-    };
-
-    struct TileRectDataCollection
-    {
-        TileRectData *left = nullptr;
-        TileRectData *top = nullptr;
-        TileRectData *right = nullptr;
-        TileRectData *bottom = nullptr;
-    };
-
-    struct VertModifierWithAlign
-    {
-        TileSide side;
-
-        Array<TileOpPair> xmods;
-        Array<TileOpPair> ymods;
-
-        VertModifierWithAlign(TileSide side) : side(side) { ; }
-        VertModifierWithAlign(TileSide side, const Array<TileOpPair> &x, const Array<TileOpPair> &y) : side(side), xmods(x), ymods(y) { ; }
-
-    };
-
-
     std::map<FloorGroup, std::map<FloorType, KeepAlive<Model>>> floor_models;
 
-    static std::map<FloorGroup, std::map<TexType, Rectangle>> floor_uv_data;
-    static std::map<FloorGroup, Array<FloorType>> floor_gen_data;
-
-    void GetInstanceData(FloorGroup group, FloorType floor_type, Array<Float3> &verts, Array<uint32> &indexes, Array<Float2> &uvs, Array<Float3> &normals);
-    void BuildUVArrayFromData(FloorGroup group, TexType ttype, Array<Float2> &result) const;
-
-    void BuildRectData(FloorGroup group, TexType ttype, TileRectData &result);
-    void AdjustRectData(TileRectData &data, const TileRectDataCollection &sides) const;
-    void BuildMeshData(Array<Float3> &verts, Array<Float2> &uvs, Array<uint32> &indexes, const Array<TileRectData> &dataparams) const;
-    void AlignRectPoints(const Array<Float3> &verts, TileSide side, Array<Float3> &out_verts, int array_index) const;
-    void BuildIndexArray(const Array<TileRectData> &from, Array<uint32> &indexes) const;
-    Rectangle CalculateRectBounds(const Array<Float3> &verts) const;
-    void BuildPolyData(FloorGroup group, const Array<TexType> &texes, const Array<VertModifierWithAlign> &modifiers, TileRectData &out) const;
+    // Fills the arrays with the mesh of a single floor tile, scaled from the geometry baked at compile time.
+    void GetInstanceData(FloorGroup group, FloorType floor_type, Array<Float3> &verts, Array<uint32> &indexes, Array<Float2> &uvs, Array<Float3> &normals) const;
 };
@@ -1,20 +1,109 @@
 #include "randomizer.h"
 
-bool Randomizer::inited = false;
-RandomStream Randomizer::stream;
+#include <atomic>
+#include <chrono>
 
 
+namespace
+{
+	uint64 NewSeed()
+	{
+		return (uint64)std::chrono::high_resolution_clock::now().time_since_epoch().count();
+	}
+
+	std::atomic<uint64> current_seed(NewSeed());
+	// Key and next counter of the shared stream.
+	std::atomic<uint64> shared_key(0);
+	std::atomic<uint64> shared_counter(0);
+}
+
+
+RandomizerStream::RandomizerStream() : key(1), counter(0)
+{
+}
+
+RandomizerStream::RandomizerStream(uint64 seed, uint64 id) : key(Randomizer::KeyFromSeed(seed, id)), counter(0)
+{
+}
 
-void Randomizer::InitIfNeeded()
+float RandomizerStream::Rand()
 {
-	if (inited)
-		return;
-	inited = true;
-	stream.GenerateNewSeed();
+	return Randomizer::ToFloat(Randomizer::Squares(counter++, key));
 }
 
+float RandomizerStream::RandAt(uint64 index) const
+{
+	return Randomizer::ToFloat(Randomizer::Squares(index, key));
+}
+
+void RandomizerStream::Fill(Span<float> values)
+{
+	float *data = values.Get();
+	const int32 count = values.Length();
+	for (int32 ix = 0; ix < count; ++ix)
+		data[ix] = Randomizer::ToFloat(Randomizer::Squares(counter + ix, key));
+	counter += count;
+}
+
+
 float Randomizer::Rand()
 {
-	InitIfNeeded();
-	return stream.Rand();
-}
\ No newline at end of file
+	uint64 key = shared_key.load(std::memory_order_relaxed);
+	if (key == 0)
+	{
+		// The shared stream starts from the seed the first time it is used.
+		uint64 expected = 0;
+		shared_key.compare_exchange_strong(expected, KeyFromSeed(current_seed.load(), 0));
+		key = shared_key.load();
+	}
+	return ToFloat(Squares(shared_counter.fetch_add(1, std::memory_order_relaxed), key));
+}
+
+void Randomizer::SetSeed(uint64 seed)
+{
+	current_seed.store(seed);
+	shared_key.store(KeyFromSeed(seed, 0));
+	shared_counter.store(0);
+}
+
+uint64 Randomizer::GetSeed()
+{
+	return current_seed.load();
+}
+
+RandomizerStream Randomizer::Stream(uint64 id)
+{
+	return RandomizerStream(current_seed.load(), id);
+}
+
+uint32 Randomizer::Squares(uint64 counter, uint64 key)
+{
+	// Four rounds of squaring and swapping the halves of a Weyl sequence value (Widynski, 2020).
+	uint64 x = counter * key;
+	const uint64 y = x;
+	const uint64 z = y + key;
+	x = x * x + y;
+	x = (x >> 32) | (x << 32);
+	x = x * x + z;
+	x = (x >> 32) | (x << 32);
+	x = x * x + y;
+	x = (x >> 32) | (x << 32);
+	return (uint32)((x * x + z) >> 32);
+}
+
+float Randomizer::ToFloat(uint32 bits)
+{
+	// The top 24 bits fit in the mantissa, giving an even spread in the [0, 1) range.
+	return (float)(bits >> 8) * (1.0f / 16777216.0f);
+}
+
+uint64 Randomizer::KeyFromSeed(uint64 seed, uint64 id)
+{
+	// SplitMix64 of the seed and id. The key of the squares generator should be odd, and have its bits
+	// spread out, which this gives for any seed, even for neighboring ids.
+	uint64 x = seed + (id + 1) * 0x9E3779B97F4A7C15ull;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+	x = x ^ (x >> 31);
+	return x | 1;
+}
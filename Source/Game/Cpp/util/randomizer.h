@@ -1,16 +1,47 @@
 #pragma once
 
 #include "Engine/Scripting/Script.h"
-#include "Engine/Core/RandomStream.h"
+#include "Engine/Core/Types/Span.h"
+
+// Counter based random number stream. The n-th number of a stream only depends on its seed, its id and n,
+// so separate streams can be used from different threads, and replaying with the same seed gives the same
+// numbers no matter how the work was split up.
+struct RandomizerStream
+{
+	RandomizerStream();
+	RandomizerStream(uint64 seed, uint64 id);
+
+	// Next random number between 0 and 1.
+	float Rand();
+	// Random number at a position of the stream, without moving it.
+	float RandAt(uint64 index) const;
+	// Fills the span with the next random numbers.
+	void Fill(Span<float> values);
+
+	uint64 key;
+	// Index of the next number.
+	uint64 counter;
+};
 
 class Randomizer
 {
 public:
+	// Random number between 0 and 1 from the shared stream. Safe to call from any thread, but the order of
+	// numbers between threads is not deterministic. Use a RandomizerStream for repeatable results.
 	static float Rand();
+	// Restarts the shared stream and sets the seed used by Stream().
+	static void SetSeed(uint64 seed);
+	static uint64 GetSeed();
+	// Independent stream for an id, like a visitor or a job, derived from the current seed.
+	static RandomizerStream Stream(uint64 id);
+
+	// Squares counter based generator. Returns 32 random bits for a counter and key.
+	static uint32 Squares(uint64 counter, uint64 key);
+	static float ToFloat(uint32 bits);
 private:
+	friend struct RandomizerStream;
+
 	Randomizer();
 
-	static void InitIfNeeded();
-	static bool inited;
-	static RandomStream stream;
-};
\ No newline at end of file
+	static uint64 KeyFromSeed(uint64 seed, uint64 id);
+};
@@ -3,6 +3,11 @@ using Flax.Build.NativeCpp;
 
 public class Game : GameModule
 {
+    /// <summary>
+    /// Counts the traffic on the park paths for MapNavigation.SaveTraffic. Costs an atomic add for every visitor step and decision.
+    /// </summary>
+    public static bool NavTrafficStats = false;
+
     /// <inheritdoc />
     public override void Init()
     {
@@ -18,6 +23,8 @@ public class Game : GameModule
         base.Setup(options);
 
         options.ScriptingAPI.IgnoreMissingDocumentationWarnings = true;
+        if (NavTrafficStats)
+            options.PublicDefinitions.Add("NAV_TRAFFIC_STATS=1");
 
         // Here you can modify the build options for your game module
         // To reference another module use: options.PublicDependencies.Add("Audio");
@@ -23,6 +23,9 @@ public class BoolParamChangeEvent : AnimEvent
 /// </summary>
 public class VomitEvent : AnimContinuousEvent
 {
+    // Dirt left on the tile the visitor vomits on.
+    public float DirtAmount = 50.0f;
+
     public override void OnBegin(AnimatedModel actor, Animation anim, float time, float deltaTime)
     {
         var visitorScript = actor.GetScript<VisitorBehavior>();
@@ -42,6 +45,10 @@ public class VomitEvent : AnimContinuousEvent
         model.Position = actor.Position - Vector3.Forward * actor.Orientation * 45f;
         model.Scale = new Float3(0.1f);
         visitorScript.VomitModel = model;
+
+        // The dirt goes where the vomit is drawn. Flooring keeps the entry lanes below the map off row 0.
+        var tile = new Int2(Mathf.FloorToInt(model.Position.X / MapGlobals.TileDimension), Mathf.FloorToInt(model.Position.Z / MapGlobals.TileDimension));
+        MapGlobals.MapNavigation.AddDirt(tile, DirtAmount);
     }
 
     public override void OnEvent(AnimatedModel actor, Animation anim, float time, float deltaTime)
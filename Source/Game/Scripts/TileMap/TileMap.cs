@@ -57,11 +57,22 @@ public class TileMap : Script
 
     // Grid size of the starting map
     public Int2 MapSize = new(16, 16);
+    // Tiles on each side of the merged floor meshes. Smaller chunks are rebuilt faster when a tile changes,
+    // bigger ones need fewer draw calls.
+    public int FloorChunkSize = 16;
     // Grid X coordinates at the bottom of the map where the park can connect
     // to the outside world.
     public int[] EntryTiles = [];
     public static int EntryGridDistance = 6;
 
+    // Visitors avoid walking onto tiles with at least this many visitors on them. 0 turns it off.
+    public int CrowdThreshold = 4;
+
+    // Records the visitor simulation from the start, and saves it when the map is destroyed. The file is
+    // in the local folder of the game, and can be replayed with the crowd benchmark.
+    public bool RecordSimulation = false;
+    public string RecordingFile = "Simulation.rec";
+
     // Material to assign to created tiles
     public MaterialBase TileMaterial;
 
@@ -84,8 +95,8 @@ public class TileMap : Script
 
     // Group and floor type pairing for each map cell position.
     private GroupFloor[] mapData;
-    // Modelss placed at each map cell position.
-    private StaticModel[] mapTiles;
+    // Merged floor meshes of the map, split into chunks that are rebuilt when their tiles change.
+    private FloorChunks floorChunks;
 
     private ItemMapData[] itemMap;
 
@@ -96,6 +107,11 @@ public class TileMap : Script
     // the scene, as adding actors is slow.
     private List<StaticModel> tilePool = [];
 
+    // Highlights the floor selected for demolishing with one mesh over the selected rectangle. The mesh is
+    // only rebuilt when the rectangle or the map changes.
+    private StaticModel demolishPreview;
+    private (Int2 A, Int2 B) demolishArea = new(new(-1, -1), new(-1, -1));
+
     private Int2 tempMapOrigin;
     private Int2 tempMapSize;
     private int[] tempMap;
@@ -105,6 +121,7 @@ public class TileMap : Script
     private StaticModel tempItem = null;
 
     private MaterialInstance tilePlacementMaterial;
+    private MaterialInstance tileDestructMaterial;
     private MaterialInstance plantPlacementMaterial;
 
     // Determines how selected models are shown.
@@ -125,6 +142,8 @@ public class TileMap : Script
         TileDim = MapGlobals.TileDimension;
         tilePlacementMaterial = TileMaterial.CreateVirtualInstance();
         tilePlacementMaterial.SetParameterValue("EmissiveColor", placementColor);
+        tileDestructMaterial = TileMaterial.CreateVirtualInstance();
+        tileDestructMaterial.SetParameterValue("EmissiveColor", destructColor);
 
         plantPlacementMaterial = treeMaterial.CreateVirtualInstance();
         plantPlacementMaterial.SetParameterValue("EmissiveColor", placementColor);
@@ -141,9 +160,27 @@ public class TileMap : Script
 
         GenerateMap();
 
+        if (RecordSimulation)
+            SimRecording.Start();
         MapGlobals.MapNavigation.SetMapData(MapSize);
+
+        var entryCells = new Int2[EntryTiles.Length];
+        for (int i = 0; i < EntryTiles.Length; i++)
+            entryCells[i] = new Int2(EntryTiles[i], 0);
+        MapGlobals.EntryGoal = MapGlobals.MapNavigation.AddGoal(entryCells);
+        MapGlobals.MapNavigation.SetEntryTiles(entryCells);
+        MapGlobals.MapNavigation.SetCrowdThreshold(CrowdThreshold);
     }
     
+    /// <inheritdoc/>
+    public override void OnDestroy()
+    {
+        if (SimRecording.IsRecording())
+            SimRecording.Stop(System.IO.Path.Combine(Globals.ProductLocalFolder, RecordingFile));
+        if (demolishPreview != null && demolishPreview.Model != null)
+            Destroy(demolishPreview.Model);
+    }
+
     /// <inheritdoc/>
     public override void OnEnable()
     {
@@ -290,6 +327,7 @@ public class TileMap : Script
         itemMap[index].mtype = mtype;
         itemMap[index].origin = tilePos;
         itemMap[index].actor = smodel;
+        demolishArea = new(new(-1, -1), new(-1, -1));
     }
 
     public void ShowDemolishObjects(Int2 posA, Int2 posB)
@@ -306,30 +344,60 @@ public class TileMap : Script
             return;
         }
         
+        var from = new Int2(Mathf.Max(0, Mathf.Min(posA.X, posB.X)), Mathf.Max(0, Mathf.Min(posA.Y, posB.Y)));
+        var to = new Int2(Mathf.Min(MapSize.X - 1, Mathf.Max(posA.X, posB.X)), Mathf.Min(MapSize.Y - 1, Mathf.Max(posA.Y, posB.Y)));
         HashSet<ModelInstanceActor> newSelection = [];
-        for (int ix = Mathf.Min(posA.X, posB.X), siz = Mathf.Max(posA.X, posB.X) + 1; ix < siz; ++ix)
+        for (int ix = from.X; ix <= to.X; ++ix)
         {
-            if (ix < 0 || ix >= MapSize.X)
-                continue;
-            
-            for (int iy = Mathf.Min(posA.Y, posB.Y), ysiz = Mathf.Max(posA.Y, posB.Y) + 1; iy < ysiz; ++iy)
+            for (int iy = from.Y; iy <= to.Y; ++iy)
             {
-                if (iy < 0)
-                    continue;
-                if (iy >= MapSize.Y)
-                    break;
-                
                 index = TileIndex(ix, iy);
-
                 if (itemMap[index].mtype != ItemType.None)
                     newSelection.Add(itemMap[index].actor);
-                else
-                    newSelection.Add(mapTiles[index]);
             }
         }
+        ShowDemolishPreview(from, to);
         UpdateSelectionModels(newSelection);
     }
 
+    // The floor is merged into chunks, so the tiles between from and to that have no items are highlighted by
+    // a mesh over them, built like a chunk.
+    private void ShowDemolishPreview(Int2 from, Int2 to)
+    {
+        if (tileGenerator == null || to.X < from.X || to.Y < from.Y)
+            return;
+
+        if (demolishPreview == null)
+            demolishPreview = Actor.AddChild<StaticModel>();
+        if (demolishArea != (from, to))
+        {
+            int width = to.X - from.X + 1;
+            int height = to.Y - from.Y + 1;
+            var data = new GroupFloor[width * height];
+            bool anyFloor = false;
+            for (int iy = 0; iy < height; ++iy)
+            {
+                for (int ix = 0; ix < width; ++ix)
+                {
+                    // Tiles with items are highlighted with the items, and no mesh is built for FloorGroup.None.
+                    var index = TileIndex(from.X + ix, from.Y + iy);
+                    data[iy * width + ix] = itemMap[index].mtype != ItemType.None ? new GroupFloor(FloorGroup.None, FloorType.FullTile) : mapData[index];
+                    anyFloor |= itemMap[index].mtype == ItemType.None;
+                }
+            }
+            if (!anyFloor)
+                return;
+
+            var oldModel = demolishPreview.Model;
+            demolishPreview.Model = tileGenerator.CreateModel(data, width, height);
+            if (oldModel != null)
+                Destroy(oldModel);
+            demolishArea = (from, to);
+        }
+        // Setting a new model resets the material slots of the actor.
+        SetTileData(new Vector3(from.X * TileDim, 0.1, from.Y * TileDim), demolishPreview.Model, demolishPreview, tileDestructMaterial);
+    }
+
     public void DemolishObjects(Int2 posA, Int2 posB)
     {
         HideTemporaryModels();
@@ -354,6 +422,7 @@ public class TileMap : Script
                 if (itemMap[index].mtype != ItemType.None)
                 {
                     itemMap[index].mtype = ItemType.None;
+                    demolishArea = new(new(-1, -1), new(-1, -1));
                     if (itemMap[index].actor != null)
                     {
                         Destroy(ref itemMap[index].actor);
@@ -404,8 +473,10 @@ public class TileMap : Script
         DestroyTemporaryMap();
     }
 
+    // Also hides the floor preview that highlights the tiles selected for demolition.
     public void DeselectAll()
     {
+        HideTemporaryModels();
         if (selectedModels.Count == 0)
             return;
         UpdateSelectionModels(null);
@@ -532,7 +603,7 @@ public class TileMap : Script
                 {
                     Profiler.BeginEvent("CreateTemporaries");
                     if (temp)
-                        CreateTemporaryTile(pos, group, ftype, tempMap[ix] == 2);
+                        CreateTemporaryTile(pos, group, ftype, tempMap[ix] == 2 ? tilePlacementMaterial : TileMaterial);
                     else
                         SetTile(pos, group, ftype);
                     Profiler.EndEvent();
@@ -645,6 +716,8 @@ public class TileMap : Script
         tempItemType = ItemType.None;
         if (tempItem != null)
             tempItem.IsActive = false;
+        if (demolishPreview != null)
+            demolishPreview.IsActive = false;
 
         tempPosition = new(new(-1,-1), new(-1,-1));
     }
@@ -652,22 +725,17 @@ public class TileMap : Script
     // Creates the initial world with only grass tiles in MapSize grid dimensions.
     private void GenerateMap()
     {
-        var grassTile = tileGenerator.GetModel(FloorGroup.Grass, FloorType.FullTile);
-
         mapData = new GroupFloor[MapSize.X * MapSize.Y];
         //mapMeshIds = new Guid[MapSize.X * MapSize.Y];
-        mapTiles = new StaticModel[MapSize.X * MapSize.Y];
 
         itemMap = new ItemMapData[MapSize.X * MapSize.Y];
 
         for (int ix = 0, siz = MapSize.X * MapSize.Y; ix < siz; ++ix)
-        {
-            var tile = Actor.AddChild<StaticModel>();
-            SetTileData(new Vector3(ix % MapSize.X * TileDim, 0.0, ix / MapSize.X * TileDim), grassTile, tile, false);
             mapData[ix] = new GroupFloor(FloorGroup.Grass, FloorType.FullTile);
-            //mapMeshIds[ix] = tile.ID;
-            mapTiles[ix] = tile;
-        }
+
+        floorChunks = Actor.AddScript<FloorChunks>();
+        floorChunks.ChunkSize = FloorChunkSize;
+        floorChunks.Init(tileGenerator, MapSize, TileMaterial);
 
         // Build the outer side to the park from generated tile data instead of models.
         const int extraHeight = 4;
@@ -858,12 +926,12 @@ public class TileMap : Script
         return result;
     }
 
-    private void CreateTemporaryTile(Int2 tilePos, FloorGroup group, FloorType ftype, bool placement = false)
+    private void CreateTemporaryTile(Int2 tilePos, FloorGroup group, FloorType ftype, MaterialBase material)
     {
-        CreateTemporaryTile(tilePos.X, tilePos.Y, group, ftype, placement);
+        CreateTemporaryTile(tilePos.X, tilePos.Y, group, ftype, material);
     }
 
-    private void CreateTemporaryTile(int pos_x, int pos_y, FloorGroup group, FloorType ftype, bool placement = false)
+    private void CreateTemporaryTile(int pos_x, int pos_y, FloorGroup group, FloorType ftype, MaterialBase material)
     {
         StaticModel tile = null;
         if (tilePool.Count() > 0)
@@ -874,22 +942,22 @@ public class TileMap : Script
         else
             tile = Actor.AddChild<StaticModel>();
 
-        SetTileData(new Vector3(pos_x * TileDim, 0.1, pos_y * TileDim), group, ftype, tile, placement);
+        SetTileData(new Vector3(pos_x * TileDim, 0.1, pos_y * TileDim), group, ftype, tile, material);
         tempTiles.Add(tile);
     }
 
-    private StaticModel SetTileData(Vector3 world_pos, FloorGroup group, FloorType ftype, StaticModel tile, bool placement = false)
+    private StaticModel SetTileData(Vector3 world_pos, FloorGroup group, FloorType ftype, StaticModel tile, MaterialBase material)
     {
         if (tileGenerator != null)
-            return SetTileData(world_pos, tileGenerator.GetModel(group, ftype), tile, placement);
+            return SetTileData(world_pos, tileGenerator.GetModel(group, ftype), tile, material);
         return null;
     }
 
-    private StaticModel SetTileData(Vector3 world_pos, Model model, StaticModel tile, bool placement = false)
+    private StaticModel SetTileData(Vector3 world_pos, Model model, StaticModel tile, MaterialBase material)
     {
         tile.Model = model;
         tile.Position = world_pos;
-        tile.SetMaterial(0, placement ? tilePlacementMaterial : TileMaterial);
+        tile.SetMaterial(0, material);
         tile.IsActive = true;
         return tile;
     }
@@ -902,8 +970,9 @@ public class TileMap : Script
     private void SetTile(int pos_x, int pos_y, FloorGroup group, FloorType ftype)
     {
         var index = TileIndex(pos_x, pos_y);
-        var tile = SetTileData(new Vector3(pos_x * TileDim, 0.0, pos_y * TileDim), group, ftype, mapTiles[index], false);
         mapData[index] = new GroupFloor(group, ftype);
+        demolishArea = new(new(-1, -1), new(-1, -1));
+        floorChunks.SetTile(new Int2(pos_x, pos_y), group, ftype);
     }
 
     private static TileSide CombineSides(TileSide a, TileSide b)
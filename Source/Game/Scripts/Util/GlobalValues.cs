@@ -9,7 +9,10 @@ public static class MapGlobals
     public static float TileDimension;
     public static int[] EntryTiles;
     public static int EntryGridDistance;
+    // Flow field goal of the entry tiles in MapNavigation.
+    public static int EntryGoal = -1;
     public static MapNavigation MapNavigation;
+    public static VisitorSystem VisitorSystem;
     public static TileMap TileMap;
 }
 
@@ -29,6 +32,7 @@ public class GlobalValues : Script
     {
         MapGlobals.TileDimension = scriptGlobals.TileDimension;
         MapGlobals.MapNavigation = (MapNavigation)scriptGlobals.MapNavigation;
+        MapGlobals.VisitorSystem = (VisitorSystem)scriptGlobals.VisitorSystem;
         MapGlobals.TileMap = TileMap;
     }
 